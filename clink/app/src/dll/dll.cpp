@@ -71,6 +71,9 @@ static void shutdown_clink()
         g_host = nullptr;
     }
 
+    if (tracer* tracer = tracer::get())
+        delete tracer;
+
     if (logger* logger = logger::get())
         delete logger;
 
@@ -92,6 +95,14 @@ INT_PTR WINAPI initialise_clink(const app_context::desc& app_desc)
         new file_logger(log_path.c_str());
     }
 
+    // Record trace spans.
+    if (app_ctx->is_tracing_enabled())
+    {
+        str<256> trace_path;
+        app_ctx->get_trace_path(trace_path);
+        new tracer(trace_path.c_str());
+    }
+
     // What process is the DLL loaded into?
     str<64> host_name;
     if (!get_host_name(host_name))
@@ -0,0 +1,431 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "frecency_db.h"
+
+#include <core/log.h>
+#include <core/os.h>
+#include <core/path.h>
+#include <core/str.h>
+
+#include <algorithm>
+#include <time.h>
+#include <Windows.h>
+
+//------------------------------------------------------------------------------
+// Each line is "<kind> <time> <rank> <name>", where kind is 'd' or 'c'.  A
+// rewritten file starts with a tag line, so instances can tell when the lines
+// they've read have been replaced.
+static const char kind_chars[frecency_db::kind_count] = { 'd', 'c' };
+
+//------------------------------------------------------------------------------
+frecency_db::~frecency_db()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+bool frecency_db::open(const char* path)
+{
+    close();
+
+    DWORD share_flags = FILE_SHARE_READ|FILE_SHARE_WRITE;
+    m_handle = CreateFile(path, GENERIC_READ|GENERIC_WRITE, share_flags,
+        nullptr, OPEN_ALWAYS, 0, nullptr);
+    m_handle = (m_handle == INVALID_HANDLE_VALUE) ? nullptr : m_handle;
+
+    // Uses are appended through a handle that can only append, so the OS puts
+    // each at the end of the file whatever other instances are doing.
+    m_append_handle = CreateFile(path, FILE_APPEND_DATA, share_flags,
+        nullptr, OPEN_ALWAYS, 0, nullptr);
+    m_append_handle = (m_append_handle == INVALID_HANDLE_VALUE) ? nullptr : m_append_handle;
+
+    if (m_handle == nullptr || m_append_handle == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    m_compact_path = path;
+    m_compact_path << ".compact";
+
+    lock(true);
+    recover();
+    unlock();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::close()
+{
+    if (m_handle != nullptr)
+        CloseHandle(m_handle);
+    if (m_append_handle != nullptr)
+        CloseHandle(m_append_handle);
+
+    m_handle = nullptr;
+    m_append_handle = nullptr;
+    m_compact_path.clear();
+
+    for (auto& entries : m_entries)
+        entries.clear();
+    m_tag.clear();
+    m_read_offset = 0;
+    m_line_count = 0;
+    m_add_count = 0;
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::lock(bool exclusive) const
+{
+    // As with history banks, the lock's on a byte far past the end so it
+    // doesn't stop reads or appends through other handles.
+    OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = 0x80000000;
+    LockFileEx(m_handle, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &overlapped);
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::unlock() const
+{
+    OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = 0x80000000;
+    UnlockFileEx(m_handle, 0, 1, 0, &overlapped);
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::get_key(kind kind, const char* name, std::string& out)
+{
+    if (kind != kind_dir)
+    {
+        out = name;
+        return;
+    }
+
+    // Directories are the same however they're spelt.
+    str<280> dir(name);
+    path::normalise(dir);
+    path::maybe_strip_last_separator(dir);
+    for (char* c = dir.data(); *c; ++c)
+        *c = (*c >= 'A' && *c <= 'Z') ? *c + ('a' - 'A') : *c;
+
+    out = dir.c_str();
+}
+
+//------------------------------------------------------------------------------
+unsigned int frecency_db::get_score(const entry& entry, unsigned int now)
+{
+    // A use counts for more the more recent it is.
+    unsigned int age = (now > entry.time) ? now - entry.time : 0;
+    if (age < 60 * 60)              return entry.rank * 4;
+    if (age < 24 * 60 * 60)         return entry.rank * 2;
+    if (age < 7 * 24 * 60 * 60)     return entry.rank / 2;
+    return entry.rank / 4;
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::add(kind kind, const char* name, unsigned int time)
+{
+    if (!is_open() || kind >= kind_count || !name || !*name || strchr(name, '\n'))
+        return;
+
+    str<280> clean(name);
+    if (kind == kind_dir)
+    {
+        path::normalise(clean);
+        path::maybe_strip_last_separator(clean);
+    }
+
+    // The entry's updated when the line's read back, like other instances'.
+    str<> line;
+    line.format("%c %u %u %s\n", kind_chars[kind], time ? time : unsigned(::time(nullptr)), visit_rank, clean.c_str());
+
+    lock(false);
+    DWORD written;
+    WriteFile(m_append_handle, line.c_str(), line.length(), &written, nullptr);
+    unlock();
+
+    // An instance that only adds never reads, so it checks now and then
+    // whether the file's due to be compacted.
+    if (++m_add_count >= compact_check_interval)
+    {
+        m_add_count = 0;
+        refresh();
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned int frecency_db::get_score(kind kind, const char* name, bool update)
+{
+    if (!is_open() || kind >= kind_count)
+        return 0;
+
+    // When scoring many names, only the first needs to catch up on the file.
+    if (update)
+        refresh();
+
+    std::string key;
+    get_key(kind, name, key);
+
+    auto iter = m_entries[kind].find(key);
+    if (iter == m_entries[kind].end())
+        return 0;
+
+    return get_score(iter->second, unsigned(time(nullptr)));
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::get_top(kind kind, unsigned int count, std::vector<result>& out)
+{
+    out.clear();
+    if (!is_open() || kind >= kind_count)
+        return;
+
+    refresh();
+
+    unsigned int now = unsigned(time(nullptr));
+    for (const auto& iter : m_entries[kind])
+        out.push_back({ iter.second.name.c_str(), get_score(iter.second, now) });
+
+    auto more = [] (const result& a, const result& b) {
+        return (a.score != b.score) ? a.score > b.score : strcmp(a.name, b.name) < 0;
+    };
+
+    count = min<unsigned int>(count, (unsigned int)out.size());
+    std::partial_sort(out.begin(), out.begin() + count, out.end(), more);
+    out.resize(count);
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::refresh()
+{
+    lock(false);
+    read();
+    unlock();
+
+    compact();
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::read()
+{
+    // The file's read again from the start if it's been rewritten.
+    char tag[64];
+    DWORD bytes = 0;
+    SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+    ReadFile(m_handle, tag, sizeof(tag) - 1, &bytes, nullptr);
+    tag[bytes] = '\0';
+
+    char* tag_end = strchr(tag, '\n');
+    if (tag[0] != '|' || tag_end == nullptr)
+        tag_end = tag;
+    *tag_end = '\0';
+
+    unsigned int size = GetFileSize(m_handle, nullptr);
+    if (m_tag != tag || size < m_read_offset)
+    {
+        for (auto& entries : m_entries)
+            entries.clear();
+        m_tag = tag;
+        m_read_offset = 0;
+        m_line_count = 0;
+    }
+
+    if (size <= m_read_offset)
+        return;
+
+    // Terminated, so parsing numbers can't run past what was read.
+    std::vector<char> buffer(size - m_read_offset + 1);
+    SetFilePointer(m_handle, m_read_offset, nullptr, FILE_BEGIN);
+    ReadFile(m_handle, buffer.data(), DWORD(buffer.size() - 1), &bytes, nullptr);
+    buffer[bytes] = '\0';
+
+    // A line without its line feed yet is read next time.
+    const char* start = buffer.data();
+    const char* end = start + bytes;
+    while (end > start && end[-1] != '\n')
+        --end;
+
+    read_lines(start, end);
+    m_read_offset += unsigned(end - start);
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::read_lines(const char* start, const char* end)
+{
+    std::string key;
+    while (start < end)
+    {
+        const char* line = start;
+        const char* line_end = (const char*)memchr(start, '\n', end - start);
+        start = line_end + 1;
+
+        if (*line == '|')
+            continue;
+
+        ++m_line_count;
+
+        unsigned int kind = 0;
+        for (; kind < kind_count && kind_chars[kind] != *line; ++kind);
+        if (kind >= kind_count || line[1] != ' ')
+            continue;
+
+        char* next;
+        unsigned int time = strtoul(line + 2, &next, 10);
+        unsigned int rank = (*next == ' ') ? strtoul(next + 1, &next, 10) : 0;
+        const char* name_start = next + 1;
+        if (*next != ' ' || !rank || name_start >= line_end)
+            continue;
+
+        std::string name(name_start, line_end);
+        get_key(frecency_db::kind(kind), name.c_str(), key);
+
+        entry& entry = m_entries[kind][key];
+        entry.name = std::move(name);
+        entry.rank += rank;
+        entry.time = max(entry.time, time);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool frecency_db::compact(bool force)
+{
+    if (!is_open())
+        return false;
+
+    auto is_due = [this] () {
+        size_t entry_count = 0;
+        for (const auto& entries : m_entries)
+            entry_count += entries.size();
+        return m_line_count > entry_count * 2 + 200;
+    };
+
+    if (!force && !is_due())
+        return false;
+
+    lock(true);
+    recover();
+
+    // Another instance may have compacted it already.
+    read();
+    if (!force && !is_due())
+    {
+        unlock();
+        return false;
+    }
+
+    // Ranks are aged once they add up to too much, and entries whose rank is
+    // less than a use are dropped.
+    for (auto& entries : m_entries)
+    {
+        unsigned long long total = 0;
+        for (const auto& iter : entries)
+            total += iter.second.rank;
+
+        if (total <= max_total_rank)
+            continue;
+
+        double scale = 0.9 * max_total_rank / total;
+        for (auto iter = entries.begin(); iter != entries.end();)
+        {
+            iter->second.rank = unsigned(iter->second.rank * scale);
+            if (iter->second.rank < visit_rank)
+                iter = entries.erase(iter);
+            else
+                ++iter;
+        }
+    }
+
+    str<64> tag;
+    tag.format("|FRECENCY_%u_%u_%u", unsigned(time(nullptr)), GetTickCount(), GetCurrentProcessId());
+
+    std::string out = tag.c_str();
+    out += '\n';
+
+    str<> line;
+    unsigned int line_count = 0;
+    for (int kind = 0; kind < kind_count; ++kind)
+    {
+        for (const auto& iter : m_entries[kind])
+        {
+            const entry& entry = iter.second;
+            line.format("%c %u %u %s\n", kind_chars[kind], entry.time, entry.rank, entry.name.c_str());
+            out += line.c_str();
+            ++line_count;
+        }
+    }
+
+    // The file's rewritten in place, since other instances have it open.  If
+    // the copy can't be saved first then the file's left as it is.
+    if (!write_compact_file(out))
+    {
+        unlock();
+        return false;
+    }
+
+    DWORD written;
+    SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+    WriteFile(m_handle, out.c_str(), DWORD(out.length()), &written, nullptr);
+    SetEndOfFile(m_handle);
+    os::unlink(m_compact_path.c_str());
+
+    m_tag = tag.c_str();
+    m_read_offset = unsigned(out.length());
+    m_line_count = line_count;
+
+    unlock();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool frecency_db::write_compact_file(const std::string& content) const
+{
+    void* handle = CreateFile(m_compact_path.c_str(), GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, 0, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD written = 0;
+    bool ok = (WriteFile(handle, content.c_str(), DWORD(content.length()), &written, nullptr) &&
+               written == content.length() &&
+               FlushFileBuffers(handle));
+    CloseHandle(handle);
+
+    if (!ok)
+        os::unlink(m_compact_path.c_str());
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+void frecency_db::recover()
+{
+    // Compacting removes its copy before releasing the lock, so a copy that's
+    // found while holding the lock is from an instance that didn't finish.
+    if (os::get_path_type(m_compact_path.c_str()) != os::path_type_file)
+        return;
+
+    void* handle = CreateFile(m_compact_path.c_str(), GENERIC_READ, 0, nullptr,
+        OPEN_EXISTING, 0, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return;
+
+    std::vector<char> content(GetFileSize(handle, nullptr));
+    DWORD bytes = 0;
+    ReadFile(handle, content.data(), DWORD(content.size()), &bytes, nullptr);
+    CloseHandle(handle);
+
+    // The copy's only complete if it ends with a line feed.
+    if (bytes == content.size() && bytes && content[bytes - 1] == '\n')
+    {
+        LOG("recovering frecency from %s", m_compact_path.c_str());
+
+        DWORD written;
+        SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+        WriteFile(m_handle, content.data(), bytes, &written, nullptr);
+        SetEndOfFile(m_handle);
+    }
+
+    os::unlink(m_compact_path.c_str());
+}
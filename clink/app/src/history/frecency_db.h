@@ -0,0 +1,78 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/base.h>
+#include <core/str.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Ranks directories and command lines by how often and how recently they've
+// been used, shared between instances through a file.  Each use is a line
+// appended to the file, which instances read as it grows; when the file's
+// mostly repeats it's rewritten with a line per entry, and ranks are aged so
+// old entries fall away.  The rewrite is first saved to a ".compact" file, so
+// an instance that dies part way through leaves a copy to recover from.
+class frecency_db
+    : public no_copy
+{
+public:
+    enum kind : unsigned char
+    {
+        kind_dir,
+        kind_command,
+        kind_count,
+    };
+
+    struct result
+    {
+        const char*         name;
+        unsigned int        score;
+    };
+
+    static const unsigned int visit_rank = 100;         // A use's rank.
+    static const unsigned int max_total_rank = 5000 * visit_rank;
+    static const unsigned int compact_check_interval = 64; // Adds between compacting checks.
+
+                            frecency_db() = default;
+                            ~frecency_db();
+    bool                    open(const char* path);
+    void                    close();
+    bool                    is_open() const { return m_handle != nullptr; }
+    void                    add(kind kind, const char* name, unsigned int time=0);
+    unsigned int            get_score(kind kind, const char* name, bool update=true);
+    void                    get_top(kind kind, unsigned int count, std::vector<result>& out);
+    bool                    compact(bool force=false);
+
+private:
+    struct entry
+    {
+        std::string         name;
+        unsigned int        rank;
+        unsigned int        time;
+    };
+
+    typedef std::unordered_map<std::string, entry> entries;
+
+    static void             get_key(kind kind, const char* name, std::string& out);
+    static unsigned int     get_score(const entry& entry, unsigned int now);
+    void                    refresh();
+    void                    read();
+    void                    read_lines(const char* start, const char* end);
+    void                    recover();
+    bool                    write_compact_file(const std::string& content) const;
+    void                    lock(bool exclusive) const;
+    void                    unlock() const;
+    void*                   m_handle = nullptr;
+    void*                   m_append_handle = nullptr;
+    str<280>                m_compact_path;
+    entries                 m_entries[kind_count];
+    std::string             m_tag;              // Changes each time the file's rewritten.
+    unsigned int            m_read_offset = 0;  // Lines before this have been read.
+    unsigned int            m_line_count = 0;
+    unsigned int            m_add_count = 0;    // Adds since compacting was checked.
+};
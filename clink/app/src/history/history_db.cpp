@@ -3,22 +3,27 @@
 
 #include "pch.h"
 #include "history_db.h"
+#include "frecency_db.h"
 #include "utils/app_context.h"
 
+#include <core/arena.h>
 #include <core/base.h>
 #include <core/globber.h>
 #include <core/os.h>
 #include <core/settings.h>
 #include <core/str.h>
+#include <core/str_hash.h>
 #include <core/str_tokeniser.h>
 #include <core/path.h>
 #include <core/log.h>
 #include <assert.h>
 
+#include <algorithm>
 #include <new>
 #include <Windows.h>
 extern "C" {
 #include <readline/history.h>
+extern int _rl_search_case_fold;
 }
 
 //------------------------------------------------------------------------------
@@ -28,6 +33,14 @@ static setting_bool g_shared(
     "",
     false);
 
+static setting_bool g_share_memory(
+    "history.shared_memory",
+    "Share new history lines through memory",
+    "When history.shared is enabled, instances also tell each other about the\n"
+    "lines they add and remove through shared memory, so they needn't reread\n"
+    "the whole history file at each prompt to catch up.",
+    true);
+
 namespace use_get_max_history_instead {
 static setting_int g_max_history(
     "history.max_lines",
@@ -50,10 +63,18 @@ static setting_enum g_dupe_mode(
     "the duplicate when this is set to 'erase_prev'. A value of 'ignore' will\n"
     "not add a line to the history if it already exists, and a value of 'add'\n"
     "will always add lines.\n"
-    "Note that history is not deduplicated when reading/writing to disk.",
+    "When the history is loaded, 'ignore' keeps only the oldest copy of a\n"
+    "line and 'erase_prev' keeps only the most recent.",
     "add,ignore,erase_prev",
     2);
 
+static setting_bool g_erase_dupes(
+    "history.erase_dupes",
+    "Erase duplicates from the history file",
+    "When history.dupe_mode isn't 'add', copies of a line that are skipped\n"
+    "when loading the history are also erased from the history file.",
+    false);
+
 static setting_enum g_expand_mode(
     "history.expand_mode",
     "Sets how command history expansion is applied",
@@ -103,6 +124,36 @@ static int history_expand_control(char* line, int marker_pos)
     return 0;
 }
 
+//------------------------------------------------------------------------------
+static history_index* s_search_index = nullptr;
+static int s_search_base = 0;
+
+//------------------------------------------------------------------------------
+static int history_search_control(const char* needle, int from, int direction)
+{
+    // The index is built on demand, the first time there's a search after the
+    // history is loaded, and lines Readline's added since are caught up here.
+    // When the history's stifled, adding a line drops the oldest one and moves
+    // history_base on, so the length alone doesn't show the list has changed.
+    if (s_search_index->size() > history_length || s_search_base != history_base)
+    {
+        s_search_index->clear();
+        s_search_base = history_base;
+    }
+
+    HIST_ENTRY** list = history_list();
+    for (int i = s_search_index->size(); i < history_length; ++i)
+        s_search_index->add(list[i]->line);
+
+    return s_search_index->find(needle, from, direction, !!_rl_search_case_fold);
+}
+
+//------------------------------------------------------------------------------
+static void history_replace_control(int rl_history_index, const char* line)
+{
+    s_search_index->replace(rl_history_index, line);
+}
+
 //------------------------------------------------------------------------------
 static void get_file_path(str_base& out, bool session)
 {
@@ -129,6 +180,18 @@ static void* open_file(const char* path)
     return (handle == INVALID_HANDLE_VALUE) ? nullptr : handle;
 }
 
+//------------------------------------------------------------------------------
+static void* open_append_file(const char* path)
+{
+    // A handle that may only append has each write put at the end of the file
+    // by the OS, atomically with respect to other appends.
+    DWORD share_flags = FILE_SHARE_READ|FILE_SHARE_WRITE;
+    void* handle = CreateFile(path, FILE_APPEND_DATA, share_flags, nullptr,
+        OPEN_ALWAYS, 0, nullptr);
+
+    return (handle == INVALID_HANDLE_VALUE) ? nullptr : handle;
+}
+
 
 
 //------------------------------------------------------------------------------
@@ -151,46 +214,6 @@ void concurrency_tag::set(const char* tag)
 
 
 
-//------------------------------------------------------------------------------
-class auto_free_str
-{
-public:
-                        auto_free_str() = default;
-                        auto_free_str(const char* s, int len) { set(s, len); }
-                        auto_free_str(auto_free_str&& other) : m_ptr(other.m_ptr) { other.m_ptr = nullptr; }
-                        ~auto_free_str() { free(m_ptr); }
-
-    auto_free_str&      operator=(const char* s) { set(s); return *this; }
-    auto_free_str&      operator=(auto_free_str&& other) { m_ptr = other.m_ptr; other.m_ptr = nullptr; return *this; }
-    void                set(const char* s, int len = -1);
-    const char*         get() const { return m_ptr; }
-
-private:
-    char*               m_ptr = nullptr;
-};
-
-//------------------------------------------------------------------------------
-void auto_free_str::set(const char* s, int len)
-{
-    if (s == m_ptr)
-    {
-        if (len < int(strlen(m_ptr)))
-            m_ptr[len] = '\0';
-    }
-    else
-    {
-        char* old = m_ptr;
-        if (len < 0)
-            len = int(strlen(s));
-        m_ptr = (char*)malloc(len + 1);
-        memcpy(m_ptr, s, len);
-        m_ptr[len] = '\0';
-        free(old);
-    }
-}
-
-
-
 //------------------------------------------------------------------------------
 union line_id_impl
 {
@@ -207,30 +230,94 @@ union line_id_impl
 
 
 
+//------------------------------------------------------------------------------
+// Binary banks start with a bank_header, followed by records that are each a
+// record_header, the line, and a line feed (so a line can be terminated in
+// place, as with text banks).  Records can be stepped over without looking at
+// their lines, deleting one sets a flag, and finding a line only compares the
+// lines whose hash matches.  The hash also lets a reader that's found a record
+// was only partly written pick up again at the next good one.
+static const char bank_magic[4] = { 'C', 'L', 'H', 'B' };
+static const unsigned short bank_version = 1;
+static const unsigned short record_marker = 0xc1c1;
+static const unsigned short record_deleted = 1 << 0;
+
+//------------------------------------------------------------------------------
+struct bank_header
+{
+    char                    magic[4];
+    unsigned short          version;
+    unsigned short          size;       // Records start this far in.
+    char                    ctag[56];   // Master bank only.
+};
+
+//------------------------------------------------------------------------------
+struct record_header
+{
+    unsigned int            length;
+    unsigned short          flags;
+    unsigned short          marker;
+    unsigned int            time;
+    unsigned int            hash;       // str_hash() of the line.
+};
+
+static_assert(sizeof(bank_header) == 64, "");
+static_assert(sizeof(record_header) == 16, "");
+static_assert(max_ctag_size <= sizeof(bank_header::ctag), "");
+
+//------------------------------------------------------------------------------
+static bool is_record(const record_header& header, unsigned int max_length)
+{
+    return (header.marker == record_marker &&
+            header.length > 0 &&
+            header.length <= max_length &&
+            !(header.flags & ~record_deleted));
+}
+
+
+
 //------------------------------------------------------------------------------
 class bank_lock
     : public no_copy
 {
 public:
     explicit        operator bool () const;
+    history_db::bank_format get_format() const;
+    unsigned int    get_size() const;
 
 protected:
                     bank_lock() = default;
-                    bank_lock(void* handle, bool exclusive);
+                    bank_lock(void* handle, bool exclusive, bool wait);
                     ~bank_lock();
     void*           m_handle = nullptr;
+    mutable history_db::bank_format m_format = history_db::bank_format_unknown;
+    mutable bool    m_format_known = false;
 };
 
 //------------------------------------------------------------------------------
-bank_lock::bank_lock(void* handle, bool exclusive)
+// Instances coordinate through a lock on one byte far past the end of a bank
+// rather than on the bank's contents.  Windows' locks are mandatory, so even a
+// shared lock over the contents would refuse other instances' appends.
+static const DWORD lock_offset_high = 0x80000000;
+
+// Appends also hold a shared lock on the next byte while they write, so that
+// readers can tell a line that's still being added from one that was saved
+// without a newline.
+static const DWORD append_lock_offset = 1;
+
+//------------------------------------------------------------------------------
+bank_lock::bank_lock(void* handle, bool exclusive, bool wait)
 : m_handle(handle)
 {
     if (m_handle == nullptr)
         return;
 
     OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = lock_offset_high;
     int flags = exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0;
-    LockFileEx(m_handle, flags, 0, ~0u, ~0u, &overlapped);
+    flags |= wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY;
+    if (!LockFileEx(m_handle, flags, 0, 1, 0, &overlapped) && !wait)
+        m_handle = nullptr;
 }
 
 //------------------------------------------------------------------------------
@@ -239,7 +326,8 @@ bank_lock::~bank_lock()
     if (m_handle != nullptr)
     {
         OVERLAPPED overlapped = {};
-        UnlockFileEx(m_handle, 0, ~0u, ~0u, &overlapped);
+        overlapped.OffsetHigh = lock_offset_high;
+        UnlockFileEx(m_handle, 0, 1, 0, &overlapped);
     }
 }
 
@@ -249,6 +337,39 @@ bank_lock::operator bool () const
     return (m_handle != nullptr);
 }
 
+//------------------------------------------------------------------------------
+unsigned int bank_lock::get_size() const
+{
+    return GetFileSize(m_handle, nullptr);
+}
+
+//------------------------------------------------------------------------------
+history_db::bank_format bank_lock::get_format() const
+{
+    // The format's read from the bank rather than remembered for it, so one
+    // converted by another instance is seen straight away.  Empty banks are
+    // text until something writes a binary header.
+    if (m_format_known || m_handle == nullptr)
+        return m_format;
+
+    bank_header header = {};
+    DWORD read = 0;
+    DWORD file_ptr = SetFilePointer(m_handle, 0, nullptr, FILE_CURRENT);
+    SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+    ReadFile(m_handle, &header, sizeof(header), &read, nullptr);
+    SetFilePointer(m_handle, file_ptr, nullptr, FILE_BEGIN);
+
+    if (read < sizeof(header.magic) || memcmp(header.magic, bank_magic, sizeof(bank_magic)) != 0)
+        m_format = history_db::bank_format_text;
+    else if (read == sizeof(header) && header.version == bank_version && header.size >= sizeof(header))
+        m_format = history_db::bank_format_binary;
+    else
+        m_format = history_db::bank_format_unknown;
+
+    m_format_known = true;
+    return m_format;
+}
+
 
 
 //------------------------------------------------------------------------------
@@ -262,17 +383,24 @@ public:
                             file_iter() = default;
                             file_iter(const read_lock& lock, char* buffer, int buffer_size);
         template <int S>    file_iter(const read_lock& lock, char (&buffer)[S]);
+                            ~file_iter();
         unsigned int        next(unsigned int rollback=0);
+        bool                grow();
         unsigned int        get_buffer_offset() const   { return m_buffer_offset; }
         char*               get_buffer() const          { return m_buffer; }
         unsigned int        get_buffer_size() const     { return m_buffer_size; }
+        unsigned int        get_buffer_capacity() const { return m_buffer_capacity; }
+        bool                is_full() const             { return m_buffer_size >= m_buffer_capacity; }
         unsigned int        get_remaining() const       { return m_remaining; }
+        void*               get_handle() const          { return m_handle; }
         void                set_file_offset(unsigned int offset);
 
     private:
         char*               m_buffer;
+        char*               m_heap_buffer = nullptr;
         void*               m_handle;
         unsigned int        m_buffer_size;
+        unsigned int        m_buffer_capacity;
         unsigned int        m_buffer_offset;
         unsigned int        m_remaining;
     };
@@ -286,37 +414,78 @@ public:
         line_id_impl        next(str_iter& out);
         void                set_file_offset(unsigned int offset);
         unsigned int        get_deleted_count() const { return m_deleted; }
+        unsigned int        get_end_offset() const;
+        unsigned int        get_time() const { return m_time; }
+        unsigned int        get_hash() const { return m_hash; }
+        void                set_verify(bool verify) { m_verify = verify; }
 
     private:
         bool                provision();
+        bool                provision(unsigned int needed);
+        line_id_impl        next_record(str_iter& out);
         file_iter           m_file_iter;
         unsigned int        m_remaining = 0;
         unsigned int        m_deleted = 0;
+        unsigned int        m_time = 0;
+        unsigned int        m_hash = 0;
+        history_db::bank_format m_format;
         bool                m_first_line = true;
         bool                m_eating_ctag = false;
+        bool                m_resyncing = false;
+        bool                m_verify = false;
+    };
+
+    class reverse_line_iter : public no_copy
+    {
+    public:
+                            reverse_line_iter() = default;
+                            reverse_line_iter(const read_lock& lock, char* buffer, int buffer_size);
+                            ~reverse_line_iter();
+        line_id_impl        prev(str_iter& out);
+
+    private:
+        bool                extend();
+        bool                extend(unsigned int offset);
+        char*               at(unsigned int offset) const { return m_buffer + offset - m_buffer_offset; }
+        line_id_impl        prev_record(str_iter& out);
+        char*               m_buffer;
+        char*               m_heap_buffer = nullptr;
+        void*               m_handle;
+        unsigned int        m_buffer_capacity;
+        unsigned int        m_buffer_offset;    // Of the buffer's first byte.
+        unsigned int        m_cursor;           // Lines before this are still to be read.
+        unsigned int        m_first = 0;        // Where lines can start.
+        unsigned int        m_size;
+        history_db::bank_format m_format;
     };
 
     explicit                read_lock() = default;
-    explicit                read_lock(void* handle, bool exclusive=false);
+    explicit                read_lock(void* handle, bool exclusive=false, bool wait=true);
     line_id_impl            find(const char* line) const;
     template <class T> void find(const char* line, T&& callback) const;
 };
 
 //------------------------------------------------------------------------------
-read_lock::read_lock(void* handle, bool exclusive)
-: bank_lock(handle, exclusive)
+read_lock::read_lock(void* handle, bool exclusive, bool wait)
+: bank_lock(handle, exclusive, wait)
 {
 }
 
 //------------------------------------------------------------------------------
 template <class T> void read_lock::find(const char* line, T&& callback) const
 {
-    char buffer[history_db::max_line_length];
+    char buffer[history_db::line_buffer_size];
     line_iter iter(*this, buffer);
 
+    bool binary = (get_format() == history_db::bank_format_binary);
+    unsigned int hash = binary ? str_hash(line) : 0;
+
     line_id_impl id;
     for (str_iter read; id = iter.next(read);)
     {
+        if (binary && iter.get_hash() != hash)
+            continue;
+
         if (strncmp(line, read.get_pointer(), read.length()) != 0)
             continue;
 
@@ -356,10 +525,17 @@ read_lock::file_iter::file_iter(const read_lock& lock, char* buffer, int buffer_
 : m_handle(lock.m_handle)
 , m_buffer(buffer)
 , m_buffer_size(buffer_size)
+, m_buffer_capacity(buffer_size)
 {
     set_file_offset(0);
 }
 
+//------------------------------------------------------------------------------
+read_lock::file_iter::~file_iter()
+{
+    free(m_heap_buffer);
+}
+
 //------------------------------------------------------------------------------
 unsigned int read_lock::file_iter::next(unsigned int rollback)
 {
@@ -373,7 +549,7 @@ unsigned int read_lock::file_iter::next(unsigned int rollback)
     m_buffer_offset += m_buffer_size - rollback;
 
     char* target = m_buffer + rollback;
-    int needed = min(m_remaining, m_buffer_size - rollback);
+    int needed = min(m_remaining, m_buffer_capacity - rollback);
 
     DWORD read = 0;
     ReadFile(m_handle, target, needed, &read, nullptr);
@@ -383,13 +559,31 @@ unsigned int read_lock::file_iter::next(unsigned int rollback)
     return m_buffer_size;
 }
 
+//------------------------------------------------------------------------------
+bool read_lock::file_iter::grow()
+{
+    // Lines longer than the caller's buffer continue in a larger one from the
+    // heap. The buffered content is kept; next() appends to it.
+    unsigned int capacity = max<unsigned int>(m_buffer_capacity * 2, 256);
+    char* buffer = (char*)malloc(capacity);
+    if (buffer == nullptr)
+        return false;
+
+    memcpy(buffer, m_buffer, m_buffer_size);
+    free(m_heap_buffer);
+
+    m_buffer = m_heap_buffer = buffer;
+    m_buffer_capacity = capacity;
+    return true;
+}
+
 //------------------------------------------------------------------------------
 void read_lock::file_iter::set_file_offset(unsigned int offset)
 {
     m_remaining = GetFileSize(m_handle, nullptr);
     offset = clamp(offset, (unsigned int)0, m_remaining);
     m_remaining -= offset;
-    m_buffer_offset = 0 - m_buffer_size;
+    m_buffer_offset = offset - m_buffer_size;
     SetFilePointer(m_handle, offset, nullptr, FILE_BEGIN);
     m_buffer[0] = '\0';
 }
@@ -405,24 +599,71 @@ template <int S> read_lock::line_iter::line_iter(const read_lock& lock, char (&b
 //------------------------------------------------------------------------------
 read_lock::line_iter::line_iter(const read_lock& lock, char* buffer, int buffer_size)
 : m_file_iter(lock, buffer, buffer_size)
+, m_format(lock.get_format())
 {
 }
 
 //------------------------------------------------------------------------------
 bool read_lock::line_iter::provision()
 {
+    if (!m_file_iter.get_remaining())
+        return false;
+
     return !!(m_remaining = m_file_iter.next(m_remaining));
 }
 
+//------------------------------------------------------------------------------
+unsigned int read_lock::line_iter::get_end_offset() const
+{
+    // Where reading stopped; the end of the bank once it's all been read, bar
+    // any tail that's still being written.
+    return m_file_iter.get_buffer_offset() + m_file_iter.get_buffer_size() - m_remaining;
+}
+
+//------------------------------------------------------------------------------
+bool read_lock::line_iter::provision(unsigned int needed)
+{
+    while (m_remaining < needed)
+    {
+        if (!m_file_iter.get_remaining())
+            return false;
+
+        if (needed > m_file_iter.get_buffer_capacity() && !m_file_iter.grow())
+            return false;
+
+        m_remaining = m_file_iter.next(m_remaining);
+    }
+
+    return true;
+}
+
 //------------------------------------------------------------------------------
 inline bool is_line_breaker(unsigned char c)
 {
     return c == 0x00 || c == 0x0a || c == 0x0d;
 }
 
+//------------------------------------------------------------------------------
+static bool is_tail_in_flight(void* handle, unsigned int size)
+{
+    // An unterminated last line is an add that's still being written if an
+    // append holds its lock, or if one's finished since the bank was read.
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = append_lock_offset;
+    overlapped.OffsetHigh = lock_offset_high;
+    if (!LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK|LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped))
+        return true;
+
+    UnlockFileEx(handle, 0, 1, 0, &overlapped);
+    return (GetFileSize(handle, nullptr) != size);
+}
+
 //------------------------------------------------------------------------------
 line_id_impl read_lock::line_iter::next(str_iter& out)
 {
+    if (m_format != history_db::bank_format_text)
+        return next_record(out);
+
     while (m_remaining || provision())
     {
         const char* last = m_file_iter.get_buffer() + m_file_iter.get_buffer_size();
@@ -459,12 +700,40 @@ line_id_impl read_lock::line_iter::next(str_iter& out)
                 break;
             }
 
-        if (end == last && start != m_file_iter.get_buffer())
+        // A line that runs to the end of the bank without a newline may be
+        // another instance's add that's still being written.  Otherwise it's
+        // a last line that was saved without one, e.g. by an editor.
+        if (end == last && !m_file_iter.get_remaining())
+        {
+            unsigned int size = m_file_iter.get_buffer_offset() + m_file_iter.get_buffer_size();
+            if (start == end || is_tail_in_flight(m_file_iter.get_handle(), size))
+                break;
+
+            // Lines are returned with room after them to be terminated, which
+            // the last one mightn't have if it ends where the buffer does.
+            if (m_file_iter.is_full())
+            {
+                if (!m_file_iter.grow())
+                    break;
+                continue;
+            }
+        }
+        else if (end == last && start != m_file_iter.get_buffer())
         {
             provision();
             continue;
         }
 
+        // The line fills the whole buffer and there's more of it to read.
+        else if (end == last)
+        {
+            if (m_file_iter.grow())
+            {
+                provision();
+                continue;
+            }
+        }
+
         int bytes = int(end - start);
         m_remaining -= bytes;
 
@@ -487,11 +756,291 @@ line_id_impl read_lock::line_iter::next(str_iter& out)
     return line_id_impl();
 }
 
+//------------------------------------------------------------------------------
+line_id_impl read_lock::line_iter::next_record(str_iter& out)
+{
+    if (m_format != history_db::bank_format_binary)
+        return line_id_impl();
+
+    if (m_first_line)
+    {
+        m_first_line = false;
+        if (!provision(sizeof(bank_header)))
+            return line_id_impl();
+
+        const char* start = m_file_iter.get_buffer() + m_file_iter.get_buffer_size() - m_remaining;
+        unsigned int size = ((const bank_header*)start)->size;
+        if (!provision(size))
+            return line_id_impl();
+
+        m_remaining -= size;
+    }
+
+    // Records that don't check out are stepped over a byte at a time until
+    // the next one that does.  Each such run counts once as a deleted line, so
+    // compacting the bank drops it.
+    const unsigned int max_length = (1 << 29) - 1;
+    while (provision(sizeof(record_header)))
+    {
+        const char* start = m_file_iter.get_buffer() + m_file_iter.get_buffer_size() - m_remaining;
+
+        record_header header;
+        memcpy(&header, start, sizeof(header));
+
+        // A record that runs past the end of the bank may be another
+        // instance's add that's still being written, so it ends the bank
+        // without counting as deleted.  If the write never finished then
+        // whatever's added next makes it not check out.
+        unsigned int record_size = sizeof(header) + header.length + 1;
+        unsigned int available = m_remaining + m_file_iter.get_remaining();
+        bool valid = is_record(header, max_length);
+        if (valid && record_size > available)
+            break;
+        if (valid && !provision(record_size))
+            return line_id_impl();
+
+        if (valid)
+        {
+            start = m_file_iter.get_buffer() + m_file_iter.get_buffer_size() - m_remaining;
+            const char* line = start + sizeof(header);
+            valid = (line[header.length] == '\n');
+
+            // Hashing every line would cost more than scanning text does, so
+            // it's only checked where a marker might be a coincidence, or when
+            // asked to (e.g. before lines are carried over into another bank).
+            if (valid && (m_resyncing || m_verify))
+                valid = (header.hash == str_hash(line, header.length));
+        }
+
+        if (!valid)
+        {
+            if (!m_resyncing)
+                ++m_deleted;
+            m_resyncing = true;
+            --m_remaining;
+            continue;
+        }
+
+        m_resyncing = false;
+        m_remaining -= record_size;
+
+        if (header.flags & record_deleted)
+        {
+            ++m_deleted;
+            continue;
+        }
+
+        m_time = header.time;
+        m_hash = header.hash;
+        new (&out) str_iter(start + sizeof(header), header.length);
+
+        unsigned int offset = int(start - m_file_iter.get_buffer());
+        return line_id_impl(m_file_iter.get_buffer_offset() + offset);
+    }
+
+    return line_id_impl();
+}
+
 //------------------------------------------------------------------------------
 void read_lock::line_iter::set_file_offset(unsigned int offset)
 {
     m_file_iter.set_file_offset(offset);
+    m_remaining = 0;
     m_eating_ctag = false;
+    if (m_format == history_db::bank_format_binary)
+        m_first_line = !offset;
+}
+
+
+
+//------------------------------------------------------------------------------
+// Reads a bank's lines newest first, from its end back towards its start, so
+// the last few lines can be had without reading the rest.  Only what's between
+// the cursor and the start of the buffer is kept as more is read.
+read_lock::reverse_line_iter::reverse_line_iter(const read_lock& lock, char* buffer, int buffer_size)
+: m_buffer(buffer)
+, m_handle(lock.m_handle)
+, m_buffer_capacity(max(buffer_size, 0))
+, m_format(lock.get_format())
+{
+    m_size = GetFileSize(m_handle, nullptr);
+    m_buffer_offset = m_cursor = m_size;
+
+    if (m_format == history_db::bank_format_binary)
+    {
+        bank_header header = {};
+        DWORD read = 0;
+        SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+        ReadFile(m_handle, &header, sizeof(header), &read, nullptr);
+        m_first = min<unsigned int>(header.size, m_size);
+    }
+}
+
+//------------------------------------------------------------------------------
+read_lock::reverse_line_iter::~reverse_line_iter()
+{
+    free(m_heap_buffer);
+}
+
+//------------------------------------------------------------------------------
+bool read_lock::reverse_line_iter::extend()
+{
+    if (m_buffer_offset <= m_first)
+        return false;
+
+    // The part of a line that's been read so far moves to the back of the
+    // buffer and the bank before it is read in ahead of it.  A line that fills
+    // the buffer continues in a larger one from the heap.
+    unsigned int keep = m_cursor - m_buffer_offset;
+    if (keep >= m_buffer_capacity)
+    {
+        unsigned int capacity = max<unsigned int>(m_buffer_capacity * 2, 256);
+        char* buffer = (char*)malloc(capacity);
+        if (buffer == nullptr)
+            return false;
+
+        memcpy(buffer, m_buffer, keep);
+        free(m_heap_buffer);
+
+        m_buffer = m_heap_buffer = buffer;
+        m_buffer_capacity = capacity;
+    }
+
+    unsigned int needed = min(m_buffer_offset - m_first, m_buffer_capacity - keep);
+    memmove(m_buffer + needed, m_buffer, keep);
+    m_buffer_offset -= needed;
+
+    DWORD read = 0;
+    SetFilePointer(m_handle, m_buffer_offset, nullptr, FILE_BEGIN);
+    ReadFile(m_handle, m_buffer, needed, &read, nullptr);
+    return (read == needed);
+}
+
+//------------------------------------------------------------------------------
+bool read_lock::reverse_line_iter::extend(unsigned int offset)
+{
+    while (m_buffer_offset > max(offset, m_first))
+        if (!extend())
+            return false;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+line_id_impl read_lock::reverse_line_iter::prev(str_iter& out)
+{
+    if (m_format != history_db::bank_format_text)
+        return prev_record(out);
+
+    while (true)
+    {
+        // A line that runs to the end of the bank without a newline may be
+        // another instance's add that's still being written.
+        bool tail = true;
+        for (; m_cursor > m_buffer_offset && is_line_breaker(*at(m_cursor - 1)); --m_cursor)
+            tail = false;
+
+        if (m_cursor == m_buffer_offset)
+        {
+            if (extend())
+                continue;
+            return line_id_impl();
+        }
+
+        unsigned int start = m_cursor;
+        while (start > m_buffer_offset && !is_line_breaker(*at(start - 1)))
+            --start;
+
+        // The line may start further back than what's been read.
+        if (start == m_buffer_offset && start > m_first)
+        {
+            if (extend())
+                continue;
+            return line_id_impl();
+        }
+
+        unsigned int end = m_cursor;
+        m_cursor = start;
+
+        // Deleted lines and the master bank's CTAG line start with a '|'.
+        if ((tail && end == m_size && is_tail_in_flight(m_handle, m_size)) || *at(start) == '|')
+            continue;
+
+        new (&out) str_iter(at(start), int(end - start));
+        return line_id_impl(start);
+    }
+}
+
+//------------------------------------------------------------------------------
+line_id_impl read_lock::reverse_line_iter::prev_record(str_iter& out)
+{
+    if (m_format != history_db::bank_format_binary)
+        return line_id_impl();
+
+    // Records are only linked forwards, but a line doesn't contain a line feed
+    // so a record's header is at most a header's length before the line feed
+    // ahead of its own.  Where a header there agrees with where the record
+    // ends, the hash confirms it.  Anything that doesn't check out (e.g. a
+    // record that's still being written) is stepped back over to the line feed
+    // ahead of it.
+    const unsigned int max_length = (1 << 29) - 1;
+    while (m_cursor > m_first)
+    {
+        if (!extend(m_cursor - 1))
+            return line_id_impl();
+
+        // Find where the line feed before the cursor's last byte is.
+        unsigned int end = m_cursor;
+        unsigned int prev_lf = end - 1;
+        for (; prev_lf > m_first; --prev_lf)
+        {
+            if (prev_lf == m_buffer_offset && !extend())
+                return line_id_impl();
+
+            if (*at(prev_lf - 1) == '\n')
+                break;
+        }
+
+        bool found = false;
+        record_header header;
+        if (*at(end - 1) == '\n')
+        {
+            unsigned int header_min = prev_lf - min<unsigned int>(prev_lf - m_first, sizeof(header));
+            if (!extend(header_min))
+                return line_id_impl();
+
+            for (unsigned int offset = end; offset-- > header_min;)
+            {
+                if (end - offset < sizeof(header) + 2)
+                    continue;
+
+                memcpy(&header, at(offset), sizeof(header));
+                if (!is_record(header, max_length) || offset + sizeof(header) + header.length + 1 != end)
+                    continue;
+
+                if (header.hash != str_hash(at(offset + sizeof(header)), header.length))
+                    continue;
+
+                m_cursor = offset;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            m_cursor = prev_lf;
+            continue;
+        }
+
+        if (header.flags & record_deleted)
+            continue;
+
+        new (&out) str_iter(at(m_cursor + sizeof(header)), header.length);
+        return line_id_impl(m_cursor);
+    }
+
+    return line_id_impl();
 }
 
 
@@ -502,63 +1051,340 @@ class write_lock
 {
 public:
                     write_lock() = default;
-    explicit        write_lock(void* handle);
-    void            clear();
-    void            add(const char* line);
+    explicit        write_lock(void* handle, bool wait=true);
+    void            clear(const char* ctag=nullptr);
+    void            clear(history_db::bank_format format, const char* ctag=nullptr);
+    void            add(const char* line, unsigned int time=0);
+    void            add(const std::vector<std::pair<const char*, unsigned int>>& lines);
     void            remove(line_id_impl id);
     void            append(const read_lock& src);
+    bool            replace(const read_lock& src);
+
+private:
+    void            seek_end();
 };
 
 //------------------------------------------------------------------------------
-write_lock::write_lock(void* handle)
-: read_lock(handle, true)
+write_lock::write_lock(void* handle, bool wait)
+: read_lock(handle, true, wait)
 {
 }
 
 //------------------------------------------------------------------------------
-void write_lock::clear()
+void write_lock::clear(const char* ctag)
+{
+    history_db::bank_format format = get_format();
+    if (format == history_db::bank_format_unknown)
+        format = history_db::bank_format_text;
+
+    clear(format, ctag);
+}
+
+//------------------------------------------------------------------------------
+void write_lock::clear(history_db::bank_format format, const char* ctag)
 {
     SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
     SetEndOfFile(m_handle);
+
+    m_format = format;
+    m_format_known = true;
+
+    if (format == history_db::bank_format_binary)
+    {
+        bank_header header = {};
+        memcpy(header.magic, bank_magic, sizeof(bank_magic));
+        header.version = bank_version;
+        header.size = sizeof(header);
+        if (ctag)
+            str_base(header.ctag).copy(ctag);
+
+        DWORD written;
+        WriteFile(m_handle, &header, sizeof(header), &written, nullptr);
+    }
+    else if (ctag)
+    {
+        add(ctag);
+    }
 }
 
 //------------------------------------------------------------------------------
-void write_lock::add(const char* line)
+static unsigned int get_line_size(history_db::bank_format format, unsigned int length)
 {
-    DWORD written;
+    unsigned int size = length + 1;
+    if (format == history_db::bank_format_binary)
+        size += sizeof(record_header);
+    return size;
+}
+
+//------------------------------------------------------------------------------
+static void format_line(history_db::bank_format format, const char* line, unsigned int length, unsigned int time, char* out)
+{
+    if (format == history_db::bank_format_binary)
+    {
+        record_header header = {};
+        header.length = length;
+        header.marker = record_marker;
+        header.time = time ? time : (unsigned int)::time(nullptr);
+        header.hash = str_hash(line, length);
+
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+    }
+
+    memcpy(out, line, length);
+    out[length] = '\n';
+}
+
+//------------------------------------------------------------------------------
+static bool needs_line_break(void* handle, history_db::bank_format format)
+{
+    // A last line that was saved without a newline mustn't have the next line
+    // run on from it.
+    if (format != history_db::bank_format_text)
+        return false;
+
+    unsigned int size = GetFileSize(handle, nullptr);
+    if (!size)
+        return false;
+
+    char c = '\n';
+    DWORD read = 0;
+    SetFilePointer(handle, size - 1, nullptr, FILE_BEGIN);
+    ReadFile(handle, &c, 1, &read, nullptr);
+    return !is_line_breaker(c);
+}
+
+//------------------------------------------------------------------------------
+static bool write_line(void* handle, history_db::bank_format format, const char* line, unsigned int time, bool line_break=false)
+{
+    // A line's written in one go, so an interrupted write leaves at most one
+    // torn line for readers to step over.
+    char stack_buffer[256];
+    unsigned int length = (unsigned int)strlen(line);
+    unsigned int size = get_line_size(format, length) + line_break;
+    char* buffer = (size <= sizeof(stack_buffer)) ? stack_buffer : (char*)malloc(size);
+    if (buffer == nullptr)
+        return false;
+
+    buffer[0] = '\n';
+    format_line(format, line, length, time, buffer + line_break);
+
+    DWORD written = 0;
+    bool ok = WriteFile(handle, buffer, size, &written, nullptr) && written == size;
+
+    if (buffer != stack_buffer)
+        free(buffer);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+void write_lock::seek_end()
+{
+    bool line_break = needs_line_break(m_handle, get_format());
     SetFilePointer(m_handle, 0, nullptr, FILE_END);
-    WriteFile(m_handle, line, int(strlen(line)), &written, nullptr);
-    WriteFile(m_handle, "\n", 1, &written, nullptr);
+
+    DWORD written;
+    if (line_break)
+        WriteFile(m_handle, "\n", 1, &written, nullptr);
+}
+
+//------------------------------------------------------------------------------
+void write_lock::add(const char* line, unsigned int time)
+{
+    history_db::bank_format format = get_format();
+    if (format == history_db::bank_format_unknown)
+        return;
+
+    seek_end();
+    write_line(m_handle, format, line, time);
+}
+
+//------------------------------------------------------------------------------
+void write_lock::add(const std::vector<std::pair<const char*, unsigned int>>& lines)
+{
+    history_db::bank_format format = get_format();
+    if (format == history_db::bank_format_unknown)
+        return;
+
+    // Lines are gathered into blocks, for a write per block instead of one
+    // per line.
+    const unsigned int block_size = 0x10000;
+    char* block = (char*)malloc(block_size);
+    if (block == nullptr)
+        return;
+
+    DWORD written;
+    unsigned int used = 0;
+    seek_end();
+    for (const auto& line : lines)
+    {
+        unsigned int length = (unsigned int)strlen(line.first);
+        unsigned int size = get_line_size(format, length);
+        if (used + size > block_size)
+        {
+            WriteFile(m_handle, block, used, &written, nullptr);
+            used = 0;
+        }
+
+        if (size > block_size)
+        {
+            add(line.first, line.second);
+            continue;
+        }
+
+        format_line(format, line.first, length, line.second, block + used);
+        used += size;
+    }
+
+    WriteFile(m_handle, block, used, &written, nullptr);
+    free(block);
 }
 
 //------------------------------------------------------------------------------
 void write_lock::remove(line_id_impl id)
 {
     DWORD written;
-    SetFilePointer(m_handle, id.offset, nullptr, FILE_BEGIN);
-    WriteFile(m_handle, "|", 1, &written, nullptr);
+    switch (get_format())
+    {
+    case history_db::bank_format_text:
+        SetFilePointer(m_handle, id.offset, nullptr, FILE_BEGIN);
+        WriteFile(m_handle, "|", 1, &written, nullptr);
+        break;
+
+    case history_db::bank_format_binary:
+        {
+            unsigned short flags = record_deleted;
+            SetFilePointer(m_handle, id.offset + offsetof(record_header, flags), nullptr, FILE_BEGIN);
+            WriteFile(m_handle, &flags, sizeof(flags), &written, nullptr);
+        }
+        break;
+    }
 }
 
 //------------------------------------------------------------------------------
 void write_lock::append(const read_lock& src)
 {
+    char buffer[history_db::line_buffer_size];
+
+    // Text is copied as is.  Anything else goes line by line, converting it
+    // and leaving behind whatever doesn't check out.
+    if (get_format() != history_db::bank_format_text ||
+        src.get_format() != history_db::bank_format_text)
+    {
+        str_iter out;
+        read_lock::line_iter src_iter(src, buffer, sizeof_array(buffer));
+        src_iter.set_verify(true);
+        while (src_iter.next(out))
+        {
+            char* line = const_cast<char*>(out.get_pointer());
+            line[out.length()] = '\0';
+            add(line, src_iter.get_time());
+        }
+        return;
+    }
+
     DWORD written;
 
-    SetFilePointer(m_handle, 0, nullptr, FILE_END);
+    seek_end();
 
-    char buffer[history_db::max_line_length];
     read_lock::file_iter src_iter(src, buffer);
     while (int bytes_read = src_iter.next())
         WriteFile(m_handle, buffer, bytes_read, &written, nullptr);
 }
 
+//------------------------------------------------------------------------------
+bool write_lock::replace(const read_lock& src)
+{
+    unsigned int size = src.get_size();
+    char* buffer = (char*)malloc(max<unsigned int>(size, 2));
+    if (buffer == nullptr)
+        return false;
+
+    read_lock::file_iter src_iter(src, buffer, size);
+    if (size < 2 || src_iter.next() != size)
+    {
+        free(buffer);
+        return false;
+    }
+
+    // Other instances hold the bank open so it can't be renamed over, and is
+    // overwritten instead.  The first two bytes are written last; until then
+    // the bank has no ctag and reads as if it were text, which initialise()
+    // takes to mean the copy didn't finish.
+    DWORD written;
+    SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+    WriteFile(m_handle, "||", 2, &written, nullptr);
+    WriteFile(m_handle, buffer + 2, size - 2, &written, nullptr);
+    SetEndOfFile(m_handle);
+    SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+    WriteFile(m_handle, buffer, 2, &written, nullptr);
+
+    m_format_known = false;
+    free(buffer);
+    return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+// Adds lines under a shared lock; instances only wait on each other to remove
+// lines or rewrite a bank.  Lines are written through a handle that can only
+// append, so concurrent adds can't overwrite or interleave with each other.
+class append_lock
+    : public read_lock
+{
+public:
+    explicit        append_lock(void* handle, void* append_handle);
+    bool            add(const char* line, unsigned int* offset=nullptr);
+
+private:
+    void*           m_append_handle;
+};
+
+//------------------------------------------------------------------------------
+append_lock::append_lock(void* handle, void* append_handle)
+: read_lock(append_handle ? handle : nullptr)
+, m_append_handle(append_handle)
+{
+}
+
+//------------------------------------------------------------------------------
+bool append_lock::add(const char* line, unsigned int* offset)
+{
+    history_db::bank_format format = get_format();
+    if (format == history_db::bank_format_unknown)
+        return false;
+
+    // Readers leave an unterminated last line alone while this is held.
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = append_lock_offset;
+    overlapped.OffsetHigh = lock_offset_high;
+    LockFileEx(m_handle, 0, 0, 1, 0, &overlapped);
+
+    bool line_break = needs_line_break(m_handle, format);
+    bool ok = write_line(m_append_handle, format, line, 0, line_break);
+
+    UnlockFileEx(m_handle, 0, 1, 0, &overlapped);
+    if (!ok)
+        return false;
+
+    // The write moves the handle's file pointer to the end of the line.
+    if (offset)
+    {
+        unsigned int size = get_line_size(format, (unsigned int)strlen(line));
+        *offset = SetFilePointer(m_append_handle, 0, nullptr, FILE_CURRENT) - size;
+    }
+
+    return true;
+}
+
 
 
 //------------------------------------------------------------------------------
 class read_line_iter
 {
 public:
-                            read_line_iter(const history_db& db, unsigned int this_size);
+                            read_line_iter(const history_db& db, unsigned int this_size, bool reverse);
     history_db::line_id     next(str_iter& out);
 
 private:
@@ -566,14 +1392,17 @@ private:
     const history_db&       m_db;
     read_lock               m_lock;
     read_lock::line_iter    m_line_iter;
+    read_lock::reverse_line_iter m_reverse_iter;
     unsigned int            m_buffer_size;
     unsigned int            m_bank_index = 0;
+    bool                    m_reverse;
 };
 
 //------------------------------------------------------------------------------
-read_line_iter::read_line_iter(const history_db& db, unsigned int this_size)
+read_line_iter::read_line_iter(const history_db& db, unsigned int this_size, bool reverse)
 : m_db(db)
 , m_buffer_size(this_size - sizeof(*this))
+, m_reverse(reverse)
 {
     next_bank();
 }
@@ -581,15 +1410,29 @@ read_line_iter::read_line_iter(const history_db& db, unsigned int this_size)
 //------------------------------------------------------------------------------
 bool read_line_iter::next_bank()
 {
-    while (m_bank_index < sizeof_array(m_db.m_bank_handles))
+    // Reversed, the session bank's lines come first as they're the newest.
+    const unsigned int bank_count = sizeof_array(m_db.m_bank_handles);
+    while (m_bank_index < bank_count)
     {
         unsigned int bank_index = m_bank_index++;
+        if (m_reverse)
+            bank_index = bank_count - 1 - bank_index;
+
         if (void* bank_handle = m_db.m_bank_handles[bank_index])
         {
             char* buffer = (char*)(this + 1);
             m_lock.~read_lock();
             new (&m_lock) read_lock(bank_handle);
-            new (&m_line_iter) read_lock::line_iter(m_lock, buffer, m_buffer_size);
+            if (m_reverse)
+            {
+                m_reverse_iter.~reverse_line_iter();
+                new (&m_reverse_iter) read_lock::reverse_line_iter(m_lock, buffer, m_buffer_size);
+            }
+            else
+            {
+                m_line_iter.~line_iter();
+                new (&m_line_iter) read_lock::line_iter(m_lock, buffer, m_buffer_size);
+            }
             return true;
         }
     }
@@ -600,14 +1443,15 @@ bool read_line_iter::next_bank()
 //------------------------------------------------------------------------------
 history_db::line_id read_line_iter::next(str_iter& out)
 {
-    if (m_bank_index > sizeof_array(m_db.m_bank_handles))
+    const unsigned int bank_count = sizeof_array(m_db.m_bank_handles);
+    if (m_bank_index > bank_count)
         return 0;
 
     do
     {
-        if (line_id_impl ret = m_line_iter.next(out))
+        if (line_id_impl ret = m_reverse ? m_reverse_iter.prev(out) : m_line_iter.next(out))
         {
-            ret.bank_index = m_bank_index - 1;
+            ret.bank_index = m_reverse ? bank_count - m_bank_index : m_bank_index - 1;
             return ret.outer;
         }
     }
@@ -636,6 +1480,31 @@ history_db::line_id history_db::iter::next(str_iter& out)
 //------------------------------------------------------------------------------
 static bool extract_ctag(const read_lock& lock, concurrency_tag& tag)
 {
+    switch (lock.get_format())
+    {
+    case history_db::bank_format_text:
+        break;
+
+    case history_db::bank_format_binary:
+        {
+            bank_header header;
+            read_lock::file_iter iter(lock, (char*)&header, sizeof(header));
+            if (iter.next() != sizeof(header) || !header.ctag[0])
+            {
+                LOG("no ctag in header");
+                return false;
+            }
+
+            header.ctag[sizeof_array(header.ctag) - 1] = '\0';
+            tag.set(header.ctag);
+        }
+        return true;
+
+    default:
+        LOG("unknown bank format");
+        return false;
+    }
+
     char buffer[max_ctag_size];
     read_lock::file_iter iter(lock, buffer);
 
@@ -669,29 +1538,205 @@ static bool extract_ctag(const read_lock& lock, concurrency_tag& tag)
 }
 
 //------------------------------------------------------------------------------
-static void rewrite_master_bank(write_lock& lock, int max_line_length)
+static unsigned int get_ctag_hash(const read_lock& lock)
+{
+    concurrency_tag tag;
+    return extract_ctag(lock, tag) ? str_hash(tag.get()) : 0;
+}
+
+//------------------------------------------------------------------------------
+static void rewrite_master_bank(write_lock& lock, history_db::bank_format format)
+{
+    char* buffer = (char*)malloc(history_db::line_buffer_size);
+
+    // Read lines to keep into an arena; one allocation per block of lines
+    // rather than one per line.
+    str_iter out;
+    read_lock::line_iter iter(lock, buffer, history_db::line_buffer_size);
+    iter.set_verify(true);
+    arena store(0x10000);
+    std::vector<std::pair<const char*, unsigned int>> lines_to_keep;
+    while (iter.next(out))
+        lines_to_keep.emplace_back(store.store(out.get_pointer(), out.length()), iter.get_time());
+
+    // Clear and write new tag.
+    concurrency_tag tag;
+    tag.generate_new_tag();
+    lock.clear(format, tag.get());
+
+    // Write lines from vector.
+    lock.add(lines_to_keep);
+
+    free(buffer);
+}
+
+//------------------------------------------------------------------------------
+static void rewrite_master_bank(write_lock& lock)
+{
+    history_db::bank_format format = lock.get_format();
+    if (format != history_db::bank_format_unknown)
+        rewrite_master_bank(lock, format);
+}
+
+//------------------------------------------------------------------------------
+static void get_compact_path(const char* path, str_base& out)
+{
+    out = path;
+    out << ".compact";
+}
+
+//------------------------------------------------------------------------------
+static bool compact_master_bank(void* master_handle, void* compact_handle)
+{
+    // Only one instance compacts at a time; the others find the compacted
+    // bank already locked.
+    write_lock compact_lock(compact_handle, false);
+    if (!compact_lock)
+    {
+        LOG("compaction already in progress");
+        return false;
+    }
+
+    struct snapshot_line
+    {
+        const char*         line;
+        unsigned int        time;
+        unsigned int        offset;     // In the master bank.
+        unsigned int        new_offset; // In the compacted bank.
+    };
+
+    // Take a snapshot of the master bank's lines.  Other instances can still
+    // read it meanwhile.
+    concurrency_tag ctag;
+    history_db::bank_format format;
+    std::vector<snapshot_line> lines;
+    arena store(0x10000);
+    char* buffer = (char*)malloc(history_db::line_buffer_size);
+    {
+        read_lock lock(master_handle);
+        format = lock.get_format();
+        if (!lock || format == history_db::bank_format_unknown || !extract_ctag(lock, ctag))
+        {
+            free(buffer);
+            return false;
+        }
+
+        str_iter out;
+        read_lock::line_iter iter(lock, buffer, history_db::line_buffer_size);
+        iter.set_verify(true);
+        while (line_id_impl id = iter.next(out))
+        {
+            const char* line = store.store(out.get_pointer(), out.length());
+            lines.push_back({ line, iter.get_time(), id.offset, 0 });
+        }
+    }
+
+    // Write the compacted bank without holding the master bank's lock.
+    concurrency_tag new_ctag;
+    new_ctag.generate_new_tag();
+    compact_lock.clear(format, new_ctag.get());
+
+    unsigned int offset = compact_lock.get_size();
+    std::vector<std::pair<const char*, unsigned int>> lines_to_write;
+    for (auto& line : lines)
+    {
+        line.new_offset = offset;
+        offset += get_line_size(format, (unsigned int)strlen(line.line));
+        lines_to_write.emplace_back(line.line, line.time);
+    }
+    compact_lock.add(lines_to_write);
+
+    // Now lock the master bank, and catch up with what's changed since the
+    // snapshot:  lines removed from it are removed from the compacted bank too,
+    // and lines added since are appended.  Anything else (e.g. another
+    // instance has compacted or cleared the master bank) changes the ctag.
+    bool ok = false;
+    {
+        write_lock lock(master_handle);
+        concurrency_tag check;
+        if (lock && extract_ctag(lock, check) && strcmp(check.get(), ctag.get()) == 0)
+        {
+            str_iter out;
+            size_t i = 0;
+            read_lock::line_iter iter(lock, buffer, history_db::line_buffer_size);
+            while (line_id_impl id = iter.next(out))
+            {
+                for (; i < lines.size() && lines[i].offset < id.offset; ++i)
+                    compact_lock.remove(line_id_impl(lines[i].new_offset));
+
+                if (i < lines.size() && lines[i].offset == id.offset)
+                {
+                    ++i;
+                    continue;
+                }
+
+                char* line = const_cast<char*>(out.get_pointer());
+                line[out.length()] = '\0';
+                compact_lock.add(line, iter.get_time());
+            }
+
+            for (; i < lines.size(); ++i)
+                compact_lock.remove(line_id_impl(lines[i].new_offset));
+
+            ok = lock.replace(compact_lock);
+        }
+    }
+
+    free(buffer);
+    LOG("compaction %s; %d lines", ok ? "succeeded" : "abandoned", int(lines.size()));
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+static bool compact_master_bank(const char* path)
 {
-    max_line_length++;
-    char* buffer = (char*)malloc(max_line_length);
+    str<280> compact_path;
+    get_compact_path(path, compact_path);
 
-    // Read lines to keep into vector.
-    str_iter out;
-    read_lock::line_iter iter(lock, buffer, max_line_length);
-    std::vector<auto_free_str> lines_to_keep;
-    while (iter.next(out))
-        lines_to_keep.push_back(std::move(auto_free_str(out.get_pointer(), out.length())));
+    void* master_handle = open_file(path);
+    void* compact_handle = open_file(compact_path.c_str());
 
-    // Clear and write new tag.
-    concurrency_tag tag;
-    tag.generate_new_tag();
-    lock.clear();
-    lock.add(tag.get());
+    bool ok = false;
+    if (master_handle && compact_handle)
+        ok = compact_master_bank(master_handle, compact_handle);
 
-    // Write lines from vector.
-    for (auto const& line : lines_to_keep)
-        lock.add(line.get());
+    CloseHandle(master_handle);
+    CloseHandle(compact_handle);
 
-    free(buffer);
+    // This fails if another instance has the compacted bank open, which is
+    // as it should be.
+    os::unlink(compact_path.c_str());
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+static void recover_master_bank(const char* path, void* master_handle)
+{
+    str<280> compact_path;
+    get_compact_path(path, compact_path);
+    if (os::get_path_type(compact_path.c_str()) != os::path_type_file)
+        return;
+
+    // A compacted bank that's left over and not locked by an instance that's
+    // compacting means one didn't finish.  If it didn't finish replacing the
+    // master bank then the master bank has no ctag, and the copy's redone.
+    void* compact_handle = open_file(compact_path.c_str());
+    {
+        write_lock compact_lock(compact_handle, false);
+        if (compact_lock)
+        {
+            concurrency_tag tag;
+            write_lock lock(master_handle);
+            if (lock && !extract_ctag(lock, tag) && extract_ctag(compact_lock, tag))
+            {
+                LOG("recovering master bank from %s", compact_path.c_str());
+                lock.replace(compact_lock);
+            }
+        }
+    }
+    CloseHandle(compact_handle);
+
+    os::unlink(compact_path.c_str());
 }
 
 //------------------------------------------------------------------------------
@@ -721,8 +1766,7 @@ static void migrate_history(const char* path)
             // Clear and write new tag.
             concurrency_tag tag;
             tag.generate_new_tag();
-            lock.clear();
-            lock.add(tag.get());
+            lock.clear(history_db::bank_format_text, tag.get());
 
             // Copy old history.
             int buffer_size = 8192;
@@ -749,10 +1793,87 @@ static void migrate_history(const char* path)
 
 
 
+//------------------------------------------------------------------------------
+static void fold_session_bank(void* session_handle, void* master_handle)
+{
+    // The session bank's emptied while the master bank's still locked, so an
+    // instance that folds it again after this doesn't add its lines twice.
+    write_lock src(session_handle);
+    write_lock dest(master_handle);
+    if (src && dest && src.get_size() > 0)
+    {
+        dest.append(src);
+        src.clear(history_db::bank_format_text);
+    }
+}
+
+//------------------------------------------------------------------------------
+static bool reap_session(const char* path, void* master_handle)
+{
+    // Abandoned alive files will unlink; those of live sessions won't.
+    str<280> alive_path(path);
+    alive_path << "~";
+    if (os::get_path_type(alive_path.c_str()) == os::path_type_file)
+        if (!os::unlink(alive_path.c_str()))
+            return false;
+
+    if (os::get_path_type(path) == os::path_type_file)
+    {
+        void* session_handle = open_file(path);
+        fold_session_bank(session_handle, master_handle);
+        CloseHandle(session_handle);
+        os::unlink(path);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static void reap_sessions(const char* path, const std::vector<int>& ids, bool sweep, history_sessions& sessions)
+{
+    void* master_handle = open_file(path);
+    if (master_handle == nullptr)
+        return;
+
+    str<280> session_path;
+    for (int id : ids)
+    {
+        session_path.format("%s_%d", path, id);
+        if (reap_session(session_path.c_str(), master_handle))
+            sessions.remove(id);
+    }
+
+    // Sessions that aren't registered (e.g. they're from an older version)
+    // are only found by looking through the directory.
+    if (sweep)
+    {
+        str<280> pattern(path);
+        pattern << "_*";
+
+        int id_offset = pattern.length() - 1;
+        for (globber i(pattern.c_str()); i.next(session_path);)
+        {
+            if (session_path.c_str()[session_path.length() - 1] == '~')
+            {
+                os::unlink(session_path.c_str());
+                continue;
+            }
+
+            if (reap_session(session_path.c_str(), master_handle))
+                sessions.remove(atoi(session_path.c_str() + id_offset));
+        }
+    }
+
+    CloseHandle(master_handle);
+}
+
+
+
 //------------------------------------------------------------------------------
 history_db::history_db()
 {
     memset(m_bank_handles, 0, sizeof(m_bank_handles));
+    memset(m_append_handles, 0, sizeof(m_append_handles));
     m_master_len = 0;
     m_master_deleted_count = 0;
 
@@ -767,55 +1888,109 @@ history_db::history_db()
 
     history_inhibit_expansion_function = history_expand_control;
 
+    s_search_index = &m_search_index;
+    history_search_candidate_function = history_search_control;
+    history_replace_hook = history_replace_control;
+
     static_assert(sizeof(line_id) == sizeof(line_id_impl), "");
 }
 
 //------------------------------------------------------------------------------
 history_db::~history_db()
 {
+    if (s_search_index == &m_search_index)
+    {
+        history_search_candidate_function = nullptr;
+        history_replace_hook = nullptr;
+        s_search_index = nullptr;
+    }
+
+    wait_for_compact();
+    wait_for_reap();
+
+    // Fold this session's bank into the master bank while the alive file
+    // still keeps other instances from doing so.
+    if (m_bank_handles[bank_session] != nullptr)
+        fold_session_bank(m_bank_handles[bank_session], m_bank_handles[bank_master]);
+
     // Close alive handle
     CloseHandle(m_alive_file);
 
-    // Close all but the master bank. We're going to append to the master one.
-    for (int i = 1; i < sizeof_array(m_bank_handles); ++i)
-        CloseHandle(m_bank_handles[i]);
+    for (int i = 0; i < sizeof_array(m_append_handles); ++i)
+        CloseHandle(m_append_handles[i]);
 
-    reap();
+    for (int i = 0; i < sizeof_array(m_bank_handles); ++i)
+        CloseHandle(m_bank_handles[i]);
 
-    CloseHandle(m_bank_handles[bank_master]);
+    if (m_bank_handles[bank_session] != nullptr)
+    {
+        str<280> path;
+        get_file_path(path, true);
+        os::unlink(path.c_str());
+        m_sessions.remove(app_context::get()->get_id());
+    }
 }
 
 //------------------------------------------------------------------------------
-void history_db::reap()
+void history_db::reap(bool force)
 {
-    // Fold each session found that has no valid alive file.
+    // Orphaned session banks are checked for now and then rather than every
+    // time an instance starts, and on a thread so it needn't wait for them.
+    std::vector<int> ids;
+    bool sweep;
+    if (!m_sessions.get_due(force, ids, sweep))
+        return;
+
+    ids.erase(std::remove(ids.begin(), ids.end(), app_context::get()->get_id()), ids.end());
+    if (ids.empty() && !sweep)
+        return;
+
+    wait_for_reap();
+
     str<280> path;
     get_file_path(path, false);
-    path << "_*";
 
-    for (globber i(path.c_str()); i.next(path);)
+    if (m_background_reap && !force)
     {
-        path << "~";
-        if (os::get_path_type(path.c_str()) == os::path_type_file)
-            if (!os::unlink(path.c_str())) // abandoned alive files will unlink
-                continue;
-
-        path.truncate(path.length() - 1);
-
-        int file_size = os::get_file_size(path.c_str());
-        if (file_size > 0)
+        struct reap_params
         {
-            void* src_handle = open_file(path.c_str());
-            {
-                read_lock src(src_handle);
-                write_lock dest(m_bank_handles[bank_master]);
-                if (src && dest)
-                    dest.append(src);
-            }
-            CloseHandle(src_handle);
-        }
+            str<280>            path;
+            std::vector<int>    ids;
+            bool                sweep;
+            history_sessions*   sessions;
+        };
+
+        auto thread = [] (void* param) -> DWORD {
+            reap_params* params = (reap_params*)param;
+            reap_sessions(params->path.c_str(), params->ids, params->sweep, *params->sessions);
+            delete params;
+            return 0;
+        };
+
+        reap_params* param = new reap_params;
+        param->path = path.c_str();
+        param->ids = std::move(ids);
+        param->sweep = sweep;
+        param->sessions = &m_sessions;
+        m_reap_thread = CreateThread(nullptr, 0, thread, param, 0, nullptr);
+        if (m_reap_thread)
+            return;
+
+        ids = std::move(param->ids);
+        delete param;
+    }
 
-        os::unlink(path.c_str());
+    reap_sessions(path.c_str(), ids, sweep, m_sessions);
+}
+
+//------------------------------------------------------------------------------
+void history_db::wait_for_reap()
+{
+    if (m_reap_thread)
+    {
+        WaitForSingleObject(m_reap_thread, INFINITE);
+        CloseHandle(m_reap_thread);
+        m_reap_thread = nullptr;
     }
 }
 
@@ -834,12 +2009,16 @@ void history_db::initialise()
 
     // Open the master bank file.
     m_bank_handles[bank_master] = open_file(path.c_str());
+    m_append_handles[bank_master] = open_append_file(path.c_str());
+    recover_master_bank(path.c_str(), m_bank_handles[bank_master]);
 
     // Retrieve concurrency tag from start of master bank.
     m_master_ctag.clear();
+    bank_format master_format;
     {
         read_lock lock(m_bank_handles[bank_master], false);
         extract_ctag(lock, m_master_ctag);
+        master_format = lock.get_format();
     }
 
     // No concurrency tag?  Inject one.
@@ -848,17 +2027,34 @@ void history_db::initialise()
         write_lock lock(m_bank_handles[bank_master]);
         if (!extract_ctag(lock, m_master_ctag))
         {
-            rewrite_master_bank(lock, max_line_length);
+            rewrite_master_bank(lock);
             extract_ctag(lock, m_master_ctag);
         }
     }
     LOG("master bank ctag: %s", m_master_ctag.get());
 
+    m_sessions.open(path.c_str());
+
     if (g_shared.get())
+    {
+        if (g_share_memory.get())
+            m_share.open(path.c_str());
+        reap();
         return;
+    }
 
     get_file_path(path, true);
     m_bank_handles[bank_session] = open_file(path.c_str());
+    m_append_handles[bank_session] = open_append_file(path.c_str());
+    m_sessions.add(app_context::get()->get_id());
+
+    // A new session bank takes the master bank's format.
+    if (master_format == bank_format_binary)
+    {
+        write_lock lock(m_bank_handles[bank_session]);
+        if (lock && !GetFileSize(m_bank_handles[bank_session], nullptr))
+            lock.clear(master_format);
+    }
 
     reap(); // collects orphaned history files.
 }
@@ -900,15 +2096,86 @@ template <typename T> void history_db::for_each_bank(T&& callback) const
     }
 }
 
+//------------------------------------------------------------------------------
+struct loaded_line
+{
+    const char*             line;
+    unsigned int            length;
+    unsigned int            hash;
+    history_db::line_id     id;
+    bool                    dupe;
+};
+
+//------------------------------------------------------------------------------
+static unsigned int mark_dupes(std::vector<loaded_line>& lines, bool keep_oldest)
+{
+    // Walks from the copy that's kept towards the others, through an open
+    // addressed table of the indices of lines seen so far.  str_hash() leaves
+    // similar lines' hashes differing mostly in their low bits, so they're
+    // scattered first.
+    int bits = 4;
+    while ((1u << bits) < lines.size() * 2)
+        ++bits;
+
+    unsigned int mask = (1u << bits) - 1;
+    std::vector<unsigned int> table(mask + 1, 0); // Index + 1, or 0 if empty.
+
+    unsigned int dupes = 0;
+    unsigned int count = (unsigned int)lines.size();
+    for (unsigned int n = 0; n < count; ++n)
+    {
+        unsigned int i = keep_oldest ? n : count - 1 - n;
+        loaded_line& line = lines[i];
+        unsigned int slot = (line.hash * 0x9e3779b9u) >> (32 - bits);
+        for (;; slot = (slot + 1) & mask)
+        {
+            if (!table[slot])
+            {
+                table[slot] = i + 1;
+                break;
+            }
+
+            const loaded_line& kept = lines[table[slot] - 1];
+            if (kept.hash == line.hash &&
+                kept.length == line.length &&
+                memcmp(kept.line, line.line, line.length) == 0)
+            {
+                line.dupe = true;
+                ++dupes;
+                break;
+            }
+        }
+    }
+
+    return dupes;
+}
+
 //------------------------------------------------------------------------------
 void history_db::load_internal()
 {
     clear_history();
     m_index_map.clear();
+    m_search_index.clear();
+    m_suggest_index.clear();
+    m_suggest_count = 0;
     m_master_len = 0;
     m_master_deleted_count = 0;
+    m_master_end = 0;
+    m_dupe_ids.clear();
+
+    // Changes published from here on may or may not be in what's read, and
+    // are checked against it next time.
+    m_share_seq = m_share.get_next_seq();
 
-    char buffer[max_line_length];
+    // Lines are gathered first when deduplicating; which copy of a line is
+    // the most recent isn't known until they've all been read.  Like adding
+    // lines, 'ignore' keeps the oldest copy and 'erase_prev' the newest.
+    int dupe_mode = g_dupe_mode.get();
+    bool dedupe = (dupe_mode != 0);
+    std::vector<loaded_line> lines;
+    arena store(0x10000);
+
+    char buffer[line_buffer_size];
 
     const history_db& const_this = *this;
     const_this.for_each_bank([&] (unsigned int bank_index, const read_lock& lock)
@@ -924,12 +2191,23 @@ void history_db::load_internal()
         line_id_impl id;
         while (id = iter.next(out))
         {
-            const char* line = out.get_pointer();
-            int buffer_offset = int(line - buffer);
-            buffer[buffer_offset + out.length()] = '\0';
-            add_history(line);
-
+            // The line iterator always leaves room after a line to terminate
+            // it (it may not be in 'buffer' if the line was a long one).
+            char* line = const_cast<char*>(out.get_pointer());
+            line[out.length()] = '\0';
             id.bank_index = bank_index;
+
+            if (dedupe)
+            {
+                unsigned int length = out.length();
+                bool binary = (lock.get_format() == bank_format_binary);
+                unsigned int hash = binary ? iter.get_hash() : str_hash(line, length);
+                if (const char* stored = store.store(line, length))
+                    lines.push_back({ stored, length, hash, id.outer, false });
+                continue;
+            }
+
+            add_history(line);
             m_index_map.push_back(id.outer);
             if (bank_index == bank_master)
             {
@@ -939,23 +2217,167 @@ void history_db::load_internal()
         }
 
         if (bank_index == bank_master)
+        {
             m_master_deleted_count = iter.get_deleted_count();
+            m_master_end = iter.get_end_offset();
+        }
+
+        return true;
+    });
+
+    if (lines.empty())
+        return;
+
+    if (mark_dupes(lines, dupe_mode == 1))
+        LOG("History:  skipped duplicates");
+
+    for (const auto& line : lines)
+    {
+        if (line.dupe)
+        {
+            m_dupe_ids.push_back(line.id);
+            continue;
+        }
+
+        add_history(line.line);
+        m_index_map.push_back(line.id);
+
+        line_id_impl id;
+        id.outer = line.id;
+        if (id.bank_index == bank_master)
+            m_master_len = m_index_map.size();
+    }
+}
+
+//------------------------------------------------------------------------------
+void history_db::erase_dupes()
+{
+    if (m_dupe_ids.empty() || !g_erase_dupes.get())
+        return;
+
+    // The ids were read under another lock; the master bank's ctag says
+    // whether they're still valid.
+    for_each_bank([&] (unsigned int bank_index, write_lock& lock)
+    {
+        unsigned int ctag_hash = 0;
+        if (bank_index == bank_master)
+        {
+            concurrency_tag tag;
+            if (!extract_ctag(lock, tag) || strcmp(tag.get(), m_master_ctag.get()) != 0)
+                return true;
+            ctag_hash = str_hash(tag.get());
+        }
+
+        for (line_id id : m_dupe_ids)
+        {
+            line_id_impl id_impl;
+            id_impl.outer = id;
+            if (id_impl.bank_index != bank_index)
+                continue;
+
+            lock.remove(id_impl);
+            if (bank_index == bank_master)
+            {
+                ++m_master_deleted_count;
+                m_share.publish(history_share::entry_remove, "", id_impl.offset, ctag_hash);
+            }
+        }
 
         return true;
     });
+
+    LOG("History:  erased %u duplicates", (unsigned int)m_dupe_ids.size());
+    m_dupe_ids.clear();
+}
+
+//------------------------------------------------------------------------------
+bool history_db::load_shared()
+{
+    // Catching up is only possible with everything read up to m_master_end,
+    // and only the master bank.
+    if (!m_share.is_open() || m_master_ctag.empty() || m_index_map.size() != m_master_len)
+        return false;
+
+    read_lock lock(get_bank(bank_master));
+    if (!lock)
+        return false;
+
+    concurrency_tag ctag;
+    if (!extract_ctag(lock, ctag) || strcmp(ctag.get(), m_master_ctag.get()) != 0)
+        return false;
+
+    std::vector<history_share::entry> entries;
+    std::vector<char> store;
+    if (!m_share.consume(m_share_seq, entries, store))
+        return false;
+
+    // Changes already in what was read are skipped.  Anything else has to
+    // follow on exactly from it.
+    bank_format format = lock.get_format();
+    unsigned int ctag_hash = str_hash(m_master_ctag.get());
+    for (const auto& entry : entries)
+    {
+        if (entry.ctag_hash != ctag_hash)
+            return false;
+
+        if (entry.type == history_share::entry_add)
+        {
+            if (entry.offset < m_master_end)
+                continue;
+            if (entry.offset > m_master_end)
+                return false;
+
+            add_history(entry.line);
+            m_index_map.push_back(line_id_impl(entry.offset).outer);
+            m_master_len = m_index_map.size();
+            m_master_end += get_line_size(format, entry.length);
+            continue;
+        }
+
+        if (entry.offset >= m_master_end)
+            return false;
+
+        line_id id = line_id_impl(entry.offset).outer;
+        auto nth = std::lower_bound(m_index_map.begin(), m_index_map.end(), id);
+        if (nth == m_index_map.end() || *nth != id)
+            continue;
+
+        int index = int(nth - m_index_map.begin());
+        HIST_ENTRY* hist = remove_history(index);
+        if (hist == nullptr)
+            return false;
+
+        m_search_index.remove(index);
+        if (index < m_suggest_count)
+        {
+            m_suggest_index.remove(hist->line);
+            --m_suggest_count;
+        }
+        free_history_entry(hist);
+
+        m_index_map.erase(nth);
+        m_master_len = m_index_map.size();
+        ++m_master_deleted_count;
+    }
+
+    // Lines that weren't published (e.g. by instances that don't share memory,
+    // or were too long for it) mean reading the bank after all.
+    return (lock.get_size() <= m_master_end);
 }
 
 //------------------------------------------------------------------------------
 void history_db::load_rl_history(bool can_clean)
 {
-    load_internal();
+    if (!load_shared())
+        load_internal();
 
     // The `clink history` command needs to be able to avoid cleaning the master
     // history file.
     if (can_clean)
     {
-        compact();
-        load_internal();
+        erase_dupes();
+        if (compact())
+            load_internal();
     }
 }
 
@@ -964,24 +2386,29 @@ void history_db::clear()
 {
     for_each_bank([&] (unsigned int bank_index, write_lock& lock)
     {
-        lock.clear();
         if (bank_index == bank_master)
         {
             m_master_ctag.clear();
             m_master_ctag.generate_new_tag();
-            lock.add(m_master_ctag.get());
+            lock.clear(m_master_ctag.get());
         }
+        else
+            lock.clear();
         return true;
     });
 
     m_index_map.clear();
+    m_search_index.clear();
+    m_suggest_index.clear();
+    m_suggest_count = 0;
     m_master_len = 0;
     m_master_deleted_count = 0;
 }
 
 //------------------------------------------------------------------------------
-void history_db::compact(bool force)
+bool history_db::compact(bool force)
 {
+    int removed = 0;
     size_t limit = get_max_history();
     if (limit > 0)
     {
@@ -991,7 +2418,6 @@ void history_db::compact(bool force)
         // deleted; compacting is a separate operation.
         if (m_master_len > limit)
         {
-            int removed = 0;
             while (m_master_len > limit)
             {
                 line_id_impl id;
@@ -1018,14 +2444,72 @@ void history_db::compact(bool force)
     size_t threshold = (force ? 0 :
                         limit ? max(limit, m_min_compact_threshold) :
                         2500);
-    if (m_master_deleted_count > threshold)
+    if (m_master_deleted_count <= threshold)
+        return (removed > 0);
+
+    str<280> path;
+    get_file_path(path, false);
+
+    // Compacting happens on a thread so the prompt needn't wait for it.  The
+    // ctag changes when it's done, and the next load picks that up.
+    if (m_compact_thread && (force || WaitForSingleObject(m_compact_thread, 0) == WAIT_OBJECT_0))
+        wait_for_compact();
+
+    if (m_compact_thread)
+        return (removed > 0);
+
+    if (m_background_compact && !force)
     {
-        write_lock lock(m_bank_handles[bank_master]);
-        rewrite_master_bank(lock, max_line_length);
-        LOG("Compacted history:  %u active, %u deleted", m_master_len, m_master_deleted_count);
+        auto thread = [] (void* param) -> DWORD {
+            str<280>* path = (str<280>*)param;
+            compact_master_bank(path->c_str());
+            delete path;
+            return 0;
+        };
+
+        str<280>* param = new str<280>();
+        *param = path.c_str();
+        m_compact_thread = CreateThread(nullptr, 0, thread, param, 0, nullptr);
+        if (m_compact_thread)
+            return (removed > 0);
+
+        delete param;
+    }
+
+    compact_master_bank(path.c_str());
+    LOG("Compacted history:  %u active, %u deleted", m_master_len, m_master_deleted_count);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void history_db::wait_for_compact()
+{
+    if (m_compact_thread)
+    {
+        WaitForSingleObject(m_compact_thread, INFINITE);
+        CloseHandle(m_compact_thread);
+        m_compact_thread = nullptr;
     }
 }
 
+//------------------------------------------------------------------------------
+bool history_db::convert(bank_format format)
+{
+    if (format == bank_format_unknown)
+        return false;
+
+    write_lock lock(get_bank(bank_master));
+    if (!lock || lock.get_format() == bank_format_unknown)
+        return false;
+
+    // Rewriting gives the bank a new ctag, so other instances reload it before
+    // relying on anything they've remembered about it.
+    rewrite_master_bank(lock, format);
+
+    m_master_ctag.clear();
+    return extract_ctag(lock, m_master_ctag);
+}
+
 //------------------------------------------------------------------------------
 bool history_db::add(const char* line)
 {
@@ -1033,6 +2517,10 @@ bool history_db::add(const char* line)
     if (!line[0] || (g_ignore_space.get() && (line[0] == ' ' || line[0] == '\t')))
         return false;
 
+    // A line's a use even if it's a duplicate the history doesn't keep.
+    if (m_frecency)
+        m_frecency->add(frecency_db::kind_command, line);
+
     // Handle duplicates.
     switch (g_dupe_mode.get())
     {
@@ -1049,8 +2537,21 @@ bool history_db::add(const char* line)
     }
 
     // Add the line.
-    void* handle = get_bank(get_active_bank());
-    write_lock lock(handle);
+    unsigned int bank = get_active_bank();
+    {
+        append_lock lock(get_bank(bank), m_append_handles[bank]);
+        unsigned int offset;
+        if (lock && lock.add(line, &offset))
+        {
+            if (bank == bank_master && m_share.is_open())
+                m_share.publish(history_share::entry_add, line, offset, get_ctag_hash(lock));
+            return true;
+        }
+    }
+
+    // Appending can be refused, e.g. by an older Clink that locks the whole
+    // bank to read it.  Writing under an exclusive lock waits that out.
+    write_lock lock(get_bank(bank));
     if (!lock)
         return false;
 
@@ -1062,13 +2563,18 @@ bool history_db::add(const char* line)
 int history_db::remove(const char* line)
 {
     int count = 0;
-    for_each_bank([line, &count] (unsigned int index, write_lock& lock)
+    for_each_bank([this, line, &count] (unsigned int index, write_lock& lock)
     {
+        bool publish = (index == bank_master && m_share.is_open());
+        unsigned int ctag_hash = publish ? get_ctag_hash(lock) : 0;
+
         lock.find(line, [&] (line_id_impl id) {
             // The line id was retrieved inside this lock scope, so it's still
             // valid; no need to guard the ctag.
             lock.remove(id);
             count++;
+            if (publish)
+                m_share.publish(history_share::entry_remove, "", id.offset, ctag_hash);
             return true;
         });
 
@@ -1115,6 +2621,9 @@ bool history_db::remove_internal(line_id id, bool guard_ctag)
 
     lock.remove(id_impl);
 
+    if (id_impl.bank_index == bank_master && m_share.is_open())
+        m_share.publish(history_share::entry_remove, "", id_impl.offset, get_ctag_hash(lock));
+
     if (id_impl.bank_index == bank_master)
     {
         auto last = m_index_map.begin() + m_master_len;
@@ -1144,6 +2653,14 @@ bool history_db::remove_internal(line_id id, bool guard_ctag)
 //------------------------------------------------------------------------------
 bool history_db::remove(int rl_history_index, const char* line)
 {
+    // Readline's already removed the line from its list.
+    m_search_index.remove(rl_history_index);
+    if (rl_history_index >= 0 && rl_history_index < m_suggest_count)
+    {
+        m_suggest_index.remove(line);
+        --m_suggest_count;
+    }
+
     if (rl_history_index < 0 || size_t(rl_history_index) >= m_index_map.size())
         return false;
 
@@ -1156,7 +2673,7 @@ bool history_db::remove(int rl_history_index, const char* line)
         assert(lock);
 
         str_iter out;
-        char buffer[max_line_length];
+        char buffer[line_buffer_size];
         read_lock::line_iter iter(lock, buffer, sizeof_array(buffer));
 
         iter.set_file_offset(id_impl.offset);
@@ -1187,6 +2704,26 @@ history_db::line_id history_db::find(const char* line) const
     return ret.outer;
 }
 
+//------------------------------------------------------------------------------
+const char* history_db::suggest(const char* line)
+{
+    // Like the search index, this is built from Readline's list on first use
+    // and catches up with lines added to it since, and is rebuilt when a
+    // stifled history drops lines.
+    if (m_suggest_count > history_length || m_suggest_base != history_base)
+    {
+        m_suggest_index.clear();
+        m_suggest_count = 0;
+        m_suggest_base = history_base;
+    }
+
+    HIST_ENTRY** list = history_list();
+    for (; m_suggest_count < history_length; ++m_suggest_count)
+        m_suggest_index.add(list[m_suggest_count]->line);
+
+    return m_suggest_index.find(line);
+}
+
 //------------------------------------------------------------------------------
 history_db::expand_result history_db::expand(const char* line, str_base& out)
 {
@@ -1206,7 +2743,17 @@ history_db::iter history_db::read_lines(char* buffer, unsigned int size)
 {
     iter ret;
     if (size > sizeof(read_line_iter))
-        ret.impl = uintptr_t(new (buffer) read_line_iter(*this, size));
+        ret.impl = uintptr_t(new (buffer) read_line_iter(*this, size, false));
+
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+history_db::iter history_db::read_lines_reverse(char* buffer, unsigned int size)
+{
+    iter ret;
+    if (size > sizeof(read_line_iter))
+        ret.impl = uintptr_t(new (buffer) read_line_iter(*this, size, true));
 
     return ret;
 }
@@ -3,10 +3,17 @@
 
 #pragma once
 
+#include "history_index.h"
+#include "history_prefix_index.h"
+#include "history_sessions.h"
+#include "history_share.h"
+
 #include <core/str_iter.h>
 
 #include <vector>
 
+class frecency_db;
+
 //------------------------------------------------------------------------------
 class concurrency_tag
 {
@@ -39,7 +46,14 @@ public:
         expand_print            = 2,
     };
 
-    static const unsigned int   max_line_length = 8192;
+    enum bank_format : unsigned char
+    {
+        bank_format_text,
+        bank_format_binary,
+        bank_format_unknown,    // A newer binary version than this reads.
+    };
+
+    static const unsigned int   line_buffer_size = 8192;
     typedef unsigned int        line_id;
 
     class iter
@@ -59,14 +73,19 @@ public:
     void                        initialise();
     void                        load_rl_history(bool can_clean=true);
     void                        clear();
-    void                        compact(bool force=false);
+    bool                        compact(bool force=false);
+    bool                        convert(bank_format format);
     bool                        add(const char* line);
+    void                        set_frecency(frecency_db* frecency) { m_frecency = frecency; }
     int                         remove(const char* line);
     bool                        remove(line_id id) { return remove_internal(id, true); }
     bool                        remove(int rl_history_index, const char* line);
     line_id                     find(const char* line) const;
+    const char*                 suggest(const char* line);
     template <int S> iter       read_lines(char (&buffer)[S]);
     iter                        read_lines(char* buffer, unsigned int buffer_size);
+    template <int S> iter       read_lines_reverse(char (&buffer)[S]);
+    iter                        read_lines_reverse(char* buffer, unsigned int buffer_size);
 
     static expand_result        expand(const char* line, str_base& out);
 
@@ -81,7 +100,11 @@ private:
 
     friend                      class read_line_iter;
     void                        load_internal();
-    void                        reap();
+    bool                        load_shared();
+    void                        erase_dupes();
+    void                        reap(bool force=false);
+    void                        wait_for_reap();
+    void                        wait_for_compact();
     template <typename T> void  for_each_bank(T&& callback);
     template <typename T> void  for_each_bank(T&& callback) const;
     unsigned int                get_active_bank() const;
@@ -89,12 +112,28 @@ private:
     bool                        remove_internal(line_id id, bool guard_ctag);
     void*                       m_alive_file;
     void*                       m_bank_handles[bank_count];
+    void*                       m_append_handles[bank_count];
     concurrency_tag             m_master_ctag;
     std::vector<line_id>        m_index_map;
+    std::vector<line_id>        m_dupe_ids;         // Older copies skipped by load_internal().
+    history_index               m_search_index;
+    history_prefix_index        m_suggest_index;
+    int                         m_suggest_count = 0;
+    int                         m_suggest_base = 0;
     size_t                      m_master_len;
     size_t                      m_master_deleted_count;
+    unsigned int                m_master_end = 0;   // Where reading the master bank stopped.
+    history_share               m_share;
+    unsigned int                m_share_seq = 0;    // Next change to catch up on.
+    frecency_db*                m_frecency = nullptr;
+
+    history_sessions            m_sessions;
+    void*                       m_reap_thread = nullptr;
+    bool                        m_background_reap = true;
 
     size_t                      m_min_compact_threshold = 200;
+    void*                       m_compact_thread = nullptr;
+    bool                        m_background_compact = true;
 };
 
 //------------------------------------------------------------------------------
@@ -102,3 +141,9 @@ template <int S> history_db::iter history_db::read_lines(char (&buffer)[S])
 {
     return read_lines(buffer, S);
 }
+
+//------------------------------------------------------------------------------
+template <int S> history_db::iter history_db::read_lines_reverse(char (&buffer)[S])
+{
+    return read_lines_reverse(buffer, S);
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "history_index.h"
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+static bool get_trigram(const char* in, bool case_fold, unsigned int& out)
+{
+    out = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        unsigned char c = in[i];
+        if (c == '\0' || c >= 0x80)
+            return false;
+
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+
+        // Case folded searches compare with towlower(), which also maps some
+        // non-ASCII characters (e.g. KELVIN SIGN) onto 'i' and 'k'.  Lines
+        // with those wouldn't share the trigram so it can't rule them out.
+        if (case_fold && (c == 'i' || c == 'k'))
+            return false;
+
+        out = (out << 8) | c;
+    }
+
+    return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+void history_index::clear()
+{
+    m_postings.clear();
+    m_removed.clear();
+    m_count = 0;
+}
+
+//------------------------------------------------------------------------------
+void history_index::add(const char* line)
+{
+    add_trigrams(m_count++, line, false);
+}
+
+//------------------------------------------------------------------------------
+void history_index::replace(int position, const char* line)
+{
+    // The old line's trigrams are left in place; they can only cause extra
+    // candidates, never missed ones.
+    if (position >= 0 && position < size())
+        add_trigrams(get_id(position), line, true);
+}
+
+//------------------------------------------------------------------------------
+void history_index::remove(int position)
+{
+    if (position < 0 || position >= size())
+        return;
+
+    unsigned int id = get_id(position);
+    m_removed.insert(std::lower_bound(m_removed.begin(), m_removed.end(), id), id);
+}
+
+//------------------------------------------------------------------------------
+int history_index::find(const char* needle, int from, int direction, bool case_fold) const
+{
+    if (from < 0 || from >= size())
+        return -1;
+
+    // Gather the postings for each of the needle's trigrams.  A trigram no
+    // line has means nothing matches.
+    std::vector<const postings*> lists;
+    for (; needle[0] && needle[1] && needle[2]; ++needle)
+    {
+        unsigned int trigram;
+        if (!get_trigram(needle, case_fold, trigram))
+            continue;
+
+        auto iter = m_postings.find(trigram);
+        if (iter == m_postings.end())
+            return -1;
+
+        lists.push_back(&iter->second);
+    }
+
+    if (lists.empty())
+        return from;
+
+    // Walk the shortest list and probe the others.
+    std::sort(lists.begin(), lists.end(), [] (const postings* a, const postings* b) {
+        return a->size() < b->size();
+    });
+
+    const postings& walk = *lists[0];
+    auto accept = [&] (unsigned int id) {
+        if (is_removed(id))
+            return false;
+        for (int i = 1, n = int(lists.size()); i < n; ++i)
+            if (!std::binary_search(lists[i]->begin(), lists[i]->end(), id))
+                return false;
+        return true;
+    };
+
+    unsigned int from_id = get_id(from);
+    if (direction < 0)
+    {
+        auto iter = std::upper_bound(walk.begin(), walk.end(), from_id);
+        while (iter != walk.begin())
+            if (accept(*--iter))
+                return get_position(*iter);
+    }
+    else
+    {
+        auto iter = std::lower_bound(walk.begin(), walk.end(), from_id);
+        for (; iter != walk.end(); ++iter)
+            if (accept(*iter))
+                return get_position(*iter);
+    }
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+void history_index::add_trigrams(unsigned int id, const char* line, bool sorted)
+{
+    for (; line[0] && line[1] && line[2]; ++line)
+    {
+        unsigned int trigram;
+        if (!get_trigram(line, false, trigram))
+            continue;
+
+        postings& list = m_postings[trigram];
+        if (!sorted)
+        {
+            if (list.empty() || list.back() != id)
+                list.push_back(id);
+            continue;
+        }
+
+        auto iter = std::lower_bound(list.begin(), list.end(), id);
+        if (iter == list.end() || *iter != id)
+            list.insert(iter, id);
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned int history_index::get_id(int position) const
+{
+    // Ids are handed out in order, so a line's id is its position plus the
+    // number of removed ids before it.  Removals are rare; a few passes are
+    // enough to settle on it.
+    unsigned int id = position;
+    while (true)
+    {
+        auto skipped = std::upper_bound(m_removed.begin(), m_removed.end(), id) - m_removed.begin();
+        unsigned int next = position + (unsigned int)skipped;
+        if (next == id)
+            return id;
+        id = next;
+    }
+}
+
+//------------------------------------------------------------------------------
+int history_index::get_position(unsigned int id) const
+{
+    auto skipped = std::lower_bound(m_removed.begin(), m_removed.end(), id) - m_removed.begin();
+    return int(id - skipped);
+}
+
+//------------------------------------------------------------------------------
+bool history_index::is_removed(unsigned int id) const
+{
+    return std::binary_search(m_removed.begin(), m_removed.end(), id);
+}
@@ -0,0 +1,36 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/base.h>
+
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Trigram index over the lines of Readline's history list, used to skip lines
+// that can't contain a search string.  Lines are addressed by their position
+// in the list.  Trigrams are ASCII case folded and only ever over-approximate
+// a line's content, so callers still compare the lines that find() returns.
+class history_index
+    : public no_copy
+{
+public:
+    void                    clear();
+    void                    add(const char* line);
+    void                    replace(int position, const char* line);
+    void                    remove(int position);
+    int                     find(const char* needle, int from, int direction, bool case_fold=false) const;
+    int                     size() const { return int(m_count - m_removed.size()); }
+
+private:
+    typedef std::vector<unsigned int> postings;
+    void                    add_trigrams(unsigned int id, const char* line, bool sorted);
+    unsigned int            get_id(int position) const;
+    int                     get_position(unsigned int id) const;
+    bool                    is_removed(unsigned int id) const;
+    std::unordered_map<unsigned int, postings> m_postings;
+    std::vector<unsigned int> m_removed;    // Sorted ids of removed lines.
+    unsigned int            m_count = 0;    // Ids handed out so far.
+};
@@ -0,0 +1,188 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "history_prefix_index.h"
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+history_prefix_index::history_prefix_index()
+: m_store(0x10000)
+{
+}
+
+//------------------------------------------------------------------------------
+void history_prefix_index::clear()
+{
+    m_store.clear();
+    m_entries.clear();
+    m_tree.clear();
+    m_sorted = 0;
+    m_tree_valid = false;
+    m_recency = 0;
+}
+
+//------------------------------------------------------------------------------
+void history_prefix_index::add(const char* line)
+{
+    unsigned int recency = ++m_recency;
+    m_tree_valid = false;
+
+    // A line that's already indexed only needs its recency bumping.  Lines are
+    // otherwise appended, and sorted in when next needed; loading the history
+    // adds thousands in a row.
+    if (m_sorted == m_entries.size())
+    {
+        auto iter = std::lower_bound(m_entries.begin(), m_entries.end(), line, [] (const entry& e, const char* l) {
+            return strcmp(e.line, l) < 0;
+        });
+
+        if (iter != m_entries.end() && strcmp(iter->line, line) == 0)
+        {
+            iter->recency = recency;
+            ++iter->count;
+            return;
+        }
+    }
+
+    unsigned int length = (unsigned int)strlen(line);
+    const char* stored = m_store.store(line, length);
+    if (stored == nullptr)
+        return;
+
+    m_entries.push_back({ stored, length, recency, 1 });
+}
+
+//------------------------------------------------------------------------------
+void history_prefix_index::remove(const char* line)
+{
+    normalise();
+
+    auto iter = std::lower_bound(m_entries.begin(), m_entries.end(), line, [] (const entry& e, const char* l) {
+        return strcmp(e.line, l) < 0;
+    });
+
+    if (iter == m_entries.end() || strcmp(iter->line, line) != 0)
+        return;
+
+    // The recency of a repeated line stays at its newest copy's.
+    if (--iter->count)
+        return;
+
+    m_entries.erase(iter);
+    m_sorted = (unsigned int)m_entries.size();
+    m_tree_valid = false;
+}
+
+//------------------------------------------------------------------------------
+const char* history_prefix_index::find(const char* prefix) const
+{
+    int length = int(strlen(prefix));
+    if (!length)
+        return nullptr;
+
+    normalise();
+
+    auto first = std::lower_bound(m_entries.begin(), m_entries.end(), prefix, [length] (const entry& e, const char* p) {
+        return strncmp(e.line, p, length) < 0;
+    });
+    auto last = std::upper_bound(first, m_entries.end(), prefix, [length] (const char* p, const entry& e) {
+        return strncmp(p, e.line, length) < 0;
+    });
+
+    // A line equal to the prefix sorts first and doesn't extend it.
+    if (first != last && first->length == length)
+        ++first;
+
+    if (first == last)
+        return nullptr;
+
+    int index = find_newest(int(first - m_entries.begin()), int(last - m_entries.begin()));
+    return m_entries[index].line;
+}
+
+//------------------------------------------------------------------------------
+unsigned int history_prefix_index::size() const
+{
+    normalise();
+    return (unsigned int)m_entries.size();
+}
+
+//------------------------------------------------------------------------------
+void history_prefix_index::normalise() const
+{
+    if (m_sorted == m_entries.size())
+        return;
+
+    // Sort the appended lines, merge them in, then fold repeats into one entry
+    // with the newest recency.
+    auto less = [] (const entry& a, const entry& b) {
+        int cmp = strcmp(a.line, b.line);
+        return cmp ? cmp < 0 : a.recency < b.recency;
+    };
+
+    auto middle = m_entries.begin() + m_sorted;
+    std::sort(middle, m_entries.end(), less);
+    std::inplace_merge(m_entries.begin(), middle, m_entries.end(), less);
+
+    auto out = m_entries.begin();
+    for (auto in = m_entries.begin() + 1, end = m_entries.end(); in != end; ++in)
+    {
+        if (strcmp(out->line, in->line) == 0)
+        {
+            out->recency = in->recency;
+            out->count += in->count;
+        }
+        else
+            *++out = *in;
+    }
+
+    m_entries.erase(out + 1, m_entries.end());
+    m_sorted = (unsigned int)m_entries.size();
+    m_tree_valid = false;
+}
+
+//------------------------------------------------------------------------------
+void history_prefix_index::build_tree() const
+{
+    // Bottom-up max tree; leaves at [n, 2n) hold entry indices and each parent
+    // holds whichever of its children's entries is newest.
+    unsigned int n = (unsigned int)m_entries.size();
+    m_tree.resize(n * 2);
+    for (unsigned int i = 0; i < n; ++i)
+        m_tree[n + i] = i;
+
+    for (unsigned int i = n; i-- > 1;)
+    {
+        unsigned int a = m_tree[i * 2];
+        unsigned int b = m_tree[i * 2 + 1];
+        m_tree[i] = (m_entries[a].recency >= m_entries[b].recency) ? a : b;
+    }
+
+    m_tree_valid = true;
+}
+
+//------------------------------------------------------------------------------
+int history_prefix_index::find_newest(unsigned int begin, unsigned int end) const
+{
+    if (!m_tree_valid)
+        build_tree();
+
+    int best = begin;
+    auto consider = [&] (unsigned int index) {
+        if (m_entries[index].recency > m_entries[best].recency)
+            best = index;
+    };
+
+    unsigned int n = (unsigned int)m_entries.size();
+    for (begin += n, end += n; begin < end; begin >>= 1, end >>= 1)
+    {
+        if (begin & 1)
+            consider(m_tree[begin++]);
+        if (end & 1)
+            consider(m_tree[--end]);
+    }
+
+    return best;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/arena.h>
+#include <core/base.h>
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Sorted set of distinct history lines, each with the recency of its latest
+// copy, for finding the most recent line that extends some input.  Lines that
+// share a prefix are adjacent, and a max tree over the recencies finds the
+// newest of them in O(log n).
+class history_prefix_index
+    : public no_copy
+{
+public:
+                            history_prefix_index();
+    void                    clear();
+    void                    add(const char* line);
+    void                    remove(const char* line);
+    const char*             find(const char* prefix) const;
+    unsigned int            size() const;
+
+private:
+    struct entry
+    {
+        const char*         line;
+        unsigned int        length;
+        unsigned int        recency;
+        unsigned int        count;
+    };
+
+    void                    normalise() const;
+    void                    build_tree() const;
+    int                     find_newest(unsigned int begin, unsigned int end) const;
+    arena                   m_store;
+    mutable std::vector<entry> m_entries;
+    mutable std::vector<unsigned int> m_tree;
+    mutable unsigned int    m_sorted = 0;       // Entries before this are sorted and distinct.
+    mutable bool            m_tree_valid = false;
+    unsigned int            m_recency = 0;
+};
@@ -0,0 +1,219 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "history_sessions.h"
+
+#include <core/str.h>
+
+#include <algorithm>
+#include <time.h>
+#include <Windows.h>
+
+//------------------------------------------------------------------------------
+static const char sessions_magic[4] = { 'C', 'L', 'H', 'S' };
+
+//------------------------------------------------------------------------------
+// The header's followed by session ids, with zero marking a free slot.
+struct history_sessions::header
+{
+    char                    magic[4];
+    unsigned int            next_reap;  // When the sessions are next checked.
+    unsigned int            next_sweep; // When the directory's next looked through.
+    unsigned int            unused;
+};
+
+//------------------------------------------------------------------------------
+history_sessions::~history_sessions()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+bool history_sessions::open(const char* bank_path)
+{
+    close();
+
+    str<280> path(bank_path);
+    path << ".sessions";
+
+    DWORD share_flags = FILE_SHARE_READ|FILE_SHARE_WRITE;
+    m_handle = CreateFile(path.c_str(), GENERIC_READ|GENERIC_WRITE, share_flags,
+        nullptr, OPEN_ALWAYS, 0, nullptr);
+    m_handle = (m_handle == INVALID_HANDLE_VALUE) ? nullptr : m_handle;
+    return is_open();
+}
+
+//------------------------------------------------------------------------------
+void history_sessions::close()
+{
+    if (m_handle != nullptr)
+        CloseHandle(m_handle);
+
+    m_handle = nullptr;
+}
+
+//------------------------------------------------------------------------------
+void history_sessions::lock() const
+{
+    // As with banks, the lock's on a byte far past the end so it doesn't stop
+    // reads.
+    OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = 0x80000000;
+    LockFileEx(m_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped);
+}
+
+//------------------------------------------------------------------------------
+void history_sessions::unlock() const
+{
+    OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = 0x80000000;
+    UnlockFileEx(m_handle, 0, 1, 0, &overlapped);
+}
+
+//------------------------------------------------------------------------------
+bool history_sessions::read(header& header, std::vector<int>& ids) const
+{
+    ids.clear();
+    memset(&header, 0, sizeof(header));
+
+    DWORD read = 0;
+    SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+    ReadFile(m_handle, &header, sizeof(header), &read, nullptr);
+    if (read != sizeof(header) || memcmp(header.magic, sessions_magic, sizeof(sessions_magic)) != 0)
+        return false;
+
+    unsigned int size = GetFileSize(m_handle, nullptr) - sizeof(header);
+    ids.resize(size / sizeof(int));
+    if (!ids.empty())
+        ReadFile(m_handle, ids.data(), DWORD(ids.size() * sizeof(int)), &read, nullptr);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void history_sessions::clear(header& header) const
+{
+    // Anything that was in an unreadable registry is found by a sweep.
+    SetFilePointer(m_handle, 0, nullptr, FILE_BEGIN);
+    SetEndOfFile(m_handle);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, sessions_magic, sizeof(sessions_magic));
+    write(&header, sizeof(header), 0);
+}
+
+//------------------------------------------------------------------------------
+void history_sessions::write(const void* data, unsigned int size, unsigned int offset) const
+{
+    DWORD written;
+    SetFilePointer(m_handle, offset, nullptr, FILE_BEGIN);
+    WriteFile(m_handle, data, size, &written, nullptr);
+}
+
+//------------------------------------------------------------------------------
+void history_sessions::add(int id)
+{
+    if (!is_open() || !id)
+        return;
+
+    lock();
+
+    header header;
+    std::vector<int> ids;
+    if (!read(header, ids))
+        clear(header);
+
+    // Ids go in the first free slot, so the registry stays as small as the
+    // most sessions there have been at once.
+    if (std::find(ids.begin(), ids.end(), id) == ids.end())
+    {
+        unsigned int slot = unsigned(std::find(ids.begin(), ids.end(), 0) - ids.begin());
+        write(&id, sizeof(id), sizeof(header) + slot * sizeof(id));
+    }
+
+    unlock();
+}
+
+//------------------------------------------------------------------------------
+void history_sessions::remove(int id)
+{
+    if (!is_open() || !id)
+        return;
+
+    lock();
+
+    header header;
+    std::vector<int> ids;
+    if (read(header, ids))
+    {
+        const int none = 0;
+        unsigned int end = 0;
+        for (unsigned int slot = 0; slot < ids.size(); ++slot)
+        {
+            if (ids[slot] == id)
+                write(&none, sizeof(none), sizeof(header) + slot * sizeof(id));
+            else if (ids[slot])
+                end = slot + 1;
+        }
+
+        // Trailing free slots are dropped.
+        if (end < ids.size())
+        {
+            SetFilePointer(m_handle, sizeof(header) + end * sizeof(id), nullptr, FILE_BEGIN);
+            SetEndOfFile(m_handle);
+        }
+    }
+
+    unlock();
+}
+
+//------------------------------------------------------------------------------
+bool history_sessions::get_due(bool force, std::vector<int>& ids, bool& sweep)
+{
+    ids.clear();
+    sweep = false;
+
+    if (!is_open())
+        return false;
+
+    lock();
+
+    // Whoever finds a check is due does it, and moves the next one on so no
+    // one else does.  Times too far ahead mean the clock's been put back.
+    header header;
+    bool valid = read(header, ids);
+    if (!valid)
+        clear(header);
+
+    unsigned int now = (unsigned int)time(nullptr);
+    auto due = [&] (unsigned int next, unsigned int interval) {
+        return (force || !valid || now >= next || next - now > interval);
+    };
+
+    bool reap = due(header.next_reap, reap_interval);
+    if (reap)
+    {
+        sweep = due(header.next_sweep, sweep_interval);
+        header.next_reap = now + reap_interval;
+        if (sweep)
+            header.next_sweep = now + sweep_interval;
+
+        write(&header, sizeof(header), 0);
+    }
+
+    unlock();
+
+    if (!reap)
+    {
+        ids.clear();
+        return false;
+    }
+
+    auto out = ids.begin();
+    for (int id : ids)
+        if (id)
+            *out++ = id;
+    ids.erase(out, ids.end());
+    return true;
+}
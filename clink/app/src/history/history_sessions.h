@@ -0,0 +1,39 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/base.h>
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Registry of the sessions that have a session bank, kept in a small file next
+// to the master bank.  Orphaned session banks are found by checking just the
+// sessions in it, and only every so often; looking through the directory for
+// ones it doesn't know about (e.g. left by older versions) is rarer still.
+class history_sessions
+    : public no_copy
+{
+public:
+    static const unsigned int reap_interval = 10 * 60;          // Seconds.
+    static const unsigned int sweep_interval = 24 * 60 * 60;
+
+                            history_sessions() = default;
+                            ~history_sessions();
+    bool                    open(const char* bank_path);
+    void                    close();
+    bool                    is_open() const { return m_handle != nullptr; }
+    void                    add(int id);
+    void                    remove(int id);
+    bool                    get_due(bool force, std::vector<int>& ids, bool& sweep);
+
+private:
+    struct header;
+    bool                    read(header& header, std::vector<int>& ids) const;
+    void                    clear(header& header) const;
+    void                    write(const void* data, unsigned int size, unsigned int offset) const;
+    void                    lock() const;
+    void                    unlock() const;
+    void*                   m_handle = nullptr;
+};
@@ -0,0 +1,253 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "history_share.h"
+
+#include <core/str.h>
+#include <core/str_hash.h>
+
+#include <Windows.h>
+
+//------------------------------------------------------------------------------
+static const unsigned int share_magic = 0x53484c43; // "CLHS"
+static const unsigned char entry_pad = 0xff;
+
+//------------------------------------------------------------------------------
+struct history_share::header
+{
+    unsigned int            magic;
+    unsigned int            next_seq;   // Given to the next record published.
+    unsigned int            first_seq;  // Of the oldest record still in the ring.
+    unsigned int            head;       // Where the next record goes.
+    unsigned int            tail;       // Where the oldest record is.
+    unsigned int            used;       // Bytes from tail to head.
+};
+
+//------------------------------------------------------------------------------
+// Records are followed by their line and padded to a multiple of four bytes.
+// A record doesn't wrap; the space at the end of the ring is skipped instead,
+// marked by a pad record if there's room for one.
+struct history_share::record
+{
+    unsigned int            size;
+    unsigned int            seq;
+    unsigned int            offset;
+    unsigned int            ctag_hash;
+    unsigned int            length;
+    unsigned char           type;
+    unsigned char           unused[3];
+};
+
+//------------------------------------------------------------------------------
+history_share::~history_share()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+bool history_share::open(const char* bank_path)
+{
+    close();
+
+    // Instances find the same segment by naming it after the bank.
+    str<280> path(bank_path);
+    for (char* c = path.data(); *c; ++c)
+        *c = (*c >= 'A' && *c <= 'Z') ? *c + ('a' - 'A') : *c;
+
+    str<64> name;
+    name.format("Local\\clink_history_%08x", str_hash(path.c_str()));
+
+    unsigned int size = sizeof(header) + ring_size;
+    m_mapping = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, size, name.c_str());
+    if (m_mapping == nullptr)
+        return false;
+
+    m_header = (header*)MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+
+    name << "_mutex";
+    m_mutex = CreateMutex(nullptr, FALSE, name.c_str());
+
+    if (m_header == nullptr || m_mutex == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    // A new segment is zeroed.
+    lock();
+    if (m_header->magic != share_magic)
+    {
+        memset(m_header, 0, sizeof(*m_header));
+        m_header->magic = share_magic;
+        m_header->next_seq = 1;
+        m_header->first_seq = 1;
+    }
+    unlock();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void history_share::close()
+{
+    if (m_header != nullptr)
+        UnmapViewOfFile(m_header);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if (m_mutex != nullptr)
+        CloseHandle(m_mutex);
+
+    m_header = nullptr;
+    m_mapping = nullptr;
+    m_mutex = nullptr;
+}
+
+//------------------------------------------------------------------------------
+void history_share::lock() const
+{
+    if (WaitForSingleObject(m_mutex, INFINITE) != WAIT_ABANDONED)
+        return;
+
+    // An instance ended while it was publishing.  The ring's emptied, and the
+    // sequence numbers skip ahead so everyone reads the bank.
+    m_header->first_seq = ++m_header->next_seq;
+    m_header->head = 0;
+    m_header->tail = 0;
+    m_header->used = 0;
+}
+
+//------------------------------------------------------------------------------
+void history_share::unlock() const
+{
+    ReleaseMutex(m_mutex);
+}
+
+//------------------------------------------------------------------------------
+unsigned int history_share::get_next_seq() const
+{
+    if (!is_open())
+        return 0;
+
+    lock();
+    unsigned int seq = m_header->next_seq;
+    unlock();
+    return seq;
+}
+
+//------------------------------------------------------------------------------
+void history_share::publish(unsigned char type, const char* line, unsigned int offset, unsigned int ctag_hash)
+{
+    if (!is_open())
+        return;
+
+    // Lines too long to share are left for others to read from the bank; the
+    // gap they leave in the offsets tells them to.
+    unsigned int length = (unsigned int)strlen(line);
+    unsigned int size = (sizeof(record) + length + 3) & ~3;
+    if (size > ring_size / 4)
+        return;
+
+    char* ring = (char*)(m_header + 1);
+    lock();
+
+    unsigned int skip = (ring_size - m_header->head < size) ? ring_size - m_header->head : 0;
+
+    // Drop the oldest records until there's room.
+    while (ring_size - m_header->used < skip + size)
+    {
+        unsigned int tail = m_header->tail;
+        unsigned int tail_size = ring_size - tail;
+        if (tail_size >= sizeof(record))
+        {
+            const record* oldest = (const record*)(ring + tail);
+            tail_size = oldest->size;
+            if (oldest->type != entry_pad)
+                m_header->first_seq = oldest->seq + 1;
+        }
+
+        m_header->tail = (tail + tail_size) % ring_size;
+        m_header->used -= tail_size;
+    }
+
+    if (skip)
+    {
+        if (skip >= sizeof(record))
+        {
+            record* pad = (record*)(ring + m_header->head);
+            memset(pad, 0, sizeof(*pad));
+            pad->size = skip;
+            pad->type = entry_pad;
+        }
+
+        m_header->head = 0;
+        m_header->used += skip;
+    }
+
+    record* out = (record*)(ring + m_header->head);
+    out->size = size;
+    out->seq = m_header->next_seq++;
+    out->offset = offset;
+    out->ctag_hash = ctag_hash;
+    out->length = length;
+    out->type = type;
+    memcpy(out + 1, line, length);
+
+    m_header->head = (m_header->head + size) % ring_size;
+    m_header->used += size;
+
+    unlock();
+}
+
+//------------------------------------------------------------------------------
+bool history_share::consume(unsigned int& seq, std::vector<entry>& out, std::vector<char>& store) const
+{
+    out.clear();
+    store.clear();
+
+    if (!is_open())
+        return false;
+
+    const char* ring = (const char*)(m_header + 1);
+    lock();
+
+    // Records since 'seq' have been dropped, or the ring's not the one 'seq'
+    // came from.
+    if (seq < m_header->first_seq || seq > m_header->next_seq)
+    {
+        unlock();
+        return false;
+    }
+
+    // Lines are copied out so the lock isn't held while they're used.
+    for (unsigned int pos = m_header->tail, used = m_header->used; used;)
+    {
+        unsigned int size = ring_size - pos;
+        if (size >= sizeof(record))
+        {
+            const record* in = (const record*)(ring + pos);
+            size = in->size;
+            if (in->type != entry_pad && in->seq >= seq)
+            {
+                out.push_back({ nullptr, in->length, in->offset, in->ctag_hash, in->type });
+                store.insert(store.end(), (const char*)(in + 1), (const char*)(in + 1) + in->length);
+                store.push_back('\0');
+            }
+        }
+
+        pos = (pos + size) % ring_size;
+        used -= size;
+    }
+
+    seq = m_header->next_seq;
+    unlock();
+
+    const char* line = store.data();
+    for (entry& e : out)
+    {
+        e.line = line;
+        line += e.length + 1;
+    }
+
+    return true;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <core/base.h>
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Ring of recent changes to the master bank, in memory shared between the
+// instances that have the same history file.  Each change has a sequence number
+// and the bank offset of its line; an instance that's seen every change since
+// it last read the bank can catch up without reading it again.  The bank is
+// still the only durable record, and anything that can't be caught up on (the
+// ring's wrapped, or a change wasn't published) means reading it.
+class history_share
+    : public no_copy
+{
+public:
+    enum : unsigned char
+    {
+        entry_add,
+        entry_remove,
+    };
+
+    struct entry
+    {
+        const char*         line;
+        unsigned int        length;
+        unsigned int        offset;     // In the master bank.
+        unsigned int        ctag_hash;  // Of the master bank the offset's in.
+        unsigned char       type;
+    };
+
+    static const unsigned int ring_size = 0x10000;
+
+                            history_share() = default;
+                            ~history_share();
+    bool                    open(const char* bank_path);
+    void                    close();
+    bool                    is_open() const { return m_header != nullptr; }
+    unsigned int            get_next_seq() const;
+    void                    publish(unsigned char type, const char* line, unsigned int offset, unsigned int ctag_hash);
+    bool                    consume(unsigned int& seq, std::vector<entry>& out, std::vector<char>& store) const;
+
+private:
+    struct header;
+    struct record;
+    void                    lock() const;
+    void                    unlock() const;
+    header*                 m_header = nullptr;
+    void*                   m_mapping = nullptr;
+    void*                   m_mutex = nullptr;
+};
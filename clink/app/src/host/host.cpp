@@ -6,12 +6,14 @@
 #include "host_lua.h"
 #include "prompt.h"
 #include "doskey.h"
+#include "history/frecency_db.h"
 #include "terminal/terminal.h"
 #include "terminal/terminal_out.h"
 #include "terminal/printer.h"
 #include "utils/app_context.h"
 
 #include <core/globber.h>
+#include <core/log.h>
 #include <core/os.h>
 #include <core/path.h>
 #include <core/settings.h>
@@ -53,6 +55,14 @@ static setting_bool g_save_history(
     "Changing this setting only takes effect for new instances.",
     true);
 
+static setting_bool g_frecency(
+    "history.frecency",
+    "Rank directories and commands by use",
+    "Keeps a count of how often and how recently directories are visited and\n"
+    "commands are entered, shared between instances.  Scripts can query it, and\n"
+    "the 'match.sort_frecent' setting uses it to order directory matches.",
+    true);
+
 static setting_str g_exclude_from_history_cmds(
     "history.dont_add_to_history_cmds",
     "Commands not automatically added to the history",
@@ -132,6 +142,7 @@ dir_history_entry::dir_history_entry(const char* s)
 //------------------------------------------------------------------------------
 const int c_max_dir_history = 100;
 static std::list<dir_history_entry> s_dir_history;
+static frecency_db* s_frecency_db = nullptr;
 
 //------------------------------------------------------------------------------
 static void update_dir_history()
@@ -141,8 +152,14 @@ static void update_dir_history()
 
     // Add cwd to tail.
     if (!s_dir_history.size() || _stricmp(s_dir_history.back().get(), cwd.c_str()) != 0)
+    {
         s_dir_history.push_back(cwd.c_str());
 
+        // Arriving in a directory counts as a visit.
+        if (s_frecency_db)
+            s_frecency_db->add(frecency_db::kind_dir, cwd.c_str());
+    }
+
     // Trim overflow from head.
     while (s_dir_history.size() > c_max_dir_history)
         s_dir_history.pop_front();
@@ -192,6 +209,116 @@ void host_remove_history(int rl_history_index, const char* line)
     if (s_history_db)
         s_history_db->remove(rl_history_index, line);
 }
+bool host_get_suggestion(const char* line, str_base& out)
+{
+    const char* suggestion = s_history_db ? s_history_db->suggest(line) : nullptr;
+    if (!suggestion)
+        return false;
+
+    out = suggestion;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static bool get_frecency_args(lua_State* state, frecency_db::kind& kind, str_base* name)
+{
+    if (!s_frecency_db || !lua_isstring(state, 1))
+        return false;
+
+    const char* kind_name = lua_tostring(state, 1);
+    if (_stricmp(kind_name, "dir") == 0)
+        kind = frecency_db::kind_dir;
+    else if (_stricmp(kind_name, "command") == 0)
+        kind = frecency_db::kind_command;
+    else
+        return false;
+
+    if (!name)
+        return true;
+
+    if (!lua_isstring(state, 2))
+        return false;
+
+    // Directories are relative to the current directory.
+    name->clear();
+    if (kind == frecency_db::kind_dir)
+        os::get_current_dir(*name);
+    path::append(*name, lua_tostring(state, 2));
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Documented in clink_api.cpp.
+int get_frecent(lua_State* state)
+{
+    frecency_db::kind kind;
+    if (!get_frecency_args(state, kind, nullptr))
+        return 0;
+
+    int count = lua_isnumber(state, 2) ? int(lua_tointeger(state, 2)) : 10;
+    if (count <= 0)
+        return 0;
+
+    std::vector<frecency_db::result> results;
+    s_frecency_db->get_top(kind, count, results);
+
+    lua_createtable(state, int(results.size()), 0);
+    for (int i = 0; i < int(results.size()); ++i)
+    {
+        lua_pushstring(state, results[i].name);
+        lua_rawseti(state, -2, i + 1);
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// Documented in clink_api.cpp.
+int get_frecency(lua_State* state)
+{
+    frecency_db::kind kind;
+    str<280> name;
+    if (!get_frecency_args(state, kind, &name))
+        return 0;
+
+    lua_pushinteger(state, s_frecency_db->get_score(kind, name.c_str()));
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// Documented in clink_api.cpp.
+int add_frecent(lua_State* state)
+{
+    frecency_db::kind kind;
+    str<280> name;
+    if (!get_frecency_args(state, kind, &name))
+        return 0;
+
+    s_frecency_db->add(kind, name.c_str());
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void host_get_dir_frecency(const char* const* dirs, int count, unsigned int* scores)
+{
+    str<288> cwd;
+    if (s_frecency_db)
+        os::get_current_dir(cwd);
+
+    str<280> dir;
+    for (int i = 0; i < count; ++i)
+    {
+        if (!s_frecency_db)
+        {
+            scores[i] = 0;
+            continue;
+        }
+
+        dir.clear();
+        path::join(cwd.c_str(), dirs[i], dir);
+        scores[i] = s_frecency_db->get_score(frecency_db::kind_dir, dir.c_str(), i == 0);
+    }
+}
 
 //------------------------------------------------------------------------------
 static void write_line_feed()
@@ -340,6 +467,7 @@ host::~host()
     delete m_prompt_filter;
     delete m_lua;
     delete m_history;
+    delete m_frecency;
     delete m_printer;
     terminal_destroy(m_terminal);
 }
@@ -366,6 +494,30 @@ bool host::edit_line(const char* prompt, str_base& out)
     static_assert(str_compare_scope::relaxed == 2, "g_ignore_case values must match str_compare_scope values");
     str_compare_scope compare(g_ignore_case.get());
 
+    // Open the frecency store before scripts run, since they can use it.
+    if (g_frecency.get())
+    {
+        if (!m_frecency)
+        {
+            str<288> frecency_file;
+            app->get_frecency_path(frecency_file);
+
+            m_frecency = new frecency_db;
+            if (!m_frecency->open(frecency_file.c_str()))
+            {
+                delete m_frecency;
+                m_frecency = nullptr;
+            }
+        }
+    }
+    else if (m_frecency)
+    {
+        delete m_frecency;
+        m_frecency = nullptr;
+    }
+
+    s_frecency_db = m_frecency;
+
     // Improve performance while replaying doskey macros by not loading scripts
     // or history, since they aren't used.
     bool init_scripts = !m_doskey_alias;
@@ -458,6 +610,9 @@ bool host::edit_line(const char* prompt, str_base& out)
         }
     }
 
+    if (m_history)
+        m_history->set_frecency(m_frecency);
+
     s_history_db = m_history;
 
     bool resolved = false;
@@ -537,7 +692,12 @@ bool host::edit_line(const char* prompt, str_base& out)
     }
 
     s_history_db = nullptr;
+    s_frecency_db = nullptr;
 
     line_editor_destroy(editor);
+
+    // Write out what was logged and traced during the edit.
+    logger::flush();
+    tracer::flush();
     return ret;
 }
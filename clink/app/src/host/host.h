@@ -9,6 +9,7 @@
 
 #include <lib/line_editor.h>
 
+class frecency_db;
 class lua_state;
 class str_base;
 class host_lua;
@@ -37,6 +38,7 @@ private:
     terminal        m_terminal;
     printer*        m_printer;
     history_db*     m_history = nullptr;
+    frecency_db*    m_frecency = nullptr;
     host_lua*       m_lua = nullptr;
     prompt_filter*  m_prompt_filter = nullptr;
 };
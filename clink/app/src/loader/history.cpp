@@ -14,6 +14,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <vector>
+
 //------------------------------------------------------------------------------
 void puts_help(const char**, int);
 
@@ -50,62 +52,76 @@ static bool is_console(HANDLE h)
 }
 
 //------------------------------------------------------------------------------
-static void print_history(unsigned int tail_count)
+static void print_line(int index, const str_iter& line)
 {
-    history_scope history;
+    static HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
+    static bool translate = is_console(hout);
 
-    str_iter line;
-    char buffer[history_db::max_line_length];
+    str<> utf8;
+    utf8.format("%5d  %.*s", index, line.length(), line.get_pointer());
+    if (translate)
+    {
+        DWORD written;
+        wstr<> utf16;
 
-    int count = 0;
+        // Translate to UTF16, and also translate control characters.
+        for (const char* walk = utf8.c_str(); *walk;)
+        {
+            const char* begin = walk;
+            while (*walk >= 0x20 || *walk == 0x09)
+                walk++;
+            if (walk > begin)
+                to_utf16(utf16, str_iter(begin, int(walk - begin)));
+            if (!*walk)
+                break;
+            wchar_t ctrl[3] = { '^', wchar_t(*walk + 'A' - 1) };
+            utf16.concat(ctrl, 2);
+            walk++;
+        }
+
+        utf16.concat(L"\r\n", 2);
+        WriteConsoleW(hout, utf16.c_str(), utf16.length(), &written, nullptr);
+    }
+    else
     {
-        history_db::iter iter = history->read_lines(buffer);
-        while (iter.next(line))
-            ++count;
+        puts(utf8.c_str());
     }
+}
 
-    int index = 1;
-    history_db::iter iter = history->read_lines(buffer);
+//------------------------------------------------------------------------------
+static void print_history()
+{
+    history_scope history;
 
-    int skip = count - tail_count;
-    for (int i = 0; i < skip; ++i, ++index, iter.next(line));
+    str_iter line;
+    char buffer[history_db::line_buffer_size];
+    history_db::iter iter = history->read_lines(buffer);
+    for (int index = 1; iter.next(line); ++index)
+        print_line(index, line);
+}
 
-    str<> utf8;
-    wstr<> utf16;
-    HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
-    bool translate = is_console(hout);
+//------------------------------------------------------------------------------
+static void print_history(unsigned int tail_count)
+{
+    history_scope history;
 
-    for (; iter.next(line); ++index)
+    // The tail's read from the end of the history so only the lines printed
+    // are read.  Numbering them would mean counting the rest, so they're
+    // numbered back from the end instead, as 'delete' accepts.
+    str_iter line;
+    char buffer[history_db::line_buffer_size];
+    std::vector<char> store;
+    std::vector<unsigned int> ends;
     {
-        utf8.clear();
-        utf8.format("%5d  %.*s", index, line.length(), line.get_pointer());
-        if (translate)
-        {
-            DWORD written;
-            utf16.clear();
-
-            // Translate to UTF16, and also translate control characters.
-            for (const char* walk = utf8.c_str(); *walk;)
-            {
-                const char* begin = walk;
-                while (*walk >= 0x20 || *walk == 0x09)
-                    walk++;
-                if (walk > begin)
-                    to_utf16(utf16, str_iter(begin, int(walk - begin)));
-                if (!*walk)
-                    break;
-                wchar_t ctrl[3] = { '^', wchar_t(*walk + 'A' - 1) };
-                utf16.concat(ctrl, 2);
-                walk++;
-            }
+        history_db::iter iter = history->read_lines_reverse(buffer);
+        for (; ends.size() < tail_count && iter.next(line); ends.push_back(unsigned(store.size())))
+            store.insert(store.end(), line.get_pointer(), line.get_pointer() + line.length());
+    }
 
-            utf16.concat(L"\r\n", 2);
-            WriteConsoleW(hout, utf16.c_str(), utf16.length(), &written, nullptr);
-        }
-        else
-        {
-            puts(utf8.c_str());
-        }
+    for (int i = int(ends.size()); i-- > 0;)
+    {
+        unsigned int start = i ? ends[i - 1] : 0;
+        print_line(-1 - i, str_iter(store.data() + start, int(ends[i] - start)));
     }
 }
 
@@ -114,7 +130,7 @@ static bool print_history(const char* arg)
 {
     if (arg == nullptr)
     {
-        print_history(INT_MIN);
+        print_history();
         return true;
     }
 
@@ -142,15 +158,16 @@ static int remove(int index)
 {
     history_scope history;
 
-    if (index <= 0)
+    if (index == 0)
         return 1;
 
-    char buffer[history_db::max_line_length];
+    // Negative indices count back from the end of the history.
+    char buffer[history_db::line_buffer_size];
     history_db::line_id line_id = 0;
     {
         str_iter line;
-        history_db::iter iter = history->read_lines(buffer);
-        for (int i = index - 1; i > 0 && iter.next(line); --i);
+        history_db::iter iter = (index > 0) ? history->read_lines(buffer) : history->read_lines_reverse(buffer);
+        for (int i = abs(index) - 1; i > 0 && iter.next(line); --i);
 
         line_id = iter.next(line);
     }
@@ -182,6 +199,31 @@ static int compact()
     return 0;
 }
 
+//------------------------------------------------------------------------------
+static int convert(const char* format_name)
+{
+    history_db::bank_format format;
+    if (_stricmp(format_name, "text") == 0)
+        format = history_db::bank_format_text;
+    else if (_stricmp(format_name, "binary") == 0)
+        format = history_db::bank_format_binary;
+    else
+    {
+        printf("history: unknown format '%s'\n", format_name);
+        return 1;
+    }
+
+    history_scope history;
+    if (!history->convert(format))
+    {
+        puts("Unable to convert the history file.");
+        return 1;
+    }
+
+    printf("History converted to %s.\n", format_name);
+    return 0;
+}
+
 //------------------------------------------------------------------------------
 static int print_expansion(const char* line)
 {
@@ -199,12 +241,13 @@ static int print_help()
     extern const char* g_clink_header;
 
     const char* help[] = {
-        "[n]",          "Print history items (only the last N items if specified).",
-        "clear",        "Completely clears the command history.",
-        "compact",      "Compacts the history file.",
-        "delete <n>",   "Delete Nth item (negative N indexes history backwards).",
-        "add <...>",    "Join remaining arguments and appends to the history.",
-        "expand <...>", "Print substitution result.",
+        "[n]",           "Print history items (the last N items, numbered from the end, if specified).",
+        "clear",         "Completely clears the command history.",
+        "compact",       "Compacts the history file.",
+        "convert <fmt>", "Rewrites the history file as 'text' or 'binary'.",
+        "delete <n>",    "Delete Nth item (negative N indexes history backwards).",
+        "add <...>",     "Join remaining arguments and appends to the history.",
+        "expand <...>",  "Print substitution result.",
     };
 
     puts(g_clink_header);
@@ -294,6 +337,18 @@ int history(int argc, char** argv)
         if (_stricmp(verb, "compact") == 0)
             return compact();
 
+        // 'convert' command
+        if (_stricmp(verb, "convert") == 0)
+        {
+            if (argc < 3)
+            {
+                puts("history: argument required for verb 'convert'");
+                return print_help();
+            }
+            else
+                return convert(argv[2]);
+        }
+
         // 'delete' command
         if (_stricmp(verb, "delete") == 0)
         {
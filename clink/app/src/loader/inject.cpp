@@ -299,6 +299,7 @@ int inject(int argc, char** argv)
         { "quiet",       no_argument,        nullptr, 'q' },
         { "pid",         required_argument,  nullptr, 'd' },
         { "nolog",       no_argument,        nullptr, 'l' },
+        { "trace",       no_argument,        nullptr, 't' },
         { "autorun",     no_argument,        nullptr, '_' },
         { "help",        no_argument,        nullptr, 'h' },
         { nullptr, 0, nullptr, 0 }
@@ -310,6 +311,7 @@ int inject(int argc, char** argv)
         "-q, --quiet",          "Suppress copyright output.",
         "-d, --pid <pid>",      "Inject into the process specified by <pid>.",
         "-l, --nolog",          "Disable file logging.",
+        "-t, --trace",          "Record input latency spans (see 'clink trace').",
         "-h, --help",           "Shows this help text.",
     };
 
@@ -321,7 +323,7 @@ int inject(int argc, char** argv)
     int i;
     int ret = 1;
     bool is_autorun = false;
-    while ((i = getopt_long(argc, argv, "lqhp:s:d:", options, nullptr)) != -1)
+    while ((i = getopt_long(argc, argv, "ltqhp:s:d:", options, nullptr)) != -1)
     {
         switch (i)
         {
@@ -353,6 +355,10 @@ int inject(int argc, char** argv)
             app_desc.log = false;
             break;
 
+        case 't':
+            app_desc.trace = true;
+            break;
+
         case '?':
             return ret;
 
@@ -371,6 +377,14 @@ int inject(int argc, char** argv)
     app_context::get()->get_log_path(log_path);
     unlink(log_path.c_str());
 
+    // Likewise the trace, when tracing's wanted.
+    if (app_desc.trace)
+    {
+        str<256> trace_path;
+        app_context::get()->get_trace_path(trace_path);
+        unlink(trace_path.c_str());
+    }
+
     // Unless a target pid was specified on the command line search for a
     // compatible parent process.
     if (target_pid == 0)
@@ -34,6 +34,14 @@ int input_echo(int argc, char** argv)
         while (1)
         {
             int c = input.read();
+            if (c == terminal_in::input_paste)
+            {
+                str<> text;
+                if (input.get_paste(text))
+                    printf("<paste:%d>", text.length());
+                continue;
+            }
+
             if (c < 0)
                 break;
 
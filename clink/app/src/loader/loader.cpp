@@ -22,6 +22,7 @@ int inject(int, char**);
 int input_echo(int, char**);
 int set(int, char**);
 int testbed(int, char**);
+int trace(int, char**);
 
 //------------------------------------------------------------------------------
 void puts_help(const char** help_pairs, int count)
@@ -53,6 +54,7 @@ static void show_usage()
         "set",             "Adjust Clink's settings",
         "history",         "List and operate on the command history",
         "info",            "Prints information about Clink",
+        "trace",           "Prints recorded trace spans as Chrome trace JSON",
         "echo",            "Echo key sequences",
         "",                "('<verb> --help' for more details)",
         "Options:",        "",
@@ -82,6 +84,7 @@ static int dispatch_verb(const char* verb, int argc, char** argv)
         "inject",    inject,
         "set",       set,
         "testbed",   testbed,
+        "trace",     trace,
     };
 
     for (int i = 0; i < sizeof_array(handlers); ++i)
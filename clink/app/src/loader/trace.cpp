@@ -0,0 +1,103 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "utils/app_context.h"
+
+#include <core/base.h>
+#include <core/str.h>
+
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+void puts_help(const char**, int);
+
+//------------------------------------------------------------------------------
+static int print_help()
+{
+    extern const char* g_clink_header;
+
+    const char* help[] = {
+        "",             "Print the recorded spans as Chrome trace JSON.",
+        "clear",        "Deletes the recorded spans.",
+    };
+
+    puts(g_clink_header);
+    puts("Usage: trace [verb]\n");
+
+    puts("Verbs:");
+    puts_help(help, sizeof_array(help));
+
+    puts("Spans are only recorded by sessions started with 'clink inject --trace'.\n"
+        "Load the output in chrome://tracing or https://ui.perfetto.dev.");
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+static int clear(const char* trace_path)
+{
+    unlink(trace_path);
+    puts("Trace cleared.");
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+static int print_trace(const char* trace_path)
+{
+    FILE* file = fopen(trace_path, "rt");
+    if (file == nullptr)
+    {
+        printf("trace: no spans have been recorded (%s)\n", trace_path);
+        return 1;
+    }
+
+    // Events are recorded one per line, each followed by a comma, in the JSON
+    // array format.  Close the array so the output is strict JSON.
+    puts("[");
+
+    char line[512];
+    bool first = true;
+    while (fgets(line, sizeof_array(line), file))
+    {
+        int length = int(strlen(line));
+        while (length && (line[length - 1] == '\n' || line[length - 1] == ','))
+            --length;
+
+        if (!length)
+            continue;
+
+        line[length] = '\0';
+        printf(first ? "%s" : ",\n%s", line);
+        first = false;
+    }
+
+    puts("\n]");
+
+    fclose(file);
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+int trace(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+        if (_stricmp(argv[i], "--help") == 0 || _stricmp(argv[i], "-h") == 0)
+            return print_help();
+
+    str<280> trace_path;
+    app_context::get()->get_trace_path(trace_path);
+
+    if (argc > 2)
+        return print_help();
+
+    if (argc > 1)
+    {
+        if (_stricmp(argv[1], "clear") == 0)
+            return clear(trace_path.c_str());
+
+        return print_help();
+    }
+
+    return print_trace(trace_path.c_str());
+}
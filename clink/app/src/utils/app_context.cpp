@@ -92,6 +92,12 @@ bool app_context::is_logging_enabled() const
     return m_desc.log;
 }
 
+//------------------------------------------------------------------------------
+bool app_context::is_tracing_enabled() const
+{
+    return m_desc.trace;
+}
+
 //------------------------------------------------------------------------------
 bool app_context::is_quiet() const
 {
@@ -148,6 +154,13 @@ void app_context::get_log_path(str_base& out) const
     path::append(out, "clink.log");
 }
 
+//------------------------------------------------------------------------------
+void app_context::get_trace_path(str_base& out) const
+{
+    get_state_dir(out);
+    path::append(out, "clink_trace.json");
+}
+
 //------------------------------------------------------------------------------
 void app_context::get_settings_path(str_base& out) const
 {
@@ -162,6 +175,13 @@ void app_context::get_history_path(str_base& out) const
     path::append(out, "clink_history");
 }
 
+//------------------------------------------------------------------------------
+void app_context::get_frecency_path(str_base& out) const
+{
+    get_state_dir(out);
+    path::append(out, "clink_frecency");
+}
+
 //------------------------------------------------------------------------------
 void app_context::get_script_path(str_base& out) const
 {
@@ -18,7 +18,7 @@ public:
         bool    quiet = false;
         bool    log = true;
         bool    inherit_id = false;
-        char    unused = 0;
+        bool    trace = false;
         char    state_dir[510]; // = {}; (this crashes cl.exe v18.00.21005.1)
         char    script_path[510]; // = {}; (this crashes cl.exe v18.00.21005.1)
     };
@@ -26,12 +26,15 @@ public:
                 app_context(const desc& desc);
     int         get_id() const;
     bool        is_logging_enabled() const;
+    bool        is_tracing_enabled() const;
     bool        is_quiet() const;
     void        get_binaries_dir(str_base& out) const;
     void        get_state_dir(str_base& out) const;
     void        get_log_path(str_base& out) const;
+    void        get_trace_path(str_base& out) const;
     void        get_settings_path(str_base& out) const;
     void        get_history_path(str_base& out) const;
+    void        get_frecency_path(str_base& out) const;
     void        get_script_path(str_base& out) const;
     void        update_env() const;
 
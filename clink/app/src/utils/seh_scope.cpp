@@ -5,6 +5,7 @@
 #include "seh_scope.h"
 #include "utils/app_context.h"
 
+#include <core/log.h>
 #include <core/str.h>
 
 //------------------------------------------------------------------------------
@@ -22,6 +23,9 @@ static LONG WINAPI exception_filter(EXCEPTION_POINTERS* info)
     }
     buffer << "\\clink.dmp";
 
+    // Don't lose buffered log lines that may explain the crash.
+    logger::flush();
+
     fputs("\n!!! CLINK'S CRASHED!", stderr);
     fputs("\n!!!", stderr);
     fputs("\n!!! Writing core dump", stderr);
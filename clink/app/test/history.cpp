@@ -11,7 +11,12 @@
 #include <core/os.h>
 #include <core/settings.h>
 #include <core/str.h>
+#include <core/str_hash.h>
+#include <history/frecency_db.h>
 #include <history/history_db.h>
+#include <history/history_index.h>
+#include <history/history_prefix_index.h>
+#include <readline/history.h>
 #include <utils/app_context.h>
 
 #include <initializer_list>
@@ -34,6 +39,8 @@ struct test_history_db
 {
     test_history_db()
     {
+        m_background_compact = false;
+        m_background_reap = false;
         initialise();
     }
 
@@ -61,8 +68,78 @@ struct test_history_db
     {
         m_min_compact_threshold = threshold;
     }
+
+    void set_background_compact(bool background)
+    {
+        m_background_compact = background;
+    }
+
+    void wait_for_compact()
+    {
+        history_db::wait_for_compact();
+    }
+
+    bool load_shared()
+    {
+        return history_db::load_shared();
+    }
+
+    void reap(bool force)
+    {
+        history_db::reap(force);
+    }
+};
+
+//------------------------------------------------------------------------------
+// An empty state dir, with the state id set to something explicit.
+class history_fixture
+{
+public:
+                            history_fixture();
+
+private:
+    static app_context::desc get_context_desc(const char* state_dir);
+    fs_fixture              m_fs;
+    env_fixture             m_env;
+    app_context             m_context;
 };
 
+//------------------------------------------------------------------------------
+static const char* s_empty_fs[] = { nullptr };
+static const char* s_state_env[] = {
+    "=clink.id", "493",
+    nullptr
+};
+
+//------------------------------------------------------------------------------
+history_fixture::history_fixture()
+: m_fs(s_empty_fs)
+, m_env(s_state_env)
+, m_context(get_context_desc(m_fs.get_root()))
+{
+}
+
+//------------------------------------------------------------------------------
+app_context::desc history_fixture::get_context_desc(const char* state_dir)
+{
+    app_context::desc desc;
+    desc.inherit_id = true;
+    str_base(desc.state_dir).copy(state_dir);
+    return desc;
+}
+
+//------------------------------------------------------------------------------
+static void write_history_lines(unsigned int count, unsigned int distinct)
+{
+    // Writes the master bank directly, as "git commit" lines that repeat
+    // every 'distinct' lines.
+    FILE* file = fopen("clink_history", "wb");
+    REQUIRE(file != nullptr);
+    for (unsigned int i = 0; i < count; ++i)
+        fprintf(file, "git commit -m \"change %u\"\n", i % distinct);
+    fclose(file);
+}
+
 //------------------------------------------------------------------------------
 int count_files()
 {
@@ -90,6 +167,23 @@ void expect_files(const std::initializer_list<T>& names, bool exclusive=true)
         REQUIRE(count_files() == names.size());
 }
 
+//------------------------------------------------------------------------------
+static void expect_lines(history_db& history, const std::initializer_list<const char*>& lines)
+{
+    char buffer[history_db::line_buffer_size];
+    history_db::iter iter = history.read_lines(buffer);
+
+    str_iter line;
+    for (const char* expected : lines)
+    {
+        REQUIRE(iter.next(line));
+        REQUIRE(line.length() == strlen(expected));
+        REQUIRE(memcmp(line.get_pointer(), expected, line.length()) == 0);
+    }
+
+    REQUIRE(!iter.next(line));
+}
+
 
 
 //------------------------------------------------------------------------------
@@ -107,41 +201,28 @@ TEST_CASE("history db")
     const char* master_path = "clink_history";
     const char* session_path = "clink_history_493";
     const char* alive_path = "clink_history_493~";
+    const char* sessions_path = "clink_history.sessions";
 
-    // Start with an empty state dir.
-    const char* empty_fs[] = { nullptr };
-    fs_fixture fs(empty_fs);
+    history_fixture fixture;
     REQUIRE(count_files() == 0);
 
-    // This sets the state id to something explicit.
-    static const char* env_desc[] = {
-        "=clink.id", "493",
-        nullptr
-    };
-    env_fixture env(env_desc);
-
-    app_context::desc context_desc;
-    context_desc.inherit_id = true;
-    str_base(context_desc.state_dir).copy(fs.get_root());
-    app_context context(context_desc);
-
     SECTION("Alive file")
     {
         // Shared
         settings::find("history.shared")->set("true");
         {
             test_history_db history;
-            expect_files({master_path, alive_path});
+            expect_files({master_path, alive_path, sessions_path});
         }
-        expect_files({master_path});
+        expect_files({master_path, sessions_path});
 
         // Sessioned
         settings::find("history.shared")->set("false");
         {
             test_history_db history;
-            expect_files({master_path, session_path, alive_path});
+            expect_files({master_path, session_path, alive_path, sessions_path});
         }
-        expect_files({master_path});
+        expect_files({master_path, sessions_path});
     }
 
     SECTION("Shared")
@@ -154,7 +235,7 @@ TEST_CASE("history db")
         // Write a lot of lines, check it only goes to main file.
         {
             test_history_db history;
-            REQUIRE(count_files() == 2);
+            REQUIRE(count_files() == 3);
 
             while (line_bytes < 64 * 1024)
             {
@@ -175,7 +256,75 @@ TEST_CASE("history db")
             REQUIRE(os::get_file_size(master_path) == 0 + history.get_master_tag_size());
         }
 
-        REQUIRE(count_files() == 1);
+        REQUIRE(count_files() == 2);
+    }
+
+    SECTION("Long lines")
+    {
+        settings::find("history.shared")->set("true");
+        settings::find("history.dupe_mode")->set("add");
+
+        str<> long_line;
+        while (long_line.length() < 100000)
+            long_line << "0123456789";
+
+        {
+            test_history_db history;
+            REQUIRE(history.add("before"));
+            REQUIRE(history.add(long_line.c_str()));
+            REQUIRE(history.add("after"));
+        }
+
+        // Lines longer than the read buffer come back whole.
+        test_history_db history;
+        char buffer[512];
+        str_iter line;
+        history_db::iter iter = history.read_lines(buffer);
+
+        REQUIRE(iter.next(line));
+        REQUIRE(line.length() == 6);
+        REQUIRE(strncmp(line.get_pointer(), "before", 6) == 0);
+
+        REQUIRE(iter.next(line));
+        REQUIRE(line.length() == long_line.length());
+        REQUIRE(memcmp(line.get_pointer(), long_line.c_str(), long_line.length()) == 0);
+
+        REQUIRE(iter.next(line));
+        REQUIRE(line.length() == 5);
+        REQUIRE(strncmp(line.get_pointer(), "after", 5) == 0);
+
+        REQUIRE(!iter.next(line));
+    }
+
+    SECTION("Last line fills the buffer")
+    {
+        settings::find("history.shared")->set("true");
+        settings::find("history.dupe_mode")->set("add");
+
+        {
+            test_history_db history;
+            REQUIRE(history.add("before"));
+        }
+
+        // A last line without a newline that ends exactly where the read
+        // buffer does is read whole, with room after it to terminate it.
+        FILE* file = fopen(master_path, "ab");
+        REQUIRE(file != nullptr);
+        fseek(file, 0, SEEK_END);
+        int length = history_db::line_buffer_size - int(ftell(file));
+        REQUIRE(length > 0);
+
+        str<> last_line;
+        while (int(last_line.length()) < length)
+            last_line << "x";
+        fwrite(last_line.c_str(), 1, length, file);
+        fclose(file);
+
+        test_history_db history;
+        history.load_rl_history(false);
+        REQUIRE(history_length == 2);
+        REQUIRE(strcmp(history_list()[1]->line, last_line.c_str()) == 0);
+        expect_lines(history, { "before", last_line.c_str() });
     }
 
     SECTION("Sessioned")
@@ -186,22 +335,64 @@ TEST_CASE("history db")
         int line_bytes = 0;
         {
             test_history_db history;
-            REQUIRE(count_files() == 3);
+            REQUIRE(count_files() == 4);
 
             REQUIRE(history.add(line_set0[0]));
             line_bytes += int(strlen(line_set0[0])) + 1;
 
-            REQUIRE(count_files() == 3);
+            REQUIRE(count_files() == 4);
             REQUIRE(os::get_file_size(session_path) == line_bytes);
             REQUIRE(os::get_file_size(master_path) == 0 + history.get_master_tag_size());
 
             line_bytes += history.get_master_tag_size(); // because reap()
         }
 
-        REQUIRE(count_files() == 1);
+        REQUIRE(count_files() == 2);
         REQUIRE(os::get_file_size(master_path) == line_bytes);
     }
 
+    SECTION("Orphans")
+    {
+        settings::find("history.shared")->set("false");
+        settings::find("history.dupe_mode")->set("add");
+
+        auto write_orphan = [] (const char* path, const char* line) {
+            FILE* out = fopen(path, "wb");
+            fputs(line, out);
+            fputs("\n", out);
+            fclose(out);
+        };
+
+        // Without a registry the directory's looked through.
+        write_orphan("clink_history_123", "orphan_123");
+        {
+            test_history_db history;
+            expect_files({master_path, session_path, alive_path, sessions_path});
+            expect_lines(history, { "orphan_123" });
+        }
+
+        // Registered sessions are only checked now and then.
+        {
+            history_sessions sessions;
+            REQUIRE(sessions.open(master_path));
+            sessions.add(124);
+        }
+
+        write_orphan("clink_history_124", "orphan_124");
+        test_history_db history;
+        expect_files({master_path, session_path, alive_path, sessions_path, "clink_history_124"});
+
+        history.reap(true);
+        expect_files({master_path, session_path, alive_path, sessions_path});
+        expect_lines(history, { "orphan_123", "orphan_124" });
+
+        // A live session isn't reaped, its own included.
+        REQUIRE(history.add(line_set0[0]));
+        history.reap(true);
+        expect_files({master_path, session_path, alive_path, sessions_path});
+        expect_lines(history, { "orphan_123", "orphan_124", line_set0[0] });
+    }
+
     SECTION("line iter")
     {
         str<> lines;
@@ -241,21 +432,7 @@ TEST_CASE("history db")
 //------------------------------------------------------------------------------
 TEST_CASE("history rl")
 {
-    // Start with an empty state dir.
-    const char* empty_fs[] = { nullptr };
-    fs_fixture fs(empty_fs);
-
-    // This sets the state id to something explicit.
-    static const char* env_desc[] = {
-        "=clink.id", "493",
-        nullptr
-    };
-    env_fixture env(env_desc);
-
-    app_context::desc context_desc;
-    context_desc.inherit_id = true;
-    str_base(context_desc.state_dir).copy(fs.get_root());
-    app_context context(context_desc);
+    history_fixture fixture;
 
     // Fill the history. reload() call will fill Readline.
     static const char* history_lines[] = {
@@ -459,21 +636,7 @@ TEST_CASE("history limit")
 {
     const char* master_path = "clink_history";
 
-    // Start with an empty state dir.
-    const char* empty_fs[] = { nullptr };
-    fs_fixture fs(empty_fs);
-
-    // This sets the state id to something explicit.
-    static const char* env_desc[] = {
-        "=clink.id", "493",
-        nullptr
-    };
-    env_fixture env(env_desc);
-
-    app_context::desc context_desc;
-    context_desc.inherit_id = true;
-    str_base(context_desc.state_dir).copy(fs.get_root());
-    app_context context(context_desc);
+    history_fixture fixture;
 
     // Set history to shared with limit of 3 lines, so it compacts after
     // exceeding 3 deleted lines.
@@ -572,3 +735,1112 @@ TEST_CASE("history limit")
         }
     }
 }
+
+//------------------------------------------------------------------------------
+TEST_CASE("history binary")
+{
+    const char* master_path = "clink_history";
+
+    history_fixture fixture;
+
+    settings::find("history.shared")->set("true");
+    settings::find("history.max_lines")->set("100");
+
+    test_history_db history;
+    history.add("cmd1 arg1");
+    history.add("cmd2 arg1 arg2");
+    history.add("cmd3");
+
+    concurrency_tag ctag;
+    ctag.set(history.get_master_tag());
+
+    REQUIRE(history.convert(history_db::bank_format_binary));
+    REQUIRE(strcmp(ctag.get(), history.get_master_tag()) != 0);
+    history.load_rl_history(false);
+
+    SECTION("Converted")
+    {
+        char magic[4] = {};
+        FILE* file = fopen(master_path, "rb");
+        REQUIRE(file != nullptr);
+        fread(magic, 1, sizeof(magic), file);
+        fclose(file);
+
+        REQUIRE(memcmp(magic, "CLHB", 4) == 0);
+        REQUIRE(history.get_master_length() == 3);
+        expect_lines(history, { "cmd1 arg1", "cmd2 arg1 arg2", "cmd3" });
+    }
+
+    SECTION("Remove")
+    {
+        int file_size = os::get_file_size(master_path);
+        REQUIRE(history.remove("cmd2 arg1 arg2") == 1);
+        REQUIRE(os::get_file_size(master_path) == file_size);
+
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_length() == 2);
+        REQUIRE(history.get_master_deleted_count() == 1);
+        expect_lines(history, { "cmd1 arg1", "cmd3" });
+    }
+
+    SECTION("Torn")
+    {
+        // Part of a record header, as if a write was interrupted.
+        FILE* file = fopen(master_path, "ab");
+        REQUIRE(file != nullptr);
+        fwrite("\x05\0\0\0\0\0\xc1\xc1\x01", 1, 9, file);
+        fclose(file);
+
+        history.add("cmd4");
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_length() == 4);
+        REQUIRE(history.get_master_deleted_count() == 1);
+        expect_lines(history, { "cmd1 arg1", "cmd2 arg1 arg2", "cmd3", "cmd4" });
+
+        history.compact(true);
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_deleted_count() == 0);
+        expect_lines(history, { "cmd1 arg1", "cmd2 arg1 arg2", "cmd3", "cmd4" });
+    }
+
+    SECTION("Back to text")
+    {
+        REQUIRE(history.remove("cmd1 arg1") == 1);
+        REQUIRE(history.convert(history_db::bank_format_text));
+        history.load_rl_history(false);
+
+        REQUIRE(history.get_master_deleted_count() == 0);
+        expect_lines(history, { "cmd2 arg1 arg2", "cmd3" });
+
+        size_t line_bytes = strlen("cmd2 arg1 arg2") + 1 + strlen("cmd3") + 1;
+        REQUIRE(os::get_file_size(master_path) == line_bytes + history.get_master_tag_size());
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history compact")
+{
+    const char* master_path = "clink_history";
+    const char* compact_path = "clink_history.compact";
+
+    history_fixture fixture;
+
+    settings::find("history.shared")->set("true");
+    settings::find("history.max_lines")->set("3");
+    settings::find("history.dupe_mode")->set("erase_prev");
+
+    test_history_db history;
+    history.set_min_compact_threshold(3);
+    history.set_background_compact(true);
+
+    concurrency_tag ctag;
+    ctag.set(history.get_master_tag());
+
+    // Trimming to three lines deletes five, which starts a compaction.
+    static const char* history_lines[] = {
+        "cmd1", "cmd2", "cmd3", "cmd4", "cmd5", "cmd6", "cmd7", "cmd8",
+    };
+    for (const char* line : history_lines)
+        history.add(line);
+    history.load_rl_history();
+
+    SECTION("Background")
+    {
+        history.wait_for_compact();
+        history.load_rl_history();
+
+        REQUIRE(strcmp(ctag.get(), history.get_master_tag()) != 0);
+        REQUIRE(history.get_master_length() == 3);
+        REQUIRE(history.get_master_deleted_count() == 0);
+        REQUIRE(os::get_path_type(compact_path) == os::path_type_invalid);
+        expect_lines(history, { "cmd6", "cmd7", "cmd8" });
+
+        size_t line_bytes = 3 * (strlen("cmd1") + 1);
+        REQUIRE(os::get_file_size(master_path) == line_bytes + history.get_master_tag_size());
+    }
+
+    SECTION("Edits meanwhile")
+    {
+        // Whether these land before or after the snapshot, they're kept.
+        history.add("cmd9");
+        REQUIRE(history.remove("cmd7") == 1);
+
+        history.wait_for_compact();
+        history.load_rl_history(false);
+        REQUIRE(strcmp(ctag.get(), history.get_master_tag()) != 0);
+        expect_lines(history, { "cmd6", "cmd8", "cmd9" });
+    }
+
+    SECTION("Recover")
+    {
+        history.wait_for_compact();
+
+        // As if an instance stopped part way through replacing the master bank.
+        REQUIRE(os::copy(master_path, compact_path));
+        FILE* file = fopen(master_path, "r+b");
+        REQUIRE(file != nullptr);
+        fwrite("||", 1, 2, file);
+        fclose(file);
+
+        test_history_db recovered;
+        recovered.load_rl_history(false);
+        REQUIRE(os::get_path_type(compact_path) == os::path_type_invalid);
+        REQUIRE(recovered.get_master_deleted_count() == 0);
+        expect_lines(recovered, { "cmd6", "cmd7", "cmd8" });
+    }
+}
+
+//------------------------------------------------------------------------------
+// Adds hold a lock on the byte after the bank lock's while they write.  This
+// holds it too, so a partly written line looks like an add in flight.
+class append_in_flight
+{
+public:
+    append_in_flight(const char* path)
+    {
+        m_handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE,
+            nullptr, OPEN_EXISTING, 0, nullptr);
+        REQUIRE(m_handle != INVALID_HANDLE_VALUE);
+
+        m_overlapped.Offset = 1;
+        m_overlapped.OffsetHigh = 0x80000000;
+        REQUIRE(LockFileEx(m_handle, 0, 0, 1, 0, &m_overlapped));
+    }
+
+    ~append_in_flight()
+    {
+        UnlockFileEx(m_handle, 0, 1, 0, &m_overlapped);
+        CloseHandle(m_handle);
+    }
+
+private:
+    void*       m_handle;
+    OVERLAPPED  m_overlapped = {};
+};
+
+//------------------------------------------------------------------------------
+TEST_CASE("history append")
+{
+    const char* master_path = "clink_history";
+
+    history_fixture fixture;
+
+    settings::find("history.shared")->set("true");
+    settings::find("history.max_lines")->set("0");
+    settings::find("history.dupe_mode")->set("add");
+
+    test_history_db history;
+    history.add("cmd1");
+
+    auto write = [&] (const char* data, int length) {
+        FILE* file = fopen(master_path, "ab");
+        REQUIRE(file != nullptr);
+        fwrite(data, 1, length, file);
+        fclose(file);
+    };
+
+    SECTION("Text tail")
+    {
+        // An add that's part way through being written isn't read yet.
+        {
+            append_in_flight append(master_path);
+            write("cmd2", 4);
+            history.load_rl_history(false);
+            REQUIRE(history.get_master_deleted_count() == 0);
+            expect_lines(history, { "cmd1" });
+
+            write("\n", 1);
+        }
+
+        history.load_rl_history(false);
+        expect_lines(history, { "cmd1", "cmd2" });
+    }
+
+    SECTION("Unterminated")
+    {
+        // A last line saved without a newline (e.g. by an editor) is read, and
+        // the next add isn't run on from it.
+        write("cmd2", 4);
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_deleted_count() == 0);
+        expect_lines(history, { "cmd1", "cmd2" });
+
+        history.add("cmd3");
+        history.load_rl_history(false);
+        expect_lines(history, { "cmd1", "cmd2", "cmd3" });
+    }
+
+    SECTION("Binary tail")
+    {
+        REQUIRE(history.convert(history_db::bank_format_binary));
+
+        // Record header; length, flags, marker, time, hash.
+        unsigned int header[4] = { 4, 0xc1c10000, 0, str_hash("cmd2") };
+        write((const char*)header, sizeof(header));
+        write("cm", 2);
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_deleted_count() == 0);
+        expect_lines(history, { "cmd1" });
+
+        write("d2\n", 3);
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_deleted_count() == 0);
+        expect_lines(history, { "cmd1", "cmd2" });
+    }
+
+    SECTION("Concurrent")
+    {
+        // Each instance has handles of its own, as separate processes would.
+        static const int instance_count = 4;
+        static const int line_count = 500;
+        test_history_db instances[instance_count];
+
+        struct param
+        {
+            history_db*     history;
+            int             index;
+        };
+        param params[instance_count];
+        void* threads[instance_count];
+
+        auto thread = [] (void* param_ptr) -> DWORD {
+            const param& p = *(const param*)param_ptr;
+            str<64> line;
+            for (int i = 0; i < line_count; ++i)
+            {
+                line.format("instance%d line%d", p.index, i);
+                p.history->add(line.c_str());
+            }
+            return 0;
+        };
+
+        for (int i = 0; i < instance_count; ++i)
+        {
+            params[i] = { &instances[i], i };
+            threads[i] = CreateThread(nullptr, 0, thread, &params[i], 0, nullptr);
+            REQUIRE(threads[i] != nullptr);
+        }
+
+        for (void* handle : threads)
+        {
+            WaitForSingleObject(handle, INFINITE);
+            CloseHandle(handle);
+        }
+
+        // No line's lost or torn, and each instance's are in order.
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_deleted_count() == 0);
+        REQUIRE(history.get_master_length() == 1 + instance_count * line_count);
+
+        int next[instance_count] = {};
+        char buffer[history_db::line_buffer_size];
+        history_db::iter iter = history.read_lines(buffer);
+        str_iter line;
+        REQUIRE(iter.next(line));
+        while (iter.next(line))
+        {
+            int index, number;
+            str<64> text;
+            text.concat(line.get_pointer(), line.length());
+            REQUIRE(sscanf(text.c_str(), "instance%d line%d", &index, &number) == 2);
+            REQUIRE(index >= 0 && index < instance_count);
+            REQUIRE(number == next[index]);
+            ++next[index];
+        }
+
+        for (int count : next)
+            REQUIRE(count == line_count);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void expect_rl_lines(const std::initializer_list<const char*>& lines)
+{
+    REQUIRE(history_length == int(lines.size()));
+
+    HIST_ENTRY** list = history_list();
+    for (const char* expected : lines)
+        REQUIRE(strcmp((*list++)->line, expected) == 0);
+}
+
+//------------------------------------------------------------------------------
+static void expect_lines_reverse(history_db& history, const std::initializer_list<const char*>& lines, unsigned int buffer_size=history_db::line_buffer_size)
+{
+    char buffer[history_db::line_buffer_size];
+    history_db::iter iter = history.read_lines_reverse(buffer, buffer_size);
+
+    str_iter line;
+    for (const char* expected : lines)
+    {
+        REQUIRE(iter.next(line));
+        REQUIRE(line.length() == strlen(expected));
+        REQUIRE(memcmp(line.get_pointer(), expected, line.length()) == 0);
+    }
+
+    REQUIRE(!iter.next(line));
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history reverse")
+{
+    const char* master_path = "clink_history";
+
+    history_fixture fixture;
+
+    settings::find("history.shared")->set("true");
+    settings::find("history.max_lines")->set("0");
+    settings::find("history.dupe_mode")->set("add");
+
+    auto write = [&] (const char* data, int length) {
+        FILE* file = fopen(master_path, "ab");
+        REQUIRE(file != nullptr);
+        fwrite(data, 1, length, file);
+        fclose(file);
+    };
+
+    SECTION("Text")
+    {
+        test_history_db history;
+        for (const char* line : { "cmd1", "cmd2", "cmd3", "0123456789", "cmd5" })
+            REQUIRE(history.add(line));
+        REQUIRE(history.remove("cmd3") == 1);
+
+        // An add that's part way through being written isn't read yet.
+        {
+            append_in_flight append(master_path);
+            write("cmd6", 4);
+            expect_lines_reverse(history, { "cmd5", "0123456789", "cmd2", "cmd1" });
+
+            // Nor does the buffer's size matter.
+            for (unsigned int i = 0; i < 256; ++i)
+            {
+                char buffer[256];
+                history_db::iter iter = history.read_lines_reverse(buffer, i);
+
+                str_iter line;
+                int count = 0;
+                for (; iter.next(line); ++count)
+                    REQUIRE(line.length() >= 4);
+                REQUIRE((count == 0 || count == 4));
+            }
+        }
+
+        // Without an add in flight, it's a line that was saved without one.
+        expect_lines_reverse(history, { "cmd6", "cmd5", "0123456789", "cmd2", "cmd1" });
+    }
+
+    SECTION("Binary")
+    {
+        test_history_db history;
+        for (const char* line : { "cmd1", "cmd2", "cmd3" })
+            REQUIRE(history.add(line));
+        REQUIRE(history.convert(history_db::bank_format_binary));
+
+        // A ten character line has a line feed in its record's header.
+        REQUIRE(history.add("0123456789"));
+        REQUIRE(history.add("cmd5"));
+        REQUIRE(history.remove("cmd2") == 1);
+        expect_lines_reverse(history, { "cmd5", "0123456789", "cmd3", "cmd1" });
+
+        // Part of a record header, as if a write was interrupted.
+        write("\x05\0\0\0\0\0\xc1\xc1\x01", 9);
+        expect_lines_reverse(history, { "cmd5", "0123456789", "cmd3", "cmd1" });
+
+        history.add("cmd6");
+        expect_lines_reverse(history, { "cmd6", "cmd5", "0123456789", "cmd3", "cmd1" });
+        expect_lines_reverse(history, { "cmd6", "cmd5", "0123456789", "cmd3", "cmd1" }, 256);
+    }
+
+    SECTION("Long lines")
+    {
+        str<> long_line;
+        while (long_line.length() < 100000)
+            long_line << "0123456789";
+
+        test_history_db history;
+        REQUIRE(history.add("before"));
+        REQUIRE(history.add(long_line.c_str()));
+        REQUIRE(history.add("after"));
+
+        for (int binary = 0; binary < 2; ++binary)
+        {
+            if (binary)
+                REQUIRE(history.convert(history_db::bank_format_binary));
+            expect_lines_reverse(history, { "after", long_line.c_str(), "before" }, 512);
+        }
+    }
+
+    SECTION("Sessioned")
+    {
+        settings::find("history.shared")->set("false");
+        {
+            test_history_db history;
+            REQUIRE(history.add("cmd1"));
+        }
+
+        // The session's lines are the newest.
+        test_history_db history;
+        REQUIRE(history.add("cmd2"));
+        REQUIRE(history.add("cmd3"));
+        expect_lines_reverse(history, { "cmd3", "cmd2", "cmd1" });
+
+        char buffer[history_db::line_buffer_size];
+        history_db::line_id id;
+        {
+            str_iter line;
+            history_db::iter iter = history.read_lines_reverse(buffer);
+            iter.next(line);
+            id = iter.next(line);
+        }
+
+        REQUIRE(history.remove(id));
+        expect_lines_reverse(history, { "cmd3", "cmd1" });
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history share")
+{
+    const char* master_path = "clink_history";
+
+    history_fixture fixture;
+
+    settings::find("history.shared")->set("true");
+    settings::find("history.shared_memory")->set("true");
+    settings::find("history.max_lines")->set("0");
+    settings::find("history.dupe_mode")->set("add");
+
+    test_history_db history;
+    history.add("cmd1");
+    history.add("cmd2");
+    history.load_rl_history(false);
+
+    // Another instance, with its own view of the master bank.
+    test_history_db other;
+    other.add("cmd3");
+    other.add("cmd4");
+
+    SECTION("Add")
+    {
+        REQUIRE(history.load_shared());
+        REQUIRE(history.get_master_length() == 4);
+        expect_rl_lines({ "cmd1", "cmd2", "cmd3", "cmd4" });
+
+        // Nothing new is nothing to do.
+        REQUIRE(history.load_shared());
+        expect_rl_lines({ "cmd1", "cmd2", "cmd3", "cmd4" });
+    }
+
+    SECTION("Remove")
+    {
+        REQUIRE(other.remove("cmd2") == 1);
+        REQUIRE(history.load_shared());
+        REQUIRE(history.get_master_length() == 3);
+        REQUIRE(history.get_master_deleted_count() == 1);
+        expect_rl_lines({ "cmd1", "cmd3", "cmd4" });
+
+        // What's caught up on matches what's read.
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_deleted_count() == 1);
+        expect_rl_lines({ "cmd1", "cmd3", "cmd4" });
+    }
+
+    SECTION("Unpublished")
+    {
+        FILE* file = fopen(master_path, "ab");
+        REQUIRE(file != nullptr);
+        fputs("cmd5\n", file);
+        fclose(file);
+
+        REQUIRE(!history.load_shared());
+        history.load_rl_history(false);
+        expect_rl_lines({ "cmd1", "cmd2", "cmd3", "cmd4", "cmd5" });
+    }
+
+    SECTION("Cleared")
+    {
+        other.clear();
+        other.add("cmd5");
+        REQUIRE(!history.load_shared());
+        history.load_rl_history(false);
+        expect_rl_lines({ "cmd5" });
+    }
+
+    SECTION("Wrapped")
+    {
+        // Each line's more than 64 bytes, so these fill the ring and more.
+        str<> line;
+        for (int i = 0; i < history_share::ring_size / 64; ++i)
+        {
+            line.format("cmd%d", i);
+            line.concat("________________________________________________________________");
+            other.add(line.c_str());
+        }
+
+        REQUIRE(!history.load_shared());
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history dedupe")
+{
+    history_fixture fixture;
+
+    settings::find("history.shared")->set("true");
+    settings::find("history.max_lines")->set("0");
+    settings::find("history.dupe_mode")->set("add");
+    settings::find("history.erase_dupes")->set("false");
+
+    test_history_db history;
+    static const char* history_lines[] = {
+        "cmd1", "cmd2", "cmd1", "cmd3", "cmd2",
+    };
+    for (const char* line : history_lines)
+        history.add(line);
+
+    SECTION("Add")
+    {
+        history.load_rl_history();
+        REQUIRE(history.get_master_length() == 5);
+        expect_rl_lines({ "cmd1", "cmd2", "cmd1", "cmd3", "cmd2" });
+    }
+
+    SECTION("Most recent")
+    {
+        settings::find("history.dupe_mode")->set("erase_prev");
+        history.load_rl_history();
+        REQUIRE(history.get_master_length() == 3);
+        REQUIRE(history.get_master_deleted_count() == 0);
+        expect_rl_lines({ "cmd1", "cmd3", "cmd2" });
+
+        // The file's left alone.
+        expect_lines(history, { "cmd1", "cmd2", "cmd1", "cmd3", "cmd2" });
+    }
+
+    SECTION("Erase")
+    {
+        settings::find("history.dupe_mode")->set("erase_prev");
+        settings::find("history.erase_dupes")->set("true");
+        history.load_rl_history();
+        REQUIRE(history.get_master_length() == 3);
+        REQUIRE(history.get_master_deleted_count() == 2);
+        expect_rl_lines({ "cmd1", "cmd3", "cmd2" });
+        expect_lines(history, { "cmd1", "cmd3", "cmd2" });
+
+        // Removing a line afterwards still finds the right one in the file.
+        REQUIRE(history.remove(1, "cmd3"));
+        expect_lines(history, { "cmd1", "cmd2" });
+    }
+
+    SECTION("Oldest")
+    {
+        // Lines that are already in the history aren't added, so the first
+        // copy of each is the one that's kept.
+        settings::find("history.dupe_mode")->set("ignore");
+        settings::find("history.erase_dupes")->set("true");
+        history.load_rl_history();
+        REQUIRE(history.get_master_length() == 3);
+        REQUIRE(history.get_master_deleted_count() == 2);
+        expect_rl_lines({ "cmd1", "cmd2", "cmd3" });
+        expect_lines(history, { "cmd1", "cmd2", "cmd3" });
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history dedupe : large")
+{
+    history_fixture fixture;
+
+    settings::find("history.shared")->set("false");
+    settings::find("history.max_lines")->set("0");
+    settings::find("history.erase_dupes")->set("false");
+
+    // 50,000 lines, of which 20,000 are distinct.
+    write_history_lines(50000, 20000);
+
+    test_history_db history;
+
+    SECTION("Most recent")
+    {
+        // Each line's where its last copy was.
+        settings::find("history.dupe_mode")->set("erase_prev");
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_length() == 20000);
+
+        HIST_ENTRY** list = history_list();
+        REQUIRE(strcmp(list[0]->line, "git commit -m \"change 10000\"") == 0);
+        REQUIRE(strcmp(list[19999]->line, "git commit -m \"change 9999\"") == 0);
+    }
+
+    SECTION("Oldest")
+    {
+        // Each line's where its first copy was.
+        settings::find("history.dupe_mode")->set("ignore");
+        history.load_rl_history(false);
+        REQUIRE(history.get_master_length() == 20000);
+
+        HIST_ENTRY** list = history_list();
+        REQUIRE(strcmp(list[0]->line, "git commit -m \"change 0\"") == 0);
+        REQUIRE(strcmp(list[19999]->line, "git commit -m \"change 19999\"") == 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+BENCHMARK("History dedupe")
+{
+    history_fixture fixture;
+
+    settings::find("history.shared")->set("false");
+    settings::find("history.max_lines")->set("0");
+    settings::find("history.erase_dupes")->set("false");
+
+    // 50,000 lines, of which 20,000 are distinct.
+    write_history_lines(50000, 20000);
+
+    test_history_db history;
+
+    // Deduplicating costs a hash and an arena copy per line, which should be
+    // small beside reading the file and building Readline's list.
+    clatch::timer timer;
+    settings::find("history.dupe_mode")->set("add");
+    history.load_rl_history(false);
+    timer.report("Load 50000 lines");
+
+    settings::find("history.dupe_mode")->set("erase_prev");
+    history.load_rl_history(false);
+    timer.report("Load 50000 lines, keeping 20000");
+}
+
+//------------------------------------------------------------------------------
+BENCHMARK("History banks")
+{
+    // The same 50,000 lines read, searched and compacted in a text bank, then
+    // in a binary one.
+    for (int binary = 0; binary < 2; ++binary)
+    {
+        history_fixture fixture;
+
+        settings::find("history.shared")->set("false");
+        settings::find("history.max_lines")->set("0");
+        settings::find("history.dupe_mode")->set("add");
+
+        write_history_lines(50000, 50000);
+
+        test_history_db history;
+        if (binary)
+            REQUIRE(history.convert(history_db::bank_format_binary));
+
+        clatch::timer timer;
+        auto report = [&] (const char* what) {
+            str<64> line;
+            line.format("%s, %s", what, binary ? "binary" : "text");
+            timer.report(line.c_str());
+        };
+
+        history.load_rl_history(false);
+        report("Load 50000 lines");
+
+        REQUIRE(history.find("git commit -m \"change 49999\""));
+        REQUIRE(!history.find("git commit -m \"change\""));
+        report("Find the newest line and a missing one");
+
+        // Trimming to 40,000 lines deletes the oldest 10,000 first.
+        settings::find("history.max_lines")->set("40000");
+        REQUIRE(history.compact(true));
+        report("Compact 50000 lines to 40000");
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history index")
+{
+    history_index index;
+    index.add("dir /s /b");
+    index.add("git commit -m \"Fix\"");
+    index.add("cd ..");
+    index.add("GIT STATUS");
+    index.add("git status");
+    REQUIRE(index.size() == 5);
+
+    SECTION("Find")
+    {
+        REQUIRE(index.find("git", 4, -1) == 4);
+        REQUIRE(index.find("git", 2, -1) == 1);
+        REQUIRE(index.find("git", 0, 1) == 1);
+        REQUIRE(index.find("git", 2, 1) == 3);
+        REQUIRE(index.find("status", 2, -1) == -1);
+        REQUIRE(index.find("xyz", 4, -1) == -1);
+        REQUIRE(index.find("it commit", 4, -1) == 1);
+    }
+
+    SECTION("Unindexable")
+    {
+        // Too short to narrow down, so every line's a candidate.
+        REQUIRE(index.find("cd", 4, -1) == 4);
+        REQUIRE(index.find("", 1, 1) == 1);
+        REQUIRE(index.find("\xc3\xa9t", 3, -1) == 3);
+
+        // Out of range.
+        REQUIRE(index.find("git", 5, -1) == -1);
+        REQUIRE(index.find("git", -1, 1) == -1);
+    }
+
+    SECTION("Case fold")
+    {
+        // Trigrams are always folded; the caller does the exact compare.
+        REQUIRE(index.find("Status", 4, -1) == 4);
+        REQUIRE(index.find("STAT", 2, 1) == 3);
+
+        // 'i' and 'k' can't rule lines out when case folding.
+        REQUIRE(index.find("gik", 4, -1) == -1);
+        REQUIRE(index.find("gik", 4, -1, true) == 4);
+    }
+
+    SECTION("Remove")
+    {
+        index.remove(1);
+        REQUIRE(index.size() == 4);
+        REQUIRE(index.find("commit", 3, -1) == -1);
+        REQUIRE(index.find("git", 3, -1) == 3);
+        REQUIRE(index.find("GIT", 0, 1) == 2);
+
+        index.remove(0);
+        index.remove(2);
+        REQUIRE(index.size() == 2);
+        REQUIRE(index.find("cd ..", 1, -1) == 0);
+        REQUIRE(index.find("git", 1, -1) == 1);
+
+        index.add("git log");
+        REQUIRE(index.find("git", 2, -1) == 2);
+        REQUIRE(index.find("log", 0, 1) == 2);
+
+        index.remove(7);
+        REQUIRE(index.size() == 3);
+    }
+
+    SECTION("Replace")
+    {
+        index.replace(2, "cd \\temp");
+        REQUIRE(index.find("temp", 4, -1) == 2);
+        REQUIRE(index.find("cd ..", 4, -1) == 2);
+    }
+
+    SECTION("Clear")
+    {
+        index.clear();
+        REQUIRE(index.size() == 0);
+        REQUIRE(index.find("git", 0, 1) == -1);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history index : large")
+{
+    // Searches go straight to the lines that can match regardless of how many
+    // there are.
+    history_index index;
+    str<> line;
+    for (int i = 0; i < 50000; ++i)
+    {
+        line.format("git commit -m \"change %d\"", i);
+        index.add(line.c_str());
+        if (i == 100)
+            index.add("xcopy /s src dest");
+    }
+
+    REQUIRE(index.size() == 50001);
+    REQUIRE(index.find("xcopy", 50000, -1) == 101);
+    REQUIRE(index.find("xcopy", 100, -1) == -1);
+    REQUIRE(index.find("change 12345", 50000, -1) == 12346);
+
+    // Candidates have every trigram but aren't necessarily matches.
+    REQUIRE(index.find("change 4999\"", 50000, -1) == 50000);
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history search : stifled")
+{
+    history_fixture fixture;
+
+    settings::find("history.max_lines")->set("0");
+    settings::find("history.dupe_mode")->set("add");
+
+    test_history_db history;
+    static const char* history_lines[] = {
+        "dir /s", "git log", "cd ..",
+    };
+    for (const char* line : history_lines)
+        history.add(line);
+    history.load_rl_history();
+
+    auto search = [] (const char* needle) {
+        history_set_pos(history_length);
+        if (history_search(needle, -1) < 0)
+            return -1;
+        return where_history();
+    };
+
+    auto suggest = [&history] (const char* line) {
+        const char* suggestion = history.suggest(line);
+        return suggestion ? suggestion : "";
+    };
+
+    stifle_history(3);
+    REQUIRE(search("git") == 1);
+    REQUIRE(search("xcopy") == -1);
+    REQUIRE(strcmp(suggest("di"), "dir /s") == 0);
+
+    // Each line added drops the oldest, so the length stays the same.
+    add_history("xcopy a b");
+    REQUIRE(history_length == 3);
+    REQUIRE(search("xcopy") == 2);
+    REQUIRE(search("git") == 0);
+    REQUIRE(search("dir") == -1);
+    REQUIRE(strcmp(suggest("xc"), "xcopy a b") == 0);
+    REQUIRE(strcmp(suggest("di"), "") == 0);
+
+    add_history("git status");
+    REQUIRE(search("git") == 2);
+    REQUIRE(search("git l") == -1);
+    REQUIRE(strcmp(suggest("git"), "git status") == 0);
+
+    unstifle_history();
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history prefix index")
+{
+    history_prefix_index index;
+    index.add("dir /w");
+    index.add("cd src");
+    index.add("dir /s");
+    index.add("cd ..");
+
+    SECTION("Newest")
+    {
+        REQUIRE(strcmp(index.find("d"), "dir /s") == 0);
+        REQUIRE(strcmp(index.find("cd"), "cd ..") == 0);
+        REQUIRE(index.find("dir /w") == nullptr);
+        REQUIRE(index.find("git") == nullptr);
+        REQUIRE(index.find("") == nullptr);
+    }
+
+    SECTION("Repeats")
+    {
+        index.add("dir /w");
+        REQUIRE(index.size() == 4);
+        REQUIRE(strcmp(index.find("dir"), "dir /w") == 0);
+
+        index.remove("dir /w");
+        REQUIRE(strcmp(index.find("dir"), "dir /w") == 0);
+        index.remove("dir /w");
+        REQUIRE(strcmp(index.find("dir"), "dir /s") == 0);
+        REQUIRE(index.size() == 3);
+    }
+
+    SECTION("Exact")
+    {
+        index.add("cd");
+        REQUIRE(strcmp(index.find("cd"), "cd ..") == 0);
+        REQUIRE(index.find("cd ..") == nullptr);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history prefix index : large")
+{
+    history_prefix_index index;
+    str<> line;
+    for (int i = 0; i < 50000; ++i)
+    {
+        line.format("git commit -m \"change %d\"", i % 20000);
+        index.add(line.c_str());
+    }
+
+    REQUIRE(index.size() == 20000);
+    REQUIRE(strcmp(index.find("git"), "git commit -m \"change 9999\"") == 0);
+    REQUIRE(strcmp(index.find("git commit -m \"change 1"), "git commit -m \"change 1999\"") == 0);
+
+    index.add("git commit -m \"change 5\"");
+    REQUIRE(strcmp(index.find("git commit -m \"change 5"), "git commit -m \"change 5\"") == 0);
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("history frecency")
+{
+    // Start with an empty state dir.
+    const char* empty_fs[] = { nullptr };
+    fs_fixture fs(empty_fs);
+
+    app_context::desc context_desc;
+    str_base(context_desc.state_dir).copy(fs.get_root());
+    app_context context(context_desc);
+
+    str<280> path;
+    context.get_frecency_path(path);
+
+    const frecency_db::kind dir = frecency_db::kind_dir;
+    const frecency_db::kind command = frecency_db::kind_command;
+    const unsigned int now = (unsigned int)time(nullptr);
+    const unsigned int month_ago = now - 30 * 24 * 60 * 60;
+
+    frecency_db frecency;
+    REQUIRE(frecency.open(path.c_str()));
+
+    auto get_file_size = [&] () {
+        FILE* file = fopen(path.c_str(), "rb");
+        REQUIRE(file != nullptr);
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fclose(file);
+        return size;
+    };
+
+    str<280> compact_path(path.c_str());
+    compact_path << ".compact";
+
+    SECTION("Ranking")
+    {
+        frecency.add(dir, "c:\\src", now);
+        for (int i = 0; i < 3; ++i)
+            frecency.add(dir, "c:\\src\\clink", now);
+        for (int i = 0; i < 3; ++i)
+            frecency.add(dir, "c:\\old", month_ago);
+
+        std::vector<frecency_db::result> top;
+        frecency.get_top(dir, 10, top);
+        REQUIRE(top.size() == 3);
+        REQUIRE(strcmp(top[0].name, "c:\\src\\clink") == 0);
+        REQUIRE(strcmp(top[1].name, "c:\\src") == 0);
+        REQUIRE(strcmp(top[2].name, "c:\\old") == 0);
+        REQUIRE(top[0].score > top[1].score);
+        REQUIRE(top[1].score > top[2].score);
+
+        frecency.get_top(dir, 1, top);
+        REQUIRE(top.size() == 1);
+
+        frecency.get_top(command, 10, top);
+        REQUIRE(top.empty());
+        REQUIRE(frecency.get_score(command, "c:\\src") == 0);
+    }
+
+    SECTION("Spelling")
+    {
+        frecency.add(dir, "C:\\Src\\", now);
+        frecency.add(dir, "c:/src", now);
+        REQUIRE(frecency.get_score(dir, "c:\\SRC") == 2 * frecency_db::visit_rank * 4);
+
+        frecency.add(command, "dir", now);
+        REQUIRE(frecency.get_score(command, "dir") != 0);
+        REQUIRE(frecency.get_score(command, "DIR") == 0);
+
+        std::vector<frecency_db::result> top;
+        frecency.get_top(dir, 10, top);
+        REQUIRE(top.size() == 1);
+    }
+
+    SECTION("Shared")
+    {
+        frecency_db other;
+        REQUIRE(other.open(path.c_str()));
+
+        frecency.add(command, "cmd1", now);
+        REQUIRE(other.get_score(command, "cmd1") != 0);
+
+        // Rewriting the file doesn't lose or repeat anything.
+        REQUIRE(other.compact(true));
+        frecency.add(command, "cmd1", now);
+        other.add(command, "cmd2", now);
+        REQUIRE(frecency.get_score(command, "cmd1") == other.get_score(command, "cmd1"));
+        REQUIRE(frecency.get_score(command, "cmd1") == 2 * frecency_db::visit_rank * 4);
+        REQUIRE(frecency.get_score(command, "cmd2") == frecency_db::visit_rank * 4);
+    }
+
+    SECTION("Compact")
+    {
+        str<> line;
+        for (int i = 0; i < 500; ++i)
+        {
+            line.format("cmd%d", i % 5);
+            frecency.add(command, line.c_str(), now);
+        }
+
+        // Reading finds the file's mostly repeats and compacts it.
+        long size = get_file_size();
+        REQUIRE(frecency.get_score(command, "cmd0") == 100 * frecency_db::visit_rank * 4);
+        REQUIRE(get_file_size() < size / 10);
+        REQUIRE(os::get_path_type(compact_path.c_str()) == os::path_type_invalid);
+
+        frecency_db other;
+        REQUIRE(other.open(path.c_str()));
+        for (int i = 0; i < 5; ++i)
+        {
+            line.format("cmd%d", i);
+            REQUIRE(other.get_score(command, line.c_str()) == 100 * frecency_db::visit_rank * 4);
+        }
+    }
+
+    SECTION("Compact when adding")
+    {
+        // An instance that only adds still compacts the file now and then.
+        frecency.add(command, "cmd", now);
+        long line_size = get_file_size();
+        for (int i = 1; i < 1000; ++i)
+            frecency.add(command, "cmd", now);
+
+        REQUIRE(get_file_size() < line_size * 400);
+
+        frecency_db other;
+        REQUIRE(other.open(path.c_str()));
+        REQUIRE(other.get_score(command, "cmd") == 1000 * frecency_db::visit_rank * 4);
+    }
+
+    SECTION("Recover")
+    {
+        // An instance died rewriting the file, after saving its copy.
+        FILE* file = fopen(path.c_str(), "wb");
+        REQUIRE(file != nullptr);
+        fprintf(file, "|FRECENCY_1_2_3\nc %u 300 cm", now);
+        fclose(file);
+
+        file = fopen(compact_path.c_str(), "wb");
+        REQUIRE(file != nullptr);
+        fprintf(file, "|FRECENCY_1_2_3\nc %u 300 cmd\n", now);
+        fclose(file);
+
+        frecency_db other;
+        REQUIRE(other.open(path.c_str()));
+        REQUIRE(os::get_path_type(compact_path.c_str()) == os::path_type_invalid);
+        REQUIRE(other.get_score(command, "cmd") == 3 * frecency_db::visit_rank * 4);
+        REQUIRE(frecency.get_score(command, "cmd") == 3 * frecency_db::visit_rank * 4);
+    }
+
+    SECTION("Aging")
+    {
+        FILE* file = fopen(path.c_str(), "ab");
+        REQUIRE(file != nullptr);
+        fprintf(file, "c %u %u big\n", month_ago, frecency_db::max_total_rank);
+        fprintf(file, "c %u %u small\n", month_ago, frecency_db::visit_rank);
+        fclose(file);
+
+        REQUIRE(frecency.get_score(command, "small") != 0);
+        REQUIRE(frecency.compact(true));
+        REQUIRE(frecency.get_score(command, "small") == 0);
+        REQUIRE(frecency.get_score(command, "big") != 0);
+        REQUIRE(frecency.get_score(command, "big") < frecency_db::max_total_rank / 4);
+    }
+
+    SECTION("History")
+    {
+        settings::find("history.shared")->set("true");
+        settings::find("history.dupe_mode")->set("ignore");
+
+        test_history_db history;
+        history.set_frecency(&frecency);
+        REQUIRE(history.add("cmd1"));
+        REQUIRE(history.add("cmd1"));
+        REQUIRE(history.add("cmd2"));
+        REQUIRE(frecency.get_score(command, "cmd1") == 2 * frecency_db::visit_rank * 4);
+        REQUIRE(frecency.get_score(command, "cmd2") == frecency_db::visit_rank * 4);
+    }
+}
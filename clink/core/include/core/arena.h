@@ -0,0 +1,63 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+//------------------------------------------------------------------------------
+// Bump allocator over a chain of heap blocks.  Allocations are never freed
+// individually; the arena is rewound to a mark, cleared, or destroyed instead.
+// Requests larger than the block size get a block of their own, which is linked
+// behind the current block so what's left of that is still used.
+class arena
+{
+    struct block;
+
+public:
+    struct mark
+    {
+        block*                  m_block;
+        block*                  m_prev;
+        unsigned int            m_used;
+    };
+
+                                arena(unsigned int block_size=4096);
+                                ~arena();
+    void*                       alloc(unsigned int size, unsigned int align=sizeof(void*));
+    template <class T> T*       calloc(unsigned int count=1);
+    const char*                 store(const char* str, int length=-1);
+    mark                        get_mark() const;
+    void                        rewind(const mark& mark);
+    void                        clear();
+    bool                        contains(const void* ptr) const;
+    unsigned int                get_block_count() const { return m_block_count; }
+    unsigned int                get_alloc_count() const { return m_alloc_count; }
+
+private:
+    struct block
+    {
+        block*                  prev;
+        unsigned int            size;
+        unsigned int            used;
+    };
+
+    static unsigned int         get_header_size();
+    static char*                get_data(block* block);
+    block*                      new_block(unsigned int size);
+    void                        free_block();
+    block*                      m_head;
+    unsigned int                m_block_size;
+    unsigned int                m_block_count;
+    unsigned int                m_alloc_count;
+
+                                arena(const arena&) = delete;
+    void                        operator = (const arena&) = delete;
+};
+
+//------------------------------------------------------------------------------
+template <class T> T* arena::calloc(unsigned int count)
+{
+    void* ptr = alloc(sizeof(T) * count, alignof(T));
+    if (ptr)
+        memset(ptr, 0, sizeof(T) * count);
+    return (T*)ptr;
+}
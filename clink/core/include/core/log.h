@@ -10,6 +10,18 @@
 #define LOG(...)    logger::info(__FUNCTION__, __LINE__, __VA_ARGS__)
 #define ERR(...)    logger::error(__FUNCTION__, __LINE__, __VA_ARGS__)
 
+//------------------------------------------------------------------------------
+// Times the rest of the enclosing scope as a span named 'name', which must be a
+// string literal.  Spans cost a null check unless a tracer exists, and compile
+// away entirely when CLINK_NO_TRACE is defined.
+#if defined(CLINK_NO_TRACE)
+#   define TRACE_SCOPE(name)
+#else
+#   define TRACE_SCOPE(name)            TRACE_SCOPE_IMPL(name, __LINE__)
+#   define TRACE_SCOPE_IMPL(name, line) TRACE_SCOPE_VAR(name, line)
+#   define TRACE_SCOPE_VAR(name, line)  trace_scope trace_scope_##line(name)
+#endif
+
 //------------------------------------------------------------------------------
 class logger
     : public singleton<logger>
@@ -18,19 +30,93 @@ public:
     virtual         ~logger();
     static void     info(const char* function, int line, const char* fmt, ...);
     static void     error(const char* function, int line, const char* fmt, ...);
+    static void     flush();
 
 protected:
     virtual void    emit(const char* function, int line, const char* fmt, va_list args) = 0;
+    virtual void    flush_lines() {}
 };
 
 //------------------------------------------------------------------------------
+// Lines are formatted into a fixed size buffer and written to the log file
+// when it fills, when an error is logged, when logger::flush() is called (at
+// the end of each edit), on destruction, and at exit.
 class file_logger
     : public logger
 {
 public:
                     file_logger(const char* log_path);
+                    ~file_logger();
     virtual void    emit(const char* function, int line, const char* fmt, va_list args) override;
+    virtual void    flush_lines() override;
 
 private:
+    void            write_buffer();
     str<256>        m_log_path;
+    char*           m_buffer;
+    unsigned int    m_used;
+    void*           m_lock;
+};
+
+
+
+//------------------------------------------------------------------------------
+// Collects trace spans and appends them to a file as Chrome trace events, in
+// the JSON array format (`clink trace` closes the array).  Events are buffered
+// and written when the buffer fills, when tracer::flush() is called (at the
+// end of each edit), and on destruction.
+class tracer
+    : public singleton<tracer>
+{
+public:
+                    tracer(const char* trace_path);
+                    ~tracer();
+    static void     flush();
+    static long long now();
+    void            add(const char* name, long long start, long long end);
+
+private:
+    struct event
+    {
+        const char* name;
+        long long   start;
+        long long   end;
+        unsigned    thread_id;
+    };
+
+    void            write_events();
+    str<256>        m_trace_path;
+    event*          m_events;
+    unsigned int    m_count;
+    void*           m_lock;
+};
+
+//------------------------------------------------------------------------------
+class trace_scope
+{
+public:
+                    trace_scope(const char* name);
+                    ~trace_scope();
+
+private:
+    const char*     m_name;
+    long long       m_start;
 };
+
+//------------------------------------------------------------------------------
+inline trace_scope::trace_scope(const char* name)
+: m_name(tracer::get() ? name : nullptr)
+{
+    if (m_name)
+        m_start = tracer::now();
+}
+
+//------------------------------------------------------------------------------
+inline trace_scope::~trace_scope()
+{
+    if (!m_name)
+        return;
+
+    if (tracer* instance = tracer::get())
+        instance->add(m_name, m_start, tracer::now());
+}
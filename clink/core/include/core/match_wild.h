@@ -18,8 +18,8 @@ bool match_char_impl(int pc, int fc)
 {
     if (MODE > 0)
     {
-        pc = (pc > 0xffff) ? pc : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(pc)))));
-        fc = (fc > 0xffff) ? fc : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(fc)))));
+        pc = fold_case(pc);
+        fc = fold_case(fc);
     }
 
     if (MODE > 1)
@@ -15,8 +15,17 @@ enum {
     path_type_dir,
 };
 
+struct file_stamp
+{
+    bool                operator == (const file_stamp& rhs) const { return size == rhs.size && modified == rhs.modified; }
+    unsigned long long  size;
+    unsigned long long  modified;
+};
+
 int     get_path_type(const char* path);
 int     get_file_size(const char* path);
+bool    get_file_stamp(const char* path, file_stamp& out);
+bool    is_stamp_recent(const file_stamp& stamp);
 bool    is_hidden(const char* path);
 void    get_current_dir(str_base& out);
 bool    set_current_dir(const char* dir);
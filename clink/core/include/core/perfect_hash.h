@@ -0,0 +1,231 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <string.h>
+
+//------------------------------------------------------------------------------
+constexpr int perfect_hash_slot_count(int key_count)
+{
+    // At least twice as many slots as keys keeps the seed searches short.
+    int count = 4;
+    while (count < key_count * 2)
+        count <<= 1;
+    return count;
+}
+
+//------------------------------------------------------------------------------
+// Perfect hash over a fixed set of strings, built by the compiler.  KEYS is a
+// literal type with a constexpr 'const char* get(int index) const' returning
+// each of COUNT keys.  Every key gets a slot of its own so a lookup hashes the
+// input once and compares against at most one key.  Empty keys are skipped and
+// where a key repeats the first one wins.
+template <int COUNT>
+class perfect_hash
+{
+public:
+    template <class KEYS> constexpr perfect_hash(const KEYS& keys);
+    constexpr bool          is_valid() const { return m_valid; }
+    template <class KEYS> int find(const KEYS& keys, const char* in, int length) const;
+    template <class KEYS> int find_prefix(const KEYS& keys, const char* in, int& length) const;
+
+private:
+    static constexpr unsigned int hash(unsigned int hash, char c);
+    static constexpr unsigned int mix(unsigned int hash, unsigned int seed);
+    static constexpr int    get_bucket(unsigned int hash);
+    template <class KEYS> int match(const KEYS& keys, unsigned int hash, const char* in, int length) const;
+    static constexpr int    slot_count = perfect_hash_slot_count(COUNT);
+    static constexpr int    bucket_count = slot_count / 4;
+    static constexpr int    max_prefix = 31;
+    unsigned short          m_seeds[bucket_count];
+    unsigned short          m_slots[slot_count]; // key index + 1, or 0 if empty.
+    unsigned int            m_lengths;           // Bit n set if a key has length n.
+    bool                    m_valid;
+};
+
+//------------------------------------------------------------------------------
+template <int COUNT>
+constexpr unsigned int perfect_hash<COUNT>::hash(unsigned int hash, char c)
+{
+    // Arithmetic's done in 64 bits and truncated so the compiler doesn't see
+    // (and warn about) unsigned overflow in constant expressions.
+    return (unsigned int)((hash * 33ull) ^ (unsigned char)c);
+}
+
+//------------------------------------------------------------------------------
+template <int COUNT>
+constexpr unsigned int perfect_hash<COUNT>::mix(unsigned int hash, unsigned int seed)
+{
+    hash ^= (unsigned int)(seed * 0x9e3779b9ull);
+    hash ^= hash >> 16;
+    hash = (unsigned int)(hash * 0x85ebca6bull);
+    hash ^= hash >> 13;
+    return hash & (slot_count - 1);
+}
+
+//------------------------------------------------------------------------------
+template <int COUNT>
+constexpr int perfect_hash<COUNT>::get_bucket(unsigned int hash)
+{
+    // Keys often differ only in their last byte or two, which djb2 leaves in
+    // its low bits; scatter them so buckets stay small.
+    return (unsigned int)((hash * 0x9e3779b9ull) >> 16) & (bucket_count - 1);
+}
+
+//------------------------------------------------------------------------------
+template <int COUNT>
+template <class KEYS>
+constexpr perfect_hash<COUNT>::perfect_hash(const KEYS& keys)
+: m_seeds()
+, m_slots()
+, m_lengths(0)
+, m_valid(false)
+{
+    static_assert(COUNT > 0 && COUNT < 0xffff, "Key count out of range");
+
+    // Hash the keys into buckets, chaining the keys in each bucket together.
+    unsigned int hashes[COUNT] = {};
+    int chains[COUNT] = {};
+    int heads[bucket_count] = {};
+    int sizes[bucket_count] = {};
+    int max_size = 0;
+
+    for (int i = 0; i < bucket_count; ++i)
+        heads[i] = -1;
+
+    for (int i = 0; i < COUNT; ++i)
+    {
+        const char* key = keys.get(i);
+        unsigned int value = 5381;
+        int length = 0;
+        for (; key[length]; ++length)
+            value = hash(value, key[length]);
+
+        if (!length)
+            continue;
+
+        int bucket = get_bucket(value);
+
+        bool repeat = false;
+        for (int j = heads[bucket]; j >= 0 && !repeat; j = chains[j])
+        {
+            if (hashes[j] != value)
+                continue;
+
+            const char* other = keys.get(j);
+            int k = 0;
+            while (key[k] && key[k] == other[k])
+                ++k;
+            repeat = (key[k] == other[k]);
+        }
+
+        if (repeat)
+            continue;
+
+        hashes[i] = value;
+        chains[i] = heads[bucket];
+        heads[bucket] = i;
+
+        if (++sizes[bucket] > max_size)
+            max_size = sizes[bucket];
+
+        if (length <= max_prefix)
+            m_lengths |= 1u << length;
+    }
+
+    // Find each bucket a seed that moves its keys into free slots.  The
+    // fullest buckets go first while there's the most room.
+    for (int size = max_size; size > 0; --size)
+    {
+        for (int bucket = 0; bucket < bucket_count; ++bucket)
+        {
+            if (sizes[bucket] != size)
+                continue;
+
+            unsigned int seed = 1;
+            for (; seed <= 0xffff; ++seed)
+            {
+                int i = heads[bucket];
+                for (; i >= 0; i = chains[i])
+                {
+                    int slot = mix(hashes[i], seed);
+                    if (m_slots[slot])
+                        break;
+
+                    m_slots[slot] = (unsigned short)(i + 1);
+                }
+
+                if (i < 0)
+                    break;
+
+                for (int j = heads[bucket]; j != i; j = chains[j])
+                    m_slots[mix(hashes[j], seed)] = 0;
+            }
+
+            if (seed > 0xffff)
+                return;
+
+            m_seeds[bucket] = (unsigned short)seed;
+        }
+    }
+
+    m_valid = true;
+}
+
+//------------------------------------------------------------------------------
+template <int COUNT>
+template <class KEYS>
+int perfect_hash<COUNT>::match(
+    const KEYS& keys,
+    unsigned int value,
+    const char* in,
+    int length) const
+{
+    int index = m_slots[mix(value, m_seeds[get_bucket(value)])] - 1;
+    if (index < 0)
+        return -1;
+
+    const char* key = keys.get(index);
+    if (strncmp(key, in, length) != 0 || key[length])
+        return -1;
+
+    return index;
+}
+
+//------------------------------------------------------------------------------
+template <int COUNT>
+template <class KEYS>
+int perfect_hash<COUNT>::find(const KEYS& keys, const char* in, int length) const
+{
+    unsigned int value = 5381;
+    for (int i = 0; i < length; ++i)
+        value = hash(value, in[i]);
+
+    return match(keys, value, in, length);
+}
+
+//------------------------------------------------------------------------------
+template <int COUNT>
+template <class KEYS>
+int perfect_hash<COUNT>::find_prefix(const KEYS& keys, const char* in, int& length) const
+{
+    // Finds the shortest key that 'in' starts with.  Keys longer than
+    // max_prefix are only found by find().
+    unsigned int value = 5381;
+    for (int i = 0; i < max_prefix && in[i]; )
+    {
+        value = hash(value, in[i]);
+        if (!(m_lengths & (1u << ++i)))
+            continue;
+
+        int index = match(keys, value, in, i);
+        if (index >= 0)
+        {
+            length = i;
+            return index;
+        }
+    }
+
+    return -1;
+}
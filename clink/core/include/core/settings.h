@@ -40,6 +40,7 @@ setting_iter        first();
 setting*            find(const char* name);
 bool                load(const char* file);
 bool                save(const char* file);
+void                forget_loaded();
 
 };
 
@@ -185,6 +186,7 @@ public:
                        setting_enum(const char* name, const char* short_desc, const char* long_desc, const char* values, int default_value);
     virtual bool       set(const char* value) override;
     virtual void       get(str_base& out) const override;
+    const char*        get_option(int& length) const;
     const char*        get_options() const;
 
     using setting_impl<int>::get;
@@ -68,14 +68,12 @@ protected:
     void                set_growable(bool state=true);
 
 private:
-    typedef unsigned short ushort;
-
     void                free_data();
     TYPE*               m_data;
-    ushort              m_size : 15;
-    ushort              m_growable : 1;
-    mutable ushort      m_length : 15;
-    ushort              m_owns_ptr : 1;
+    unsigned int        m_size : 31;
+    unsigned int        m_growable : 1;
+    mutable unsigned int m_length : 31;
+    unsigned int        m_owns_ptr : 1;
 };
 
 //------------------------------------------------------------------------------
@@ -135,7 +133,13 @@ bool str_impl<TYPE>::reserve(unsigned int new_size, bool exact)
         return false;
 
     if (!exact)
+    {
+        // Grow geometrically so repeated appends to long strings stay linear.
+        unsigned int grown = m_size + (m_size >> 1);
+        if (new_size < grown)
+            new_size = grown;
         new_size = (new_size + 63) & ~63;
+    }
 
     TYPE* new_data = (TYPE*)malloc(new_size * sizeof(TYPE));
     memcpy(new_data, c_str(), m_size * sizeof(TYPE));
@@ -245,7 +249,7 @@ void str_impl<TYPE>::trim()
     if (end < m_data + m_size)
     {
         *end = '\0';
-        m_length = end - pos;
+        m_length = (unsigned int)(end - pos);
     }
 
     while (pos < end)
@@ -257,7 +261,7 @@ void str_impl<TYPE>::trim()
 
     if (pos > m_data)
     {
-        m_length -= ushort(pos - m_data);
+        m_length -= (unsigned int)(pos - m_data);
         memmove(m_data, pos, (m_length + 1) * sizeof(m_data[0]));
     }
 }
@@ -31,6 +31,28 @@ private:
 
 
 
+//------------------------------------------------------------------------------
+// Lowercases a character for caseless comparisons.  ASCII is folded inline and
+// the rest of the BMP uses a table built on first use.
+int fold_case_bmp(int c);
+
+inline int fold_case(int c)
+{
+    if (c < 0x80)
+        return (unsigned(c - 'A') < 26) ? c + 0x20 : c;
+    return (c > 0xffff) ? c : fold_case_bmp(c);
+}
+
+//------------------------------------------------------------------------------
+// Returns how many leading bytes are identical ASCII (after folding case when
+// caseless is set), comparing eight bytes at a time.  Stops short of a nul.
+unsigned int str_compare_ascii_prefix(const char* lhs, const char* rhs, unsigned int max, bool caseless);
+
+inline unsigned int str_compare_ascii_prefix(const wchar_t*, const wchar_t*, unsigned int, bool)
+{
+    return 0;
+}
+
 //------------------------------------------------------------------------------
 // Returns how many characters match at the beginning of the strings, or -1 if
 // the entire strings match.
@@ -39,6 +61,11 @@ int str_compare_impl(str_iter_impl<T>& lhs, str_iter_impl<T>& rhs)
 {
     const T* start = lhs.get_pointer();
 
+    unsigned int max = min(lhs.max_length(), rhs.max_length());
+    unsigned int skip = str_compare_ascii_prefix(lhs.get_pointer(), rhs.get_pointer(), max, MODE > 0);
+    lhs.reset_pointer(lhs.get_pointer() + skip);
+    rhs.reset_pointer(rhs.get_pointer() + skip);
+
     while (1)
     {
         int c = lhs.peek();
@@ -48,8 +75,8 @@ int str_compare_impl(str_iter_impl<T>& lhs, str_iter_impl<T>& rhs)
 
         if (MODE > 0)
         {
-            c = (c > 0xffff) ? c : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(c)))));
-            d = (d > 0xffff) ? d : int(uintptr_t(CharLowerW(LPWSTR(uintptr_t(d)))));
+            c = fold_case(c);
+            d = fold_case(d);
         }
 
         if (MODE > 1)
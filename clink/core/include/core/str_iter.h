@@ -20,6 +20,7 @@ public:
     int             next();
     bool            more() const;
     unsigned int    length() const;
+    unsigned int    max_length() const;
 
 private:
     const T*        m_ptr;
@@ -84,6 +85,14 @@ template <typename T> bool str_iter_impl<T>::more() const
     return (m_ptr != m_end && *m_ptr != '\0');
 }
 
+//------------------------------------------------------------------------------
+// Like length() but doesn't scan for the nul terminator; strings without an
+// explicit length report ~0u.
+template <typename T> unsigned int str_iter_impl<T>::max_length() const
+{
+    return (m_ptr <= m_end) ? (unsigned int)(m_end - m_ptr) : ~0u;
+}
+
 
 
 //------------------------------------------------------------------------------
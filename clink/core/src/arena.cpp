@@ -0,0 +1,179 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "arena.h"
+
+#include <assert.h>
+
+// Block headers are padded so data starts on a c_max_align boundary, letting
+// allocations be aligned by rounding offsets alone.
+static const unsigned int c_max_align = 16;
+
+//------------------------------------------------------------------------------
+arena::arena(unsigned int block_size)
+: m_head(nullptr)
+, m_block_size(max(block_size, 256u))
+, m_block_count(0)
+, m_alloc_count(0)
+{
+}
+
+//------------------------------------------------------------------------------
+arena::~arena()
+{
+    while (m_head)
+        free_block();
+}
+
+//------------------------------------------------------------------------------
+unsigned int arena::get_header_size()
+{
+    return (sizeof(block) + c_max_align - 1) & ~(c_max_align - 1);
+}
+
+//------------------------------------------------------------------------------
+char* arena::get_data(block* block)
+{
+    return (char*)block + get_header_size();
+}
+
+//------------------------------------------------------------------------------
+void* arena::alloc(unsigned int size, unsigned int align)
+{
+    if (!size)
+        return nullptr;
+
+    assert(align && align <= c_max_align && !(align & (align - 1)));
+
+    unsigned int offset = 0;
+    if (m_head)
+        offset = (m_head->used + align - 1) & ~(align - 1);
+
+    block* target = m_head;
+    if (!m_head || offset + size > m_head->size || offset + size < offset)
+    {
+        target = new_block(size);
+        if (!target)
+            return nullptr;
+        offset = 0;
+    }
+
+    target->used = offset + size;
+    ++m_alloc_count;
+    return get_data(target) + offset;
+}
+
+//------------------------------------------------------------------------------
+const char* arena::store(const char* str, int length)
+{
+    if (!str)
+        str = "";
+
+    if (length < 0)
+        length = int(strlen(str));
+
+    char* ptr = (char*)alloc(length + 1, 1);
+    if (!ptr)
+        return nullptr;
+
+    memcpy(ptr, str, length);
+    ptr[length] = '\0';
+    return ptr;
+}
+
+//------------------------------------------------------------------------------
+arena::mark arena::get_mark() const
+{
+    return { m_head, m_head ? m_head->prev : nullptr, m_head ? m_head->used : 0 };
+}
+
+//------------------------------------------------------------------------------
+void arena::rewind(const mark& mark)
+{
+    while (m_head && m_head != mark.m_block)
+        free_block();
+
+    if (!m_head)
+        return;
+
+    // Oversized blocks allocated since the mark sit behind its block.
+    while (m_head->prev != mark.m_prev)
+    {
+        block* oversized = m_head->prev;
+        m_head->prev = oversized->prev;
+        free(oversized);
+        --m_block_count;
+    }
+
+    m_head->used = mark.m_used;
+}
+
+//------------------------------------------------------------------------------
+void arena::clear()
+{
+    // Keep the oldest block for reuse if it's a regular sized one.
+    while (m_head && m_head->prev)
+        free_block();
+
+    if (m_head && m_head->size != m_block_size)
+        free_block();
+
+    if (m_head)
+        m_head->used = 0;
+}
+
+//------------------------------------------------------------------------------
+bool arena::contains(const void* ptr) const
+{
+    for (block* walk = m_head; walk; walk = walk->prev)
+    {
+        const char* data = get_data(walk);
+        if (ptr >= data && ptr < data + walk->size)
+            return true;
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+arena::block* arena::new_block(unsigned int size)
+{
+    size = max(size, m_block_size);
+
+    unsigned int total = get_header_size() + size;
+    if (total < size)
+        return nullptr;
+
+    block* temp = (block*)malloc(total);
+    if (!temp)
+        return nullptr;
+
+    temp->size = size;
+    temp->used = 0;
+    ++m_block_count;
+
+    // An oversized block is filled by the one allocation, so it goes behind the
+    // head; the head keeps serving small allocations from its free space.
+    if (m_head && size > m_block_size)
+    {
+        temp->prev = m_head->prev;
+        m_head->prev = temp;
+    }
+    else
+    {
+        temp->prev = m_head;
+        m_head = temp;
+    }
+
+    return temp;
+}
+
+//------------------------------------------------------------------------------
+void arena::free_block()
+{
+    block* prev = m_head->prev;
+    free(m_head);
+    m_head = prev;
+    --m_block_count;
+}
@@ -41,35 +41,217 @@ void logger::error(const char* function, int line, const char* fmt, ...)
     logger::info(function, line, "(last error = %d)", last_error);
 
     va_end(args);
+
+    instance->flush_lines();
+}
+
+//------------------------------------------------------------------------------
+void logger::flush()
+{
+    if (logger* instance = logger::get())
+        instance->flush_lines();
 }
 
 
 
+//------------------------------------------------------------------------------
+static const unsigned int c_buffer_size = 0x10000;
+
 //------------------------------------------------------------------------------
 file_logger::file_logger(const char* log_path)
+: m_buffer((char*)malloc(c_buffer_size))
+, m_used(0)
+, m_lock(new CRITICAL_SECTION)
 {
     m_log_path << log_path;
+    InitializeCriticalSection((CRITICAL_SECTION*)m_lock);
+
+    // Whoever creates the logger may bail out before arranging to destroy it
+    // (e.g. when Clink fails to load), so what's buffered is flushed at exit
+    // regardless.
+    static bool s_flush_at_exit = false;
+    if (!s_flush_at_exit)
+    {
+        atexit(logger::flush);
+        s_flush_at_exit = true;
+    }
 }
 
 //------------------------------------------------------------------------------
-void file_logger::emit(const char* function, int line, const char* fmt, va_list args)
+file_logger::~file_logger()
 {
-    FILE* file;
-
-    file = fopen(m_log_path.c_str(), "at");
-    if (file == nullptr)
-        return;
+    flush_lines();
+    DeleteCriticalSection((CRITICAL_SECTION*)m_lock);
+    delete (CRITICAL_SECTION*)m_lock;
+    free(m_buffer);
+}
 
+//------------------------------------------------------------------------------
+void file_logger::emit(const char* function, int line, const char* fmt, va_list args)
+{
     str<24> func_name;
     func_name << function;
 
     DWORD pid = GetCurrentProcessId();
 
-    str<256> buffer;
-    buffer.format("%04x %-24s %4d ", pid, func_name.c_str(), line);
-    fputs(buffer.c_str(), file);
-    vfprintf(file, fmt, args);
-    fputs("\n", file);
+    str<256> prefix;
+    prefix.format("%04x %-24s %4d ", pid, func_name.c_str(), line);
+
+    EnterCriticalSection((CRITICAL_SECTION*)m_lock);
+
+    // Format straight into the buffer.  If the line doesn't fit then write out
+    // what's buffered and try again, and a line too long for even an empty
+    // buffer goes straight to the file.
+    while (true)
+    {
+        unsigned int room = c_buffer_size - m_used;
+        unsigned int prefix_length = prefix.length();
+        if (prefix_length < room)
+        {
+            char* out = m_buffer + m_used;
+            memcpy(out, prefix.c_str(), prefix_length);
+            out += prefix_length;
+            room -= prefix_length;
+
+            va_list copy;
+            va_copy(copy, args);
+            int length = vsnprintf(out, room, fmt, copy);
+            va_end(copy);
+
+            // The newline takes the place of vsnprintf()'s terminator.
+            if (length >= 0 && unsigned(length) < room)
+            {
+                out[length] = '\n';
+                m_used += prefix_length + length + 1;
+                break;
+            }
+        }
+
+        if (m_used)
+        {
+            write_buffer();
+            continue;
+        }
+
+        if (FILE* file = fopen(m_log_path.c_str(), "at"))
+        {
+            fputs(prefix.c_str(), file);
+            vfprintf(file, fmt, args);
+            fputs("\n", file);
+            fclose(file);
+        }
+        break;
+    }
+
+    LeaveCriticalSection((CRITICAL_SECTION*)m_lock);
+}
+
+//------------------------------------------------------------------------------
+void file_logger::flush_lines()
+{
+    EnterCriticalSection((CRITICAL_SECTION*)m_lock);
+    write_buffer();
+    LeaveCriticalSection((CRITICAL_SECTION*)m_lock);
+}
+
+//------------------------------------------------------------------------------
+void file_logger::write_buffer()
+{
+    if (!m_used)
+        return;
+
+    if (FILE* file = fopen(m_log_path.c_str(), "at"))
+    {
+        fwrite(m_buffer, 1, m_used, file);
+        fclose(file);
+    }
+
+    m_used = 0;
+}
+
+
+
+//------------------------------------------------------------------------------
+static const unsigned int c_max_events = 4096;
+
+//------------------------------------------------------------------------------
+tracer::tracer(const char* trace_path)
+: m_events((event*)malloc(sizeof(event) * c_max_events))
+, m_count(0)
+, m_lock(new CRITICAL_SECTION)
+{
+    m_trace_path << trace_path;
+    InitializeCriticalSection((CRITICAL_SECTION*)m_lock);
+}
+
+//------------------------------------------------------------------------------
+tracer::~tracer()
+{
+    write_events();
+    DeleteCriticalSection((CRITICAL_SECTION*)m_lock);
+    delete (CRITICAL_SECTION*)m_lock;
+    free(m_events);
+}
+
+//------------------------------------------------------------------------------
+void tracer::flush()
+{
+    if (tracer* instance = tracer::get())
+    {
+        EnterCriticalSection((CRITICAL_SECTION*)instance->m_lock);
+        instance->write_events();
+        LeaveCriticalSection((CRITICAL_SECTION*)instance->m_lock);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Microseconds, which is the unit Chrome trace events use.
+long long tracer::now()
+{
+    static LARGE_INTEGER frequency = {};
+    if (!frequency.QuadPart)
+        QueryPerformanceFrequency(&frequency);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (counter.QuadPart / frequency.QuadPart) * 1000000 +
+        (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
+//------------------------------------------------------------------------------
+void tracer::add(const char* name, long long start, long long end)
+{
+    EnterCriticalSection((CRITICAL_SECTION*)m_lock);
+
+    if (m_count >= c_max_events)
+        write_events();
+
+    event& e = m_events[m_count++];
+    e.name = name;
+    e.start = start;
+    e.end = end;
+    e.thread_id = GetCurrentThreadId();
+
+    LeaveCriticalSection((CRITICAL_SECTION*)m_lock);
+}
+
+//------------------------------------------------------------------------------
+void tracer::write_events()
+{
+    if (!m_count)
+        return;
+
+    if (FILE* file = fopen(m_trace_path.c_str(), "at"))
+    {
+        DWORD pid = GetCurrentProcessId();
+        for (unsigned int i = 0; i < m_count; ++i)
+        {
+            const event& e = m_events[i];
+            fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%u,\"tid\":%u},\n",
+                e.name, e.start, e.end - e.start, pid, e.thread_id);
+        }
+        fclose(file);
+    }
 
-    fclose(file);
+    m_count = 0;
 }
@@ -78,6 +78,33 @@ int get_file_size(const char* path)
     return ret;
 }
 
+//------------------------------------------------------------------------------
+bool get_file_stamp(const char* path, file_stamp& out)
+{
+    // Size and last write time, without opening the file.
+    wstr<280> wpath(path);
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(wpath.c_str(), GetFileExInfoStandard, &data))
+        return false;
+
+    out.size = (unsigned long long)data.nFileSizeHigh << 32 | data.nFileSizeLow;
+    out.modified = (unsigned long long)data.ftLastWriteTime.dwHighDateTime << 32 | data.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool is_stamp_recent(const file_stamp& stamp)
+{
+    // Write times are recorded no finer than this (FAT's are to two seconds),
+    // so a file written again this soon may keep the same time.
+    static const unsigned long long resolution = 2 * 10000000ull; // 100ns units.
+
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    unsigned long long now_time = (unsigned long long)now.dwHighDateTime << 32 | now.dwLowDateTime;
+    return stamp.modified + resolution > now_time;
+}
+
 //------------------------------------------------------------------------------
 void get_current_dir(str_base& out)
 {
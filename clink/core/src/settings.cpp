@@ -6,10 +6,13 @@
 #include "str.h"
 #include "str_tokeniser.h"
 #include "path.h"
+#include "os.h"
+#include "str_hash.h"
 
 #include <assert.h>
 #include <string>
 #include <map>
+#include <unordered_map>
 
 //------------------------------------------------------------------------------
 struct loaded_setting
@@ -21,9 +24,44 @@ struct loaded_setting
     bool            saved;
 };
 
+//------------------------------------------------------------------------------
+struct hash_stri
+{
+    size_t operator()(const char* in) const
+    {
+        // Setting names are ASCII; fold case to match stricmp().
+        unsigned int hash = 5381;
+        while (unsigned int c = (unsigned char)*in++)
+            hash = ((hash << 5) + hash) ^ ((c - 'A' < 26) ? c | 0x20 : c);
+        return hash;
+    }
+};
+
+//------------------------------------------------------------------------------
+struct equal_stri
+{
+    bool operator()(const char* a, const char* b) const
+    {
+        return stricmp(a, b) == 0;
+    }
+};
+
+//------------------------------------------------------------------------------
+typedef std::map<std::string, loaded_setting> loaded_settings;
+typedef std::unordered_map<const char*, setting*, hash_stri, equal_stri> setting_index;
+
 //------------------------------------------------------------------------------
 static setting_map* g_setting_map = nullptr;
-static std::map<std::string, loaded_setting> g_loaded_settings;
+static setting_index* g_setting_index = nullptr;
+static loaded_settings g_loaded_settings;
+
+// Which file was last loaded, and its size, time, and content hash when it was.
+// The stamp's trusted if it was old enough when loaded that any later write
+// must have changed the time.
+static str<288> g_loaded_file;
+static os::file_stamp g_loaded_stamp;
+static unsigned int g_loaded_hash;
+static bool g_loaded_stamp_trusted;
 
 //------------------------------------------------------------------------------
 static auto& get_map()
@@ -33,6 +71,16 @@ static auto& get_map()
     return *g_setting_map;
 }
 
+//------------------------------------------------------------------------------
+static auto& get_index()
+{
+    // The map keeps settings sorted for listing; lookups by name go through
+    // this instead.
+    if (!g_setting_index)
+        g_setting_index = new setting_index;
+    return *g_setting_index;
+}
+
 
 
 //------------------------------------------------------------------------------
@@ -67,8 +115,8 @@ setting_iter first()
 //------------------------------------------------------------------------------
 setting* find(const char* name)
 {
-    auto i = get_map().find(name);
-    if (i != get_map().end())
+    auto i = get_index().find(name);
+    if (i != get_index().end())
         return i->second;
 
     return nullptr;
@@ -175,13 +223,76 @@ static bool migrate_setting(const char* name, const char* value)
     return set_setting(name, value);
 }
 
+//------------------------------------------------------------------------------
+static void parse_settings(char* data, loaded_settings& out)
+{
+    // Walks the buffer once, terminating keys and values in place.
+    std::string comment;
+    bool was_comment = false;
+    while (*data)
+    {
+        char* line = data;
+        while (*data && *data != '\n' && *data != '\r')
+            ++data;
+        while (*data == '\n' || *data == '\r')
+            *data++ = '\0';
+
+        if (!*line)
+            continue;
+
+        // Clear the comment accumulator after a non-comment line.
+        if (!was_comment)
+            comment.clear();
+
+        // Skip line's leading whitespace.
+        while (isspace((unsigned char)*line))
+            ++line;
+
+        // Comment?
+        if (line[0] == '#')
+        {
+            was_comment = true;
+            comment.append(line);
+            comment.append("\n");
+            continue;
+        }
+
+        // 'key = value'?
+        was_comment = false;
+        char* value = strchr(line, '=');
+        if (value == nullptr)
+            continue;
+
+        *value++ = '\0';
+
+        // Trim whitespace.
+        char* key_end = value - 2;
+        while (key_end >= line && isspace((unsigned char)*key_end))
+            --key_end;
+        key_end[1] = '\0';
+
+        while (*value && isspace((unsigned char)*value))
+            ++value;
+
+        loaded_setting& loaded = out[line];
+        loaded.comment = comment;
+        loaded.value = value;
+    }
+}
+
 //------------------------------------------------------------------------------
 static bool save_internal(const char* file, bool migrating);
 
 //------------------------------------------------------------------------------
 bool load(const char* file)
 {
-    g_loaded_settings.clear();
+    // Nothing to do if the file's the same size and time as when it was last
+    // loaded; this is called for every prompt.
+    os::file_stamp stamp;
+    bool have_stamp = os::get_file_stamp(file, stamp);
+    bool same_stamp = (have_stamp && stamp == g_loaded_stamp && g_loaded_file.equals(file));
+    if (same_stamp && g_loaded_stamp_trusted)
+        return true;
 
     // Maybe migrate settings.
     str<> old_file;
@@ -191,6 +302,9 @@ bool load(const char* file)
     FILE* in = fopen(file, "rb");
     if (in == nullptr)
     {
+        g_loaded_settings.clear();
+        g_loaded_file.clear();
+
         // If there's no (new name) settings file, try to migrate from the old
         // name settings file.
         path::get_directory(file, old_file);
@@ -208,6 +322,8 @@ bool load(const char* file)
 
     if (size == 0)
     {
+        g_loaded_settings.clear();
+        g_loaded_file.clear();
         fclose(in);
         return false;
     }
@@ -216,77 +332,91 @@ bool load(const char* file)
     buffer.reserve(size);
 
     char* data = buffer.data();
-    fread(data, size, 1, in);
+    size = int(fread(data, 1, size, in));
     fclose(in);
     data[size] = '\0';
 
-    // Reset settings to default.
-    for (auto iter = settings::first(); auto* next = iter.next();)
-        next->set();
-
-    // Split at new lines.
-    bool was_comment = false;
-    str<> comment;
-    str<256> line;
-    str_tokeniser lines(buffer.c_str(), "\n\r");
-    while (lines.next(line))
+    // The file was loaded too soon after it was written for the stamp to be
+    // trusted, as a rewrite within the file system's time resolution can keep
+    // both the size and time.  The content says whether it's changed.
+    unsigned int hash = str_hash(data, size);
+    if (!migrating && same_stamp && hash == g_loaded_hash)
     {
-        char* line_data = line.data();
+        g_loaded_stamp_trusted = !os::is_stamp_recent(stamp);
+        return true;
+    }
 
-        // Clear the comment accumulator after a non-comment line.
-        if (!was_comment)
-            comment.clear();
+    g_loaded_file.clear();
 
-        // Skip line's leading whitespace.
-        while (isspace(*line_data))
-            ++line_data;
+    loaded_settings loaded;
+    parse_settings(data, loaded);
 
-        // Comment?
-        if (line_data[0] == '#')
-        {
-            was_comment = true;
-            comment.concat(line_data);
-            comment.concat("\n");
-            continue;
-        }
-
-        // 'key = value'?
-        was_comment = false;
-        char* value = strchr(line_data, '=');
-        if (value == nullptr)
-            continue;
+    if (migrating)
+    {
+        // Reset settings to default, and migrate old settings.
+        for (auto iter = settings::first(); auto* next = iter.next();)
+            next->set();
 
-        *value++ = '\0';
+        for (const auto& iter : loaded)
+            migrate_setting(iter.first.c_str(), iter.second.value.c_str());
 
-        // Trim whitespace.
-        char* key_end = value - 2;
-        while (key_end >= line_data && isspace(*key_end))
-            --key_end;
-        key_end[1] = '\0';
+        // Ensure the new settings file is created so that the old settings
+        // file can be deleted.  Some users or distributions may naturally
+        // clean up the old settings file, so don't rely on it staying around.
+        save_internal(file, migrating);
+        return true;
+    }
 
-        while (*value && isspace(*value))
-            ++value;
+    // Settings that were in the file but aren't any more go back to their
+    // defaults.  Others are only set if the file's value differs from how the
+    // setting would be saved; parsing colors and enums isn't free.  Settings
+    // the file doesn't mention are left alone.
+    for (const auto& iter : g_loaded_settings)
+        if (loaded.find(iter.first) == loaded.end())
+            if (setting* s = settings::find(iter.first.c_str()))
+                s->set();
+
+    str<> current;
+    for (const auto& iter : loaded)
+    {
+        setting* s = settings::find(iter.first.c_str());
+        if (!s)
+            continue;
 
-        // Migrate old setting.
-        if (migrating)
-        {
-            migrate_setting(line_data, value);
+        s->get_descriptive(current);
+        if (current.equals(iter.second.value.c_str()))
             continue;
-        }
 
-        // Find the setting and set its value.
-        set_setting(line_data, value, comment.c_str());
+        if (!s->set(iter.second.value.c_str()))
+            s->set();
     }
 
-    // When migrating, ensure the new settings file is created so that the old
-    // settings file can be deleted.  Some users or distributions may naturally
-    // clean up the old settings file, so don't rely on it staying around.
-    if (migrating)
-        save_internal(file, migrating);
+    // Remember everything from the file, including settings that aren't
+    // declared yet, so scripts' settings get their values and saving doesn't
+    // lose them.
+    g_loaded_settings = std::move(loaded);
+
+    if (have_stamp)
+    {
+        g_loaded_file = file;
+        g_loaded_stamp = stamp;
+        g_loaded_hash = hash;
+        g_loaded_stamp_trusted = !os::is_stamp_recent(stamp);
+    }
 
     return true;
 }
 
+//------------------------------------------------------------------------------
+void forget_loaded()
+{
+    g_loaded_settings.clear();
+    g_loaded_file.clear();
+    g_loaded_stamp = {};
+    g_loaded_hash = 0;
+    g_loaded_stamp_trusted = false;
+}
+
 //------------------------------------------------------------------------------
 static bool save_internal(const char* file, bool migrating)
 {
@@ -386,6 +516,7 @@ setting::setting(
     assert(!settings::find(m_name.c_str()));
 
     get_map()[m_name.c_str()] = this;
+    get_index()[m_name.c_str()] = this;
 }
 
 //------------------------------------------------------------------------------
@@ -394,7 +525,10 @@ setting::~setting()
     auto i = settings::find(m_name.c_str());
 
     if (i && i == this)
+    {
         get_map().erase(m_name.c_str());
+        get_index().erase(m_name.c_str());
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -557,23 +691,36 @@ bool setting_enum::set(const char* value)
 //------------------------------------------------------------------------------
 void setting_enum::get(str_base& out) const
 {
+    int length;
+    if (const char* option = get_option(length))
+    {
+        out.clear();
+        out.concat(option, length);
+    }
+}
+
+//------------------------------------------------------------------------------
+const char* setting_enum::get_option(int& length) const
+{
+    // Returns the current option's name within the options string, which
+    // isn't nul terminated.
     int index = m_store.value;
     if (index < 0)
-        return;
+        return nullptr;
 
     const char* option = m_options.c_str();
     for (int i = 0; i < index && *option; ++i)
         option = next_option(option);
 
-    if (*option)
-    {
-        const char* next = next_option(option);
-        if (*next)
-            --next;
+    if (!*option)
+        return nullptr;
 
-        out.clear();
-        out.concat(option, int(next - option));
-    }
+    const char* next = next_option(option);
+    if (*next)
+        --next;
+
+    length = int(next - option);
+    return option;
 }
 
 //------------------------------------------------------------------------------
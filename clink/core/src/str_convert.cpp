@@ -5,9 +5,7 @@
 #include "str.h"
 #include "str_iter.h"
 
-#ifdef USE_OS_UTF_CONVERSION
 #include <assert.h>
-#endif
 
 //------------------------------------------------------------------------------
 template <typename TYPE>
@@ -18,6 +16,7 @@ struct builder
     bool        truncated() const                     { return (start && write >= end); }
     int         get_written() const                   { return int(write - start); }
     builder&    operator << (int value);
+    template <typename FROM> void copy_ascii(const FROM*& ptr, const FROM* end);
     TYPE*       write;
     const TYPE* start;
     const TYPE* end;
@@ -60,6 +59,90 @@ builder<char>& builder<char>::operator << (int value)
     return *this;
 }
 
+//------------------------------------------------------------------------------
+// Length of the run of ASCII characters at the start of 'ptr', stopping at a
+// nul or after 'count' characters.
+static unsigned int ascii_run(const char* ptr, unsigned int count)
+{
+    static const unsigned long long c_ones = 0x0101010101010101ull;
+    static const unsigned long long c_highs = 0x8080808080808080ull;
+
+    unsigned int n = 0;
+    for (; n + 8 <= count; n += 8)
+    {
+        unsigned long long x;
+        memcpy(&x, ptr + n, sizeof(x));
+        if ((x | (x - c_ones)) & c_highs)
+            break;
+    }
+
+    while (n < count && (unsigned char)(ptr[n] - 1) < 0x7f)
+        ++n;
+
+    return n;
+}
+
+//------------------------------------------------------------------------------
+static unsigned int ascii_run(const wchar_t* ptr, unsigned int count)
+{
+    unsigned int n = 0;
+    while (n < count && (unsigned int)(ptr[n] - 1) < 0x7f)
+        ++n;
+
+    return n;
+}
+
+//------------------------------------------------------------------------------
+// Copies the run of ASCII characters at 'ptr' one to one, as far as there's
+// room, and advances 'ptr' past what was copied.
+template <typename TYPE>
+template <typename FROM>
+void builder<TYPE>::copy_ascii(const FROM*& ptr, const FROM* stop)
+{
+    unsigned int count = (unsigned int)(stop - ptr);
+    if (start && count > (unsigned int)(end - write))
+        count = (unsigned int)(end - write);
+
+    count = ascii_run(ptr, count);
+    if (start)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+            write[i] = TYPE(ptr[i]);
+    }
+
+    write += count;
+    ptr += count;
+}
+
+//------------------------------------------------------------------------------
+// Exact number of UTF-8 bytes to_utf8() produces for 'iter', without encoding
+// anything.  Mirrors how str_iter_impl<wchar_t>::next() pairs surrogates.
+static unsigned int utf8_length(const wstr_iter& iter)
+{
+    const wchar_t* ptr = iter.get_pointer();
+    const wchar_t* stop = ptr + iter.length();
+
+    unsigned int n = 0;
+    bool high = false;
+    for (; ptr < stop && *ptr; ++ptr)
+    {
+        unsigned int c = *ptr;
+        if ((c & 0xfc00) == 0xd800)
+        {
+            high = true;
+            continue;
+        }
+
+        if (high && (c & 0xfc00) == 0xdc00)
+            n += 4;
+        else
+            n += 1 + (c >= 0x80) + (c >= 0x800) + (c >= 0x10000);
+        high = false;
+    }
+
+    return n;
+}
+
 
 
 //------------------------------------------------------------------------------
@@ -96,10 +179,21 @@ int to_utf8(char* out, int max_count, wstr_iter& iter)
     // fall back to this for now.
 
     builder<char> builder(out, max_count);
+    const wchar_t* stop = iter.get_pointer() + iter.length();
 
-    int c;
-    while (!builder.truncated() && (c = iter.next()))
+    while (!builder.truncated())
     {
+        // Runs of ASCII are copied directly; only the rest is decoded.
+        const wchar_t* ptr = iter.get_pointer();
+        builder.copy_ascii(ptr, stop);
+        iter.reset_pointer(ptr);
+        if (builder.truncated())
+            break;
+
+        int c = iter.next();
+        if (!c)
+            break;
+
         if (c < 0x80)
         {
             builder << c;
@@ -141,11 +235,7 @@ int to_utf8(str_base& out, str_iter_impl<wchar_t>& utf16)
     int length = out.length();
 
     if (out.is_growable())
-    {
-        str_iter_impl<wchar_t> calc_needed(utf16.get_pointer(), utf16.length());
-        int needed = to_utf8(nullptr, 0, calc_needed);
-        out.reserve(length + needed);
-    }
+        out.reserve(length + utf8_length(utf16));
 
     return to_utf8(out.data() + length, out.size() - length, utf16);
 }
@@ -197,10 +287,23 @@ int to_utf16(wchar_t* out, int max_count, str_iter& iter)
     // back to this for now.
 
     builder<wchar_t> builder(out, max_count);
+    const char* stop = iter.get_pointer() + iter.length();
+
+    while (!builder.truncated())
+    {
+        // Runs of ASCII are copied directly; only the rest is decoded.
+        const char* ptr = iter.get_pointer();
+        builder.copy_ascii(ptr, stop);
+        iter.reset_pointer(ptr);
+        if (builder.truncated())
+            break;
+
+        int c = iter.next();
+        if (!c)
+            break;
 
-    int c;
-    while (!builder.truncated() && (c = iter.next()))
         builder << c;
+    }
 
     return builder.get_written();
 }
@@ -217,12 +320,11 @@ int to_utf16(wstr_base& out, str_iter_impl<char>& utf8)
 {
     int length = out.length();
 
+    // Each UTF-8 byte yields at most one UTF-16 unit (four byte sequences
+    // yield two), so the byte count is a bound that's exact for ASCII text and
+    // needs no measuring pass.
     if (out.is_growable())
-    {
-        str_iter_impl<char> calc_needed(utf8.get_pointer(), utf8.length());
-        int needed = to_utf16(nullptr, 0, calc_needed);
-        out.reserve(length + needed);
-    }
+        out.reserve(length + utf8.length());
 
     return to_utf16(out.data() + length, out.size() - length, utf8);
 }
@@ -45,8 +45,10 @@ int str_iter_impl<wchar_t>::next()
         return 0;
 
     int ax = 0;
-    while (int c = *m_ptr++)
+    while (more())
     {
+        int c = *m_ptr++;
+
         // Decode surrogate pairs.
         if ((c & 0xfc00) == 0xd800)
         {
@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/arena.h>
+#include <core/str.h>
+
+#include <string.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("arena : basic")
+{
+    arena arena(256);
+    REQUIRE(arena.alloc(0) == nullptr);
+    REQUIRE(arena.get_block_count() == 0);
+
+    char* a = (char*)arena.alloc(100, 1);
+    char* b = (char*)arena.alloc(100, 1);
+    REQUIRE(b == a + 100);
+    REQUIRE(arena.get_block_count() == 1);
+
+    // Doesn't fit in what's left of the block.
+    char* c = (char*)arena.alloc(100, 1);
+    REQUIRE(c != nullptr);
+    REQUIRE(arena.get_block_count() == 2);
+
+    REQUIRE(arena.contains(a));
+    REQUIRE(arena.contains(c + 99));
+    REQUIRE(!arena.contains(&arena));
+
+    SECTION("Oversized")
+    {
+        char* big = (char*)arena.alloc(10000);
+        REQUIRE(big != nullptr);
+        memset(big, 'x', 10000);
+        REQUIRE(arena.get_block_count() == 3);
+        REQUIRE(arena.contains(big + 9999));
+
+        // The current block's free space isn't stranded.
+        REQUIRE(arena.alloc(100, 1) == c + 100);
+        REQUIRE(arena.get_block_count() == 3);
+    }
+
+    SECTION("Clear")
+    {
+        arena.clear();
+        REQUIRE(!arena.contains(c));
+        REQUIRE(arena.alloc(1, 1) == a);
+        REQUIRE(arena.get_block_count() == 1);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("arena : align")
+{
+    arena arena;
+
+    arena.alloc(1, 1);
+    REQUIRE((size_t(arena.alloc(4, 4)) & 3) == 0);
+    arena.alloc(1, 1);
+    REQUIRE((size_t(arena.calloc<double>()) & (alignof(double) - 1)) == 0);
+    arena.alloc(1, 1);
+    REQUIRE((size_t(arena.alloc(16, 16)) & 15) == 0);
+
+    int* ints = arena.calloc<int>(8);
+    for (int i = 0; i < 8; ++i)
+        REQUIRE(ints[i] == 0);
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("arena : mark")
+{
+    arena arena(256);
+    arena.store("abc");
+
+    arena::mark mark = arena.get_mark();
+    const char* first = arena.store("def");
+    for (int i = 0; i < 100; ++i)
+        arena.store("0123456789");
+    REQUIRE(arena.get_block_count() > 1);
+
+    arena.rewind(mark);
+    REQUIRE(arena.store("xyz") == first);
+    REQUIRE(arena.get_block_count() == 1);
+
+    SECTION("Oversized")
+    {
+        mark = arena.get_mark();
+        REQUIRE(arena.alloc(1000) != nullptr);
+        REQUIRE(arena.get_block_count() == 2);
+
+        arena.rewind(mark);
+        REQUIRE(arena.get_block_count() == 1);
+        REQUIRE(arena.store("uvw") == first + 4);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("arena : store")
+{
+    arena arena;
+    REQUIRE(strcmp(arena.store("abc"), "abc") == 0);
+    REQUIRE(strcmp(arena.store("abcdef", 3), "abc") == 0);
+    REQUIRE(strcmp(arena.store(nullptr), "") == 0);
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("arena : allocation count")
+{
+    // Ten thousand history lines or matches of typical length cost a handful
+    // of heap allocations instead of one each.
+    arena arena;
+    str<> line;
+    for (int i = 0; i < 10000; ++i)
+    {
+        line.format("git commit -m \"change %d\"", i);
+        REQUIRE(arena.store(line.c_str()) != nullptr);
+    }
+
+    REQUIRE(arena.get_alloc_count() == 10000);
+    REQUIRE(arena.get_block_count() < 100);
+}
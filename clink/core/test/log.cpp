@@ -0,0 +1,117 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+
+#include <core/log.h>
+#include <core/os.h>
+#include <core/path.h>
+#include <core/str.h>
+
+//------------------------------------------------------------------------------
+static int count_lines(const char* file_path)
+{
+    FILE* file = fopen(file_path, "rt");
+    if (!file)
+        return 0;
+
+    int lines = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF)
+        lines += (c == '\n');
+
+    fclose(file);
+    return lines;
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("file_logger")
+{
+    fs_fixture fs;
+
+    str<> log_path;
+    path::join(fs.get_root(), "clink.log", log_path);
+
+    file_logger* log = new file_logger(log_path.c_str());
+
+    SECTION("Buffered")
+    {
+        for (int i = 0; i < 100; ++i)
+            LOG("line %d", i);
+        REQUIRE(count_lines(log_path.c_str()) == 0);
+
+        logger::flush();
+        REQUIRE(count_lines(log_path.c_str()) == 100);
+    }
+
+    SECTION("Full")
+    {
+        // Filling the buffer writes it out rather than growing it.
+        str<> text;
+        for (int i = 0; i < 1000; ++i)
+            text << "x";
+        for (int i = 0; i < 100; ++i)
+            LOG("%s", text.c_str());
+        REQUIRE(count_lines(log_path.c_str()) > 0);
+        REQUIRE(count_lines(log_path.c_str()) < 100);
+    }
+
+    SECTION("Long line")
+    {
+        str<> text;
+        for (int i = 0; i < 0x20000; ++i)
+            text << "x";
+        LOG("short");
+        LOG("%s", text.c_str());
+        REQUIRE(count_lines(log_path.c_str()) == 2);
+    }
+
+    SECTION("Destroy")
+    {
+        LOG("abc");
+        delete log;
+        log = nullptr;
+        REQUIRE(count_lines(log_path.c_str()) == 1);
+    }
+
+    delete log;
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("tracer")
+{
+    fs_fixture fs;
+
+    str<> trace_path;
+    path::join(fs.get_root(), "clink_trace.json", trace_path);
+
+    {
+        TRACE_SCOPE("untraced");
+    }
+
+    tracer* trace = new tracer(trace_path.c_str());
+
+    {
+        TRACE_SCOPE("outer");
+        {
+            TRACE_SCOPE("inner");
+        }
+    }
+    REQUIRE(count_lines(trace_path.c_str()) == 0);
+
+    tracer::flush();
+    REQUIRE(count_lines(trace_path.c_str()) == 2);
+
+    // Inner spans end first; each event is a complete ("X") Chrome trace event.
+    FILE* file = fopen(trace_path.c_str(), "rt");
+    REQUIRE(file != nullptr);
+    char line[256];
+    REQUIRE(fgets(line, sizeof_array(line), file) != nullptr);
+    REQUIRE(strncmp(line, "{\"name\":\"inner\",\"ph\":\"X\",", 25) == 0);
+    REQUIRE(fgets(line, sizeof_array(line), file) != nullptr);
+    REQUIRE(strncmp(line, "{\"name\":\"outer\",", 16) == 0);
+    fclose(file);
+
+    delete trace;
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/base.h>
+#include <core/perfect_hash.h>
+
+//------------------------------------------------------------------------------
+namespace {
+constexpr const char* const words[] = {
+    "abc", "abd", "", "x", "xyzzy", "abc", "\x1b[A", "\x1b[1;5A", "\x1bOP",
+};
+
+struct word_keys
+{
+    constexpr const char* get(int index) const { return words[index]; }
+};
+
+constexpr perfect_hash<sizeof_array(words)> word_hash(word_keys{});
+static_assert(word_hash.is_valid(), "Perfect hash wasn't built");
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST_CASE("Perfect hash")
+{
+    word_keys keys;
+
+    SECTION("Find")
+    {
+        REQUIRE(word_hash.find(keys, "abc", 3) == 0);
+        REQUIRE(word_hash.find(keys, "abd", 3) == 1);
+        REQUIRE(word_hash.find(keys, "x", 1) == 3);
+        REQUIRE(word_hash.find(keys, "xyzzy", 5) == 4);
+        REQUIRE(word_hash.find(keys, "\x1b[1;5A", 6) == 7);
+
+        REQUIRE(word_hash.find(keys, "ab", 2) == -1);
+        REQUIRE(word_hash.find(keys, "abcd", 4) == -1);
+        REQUIRE(word_hash.find(keys, "", 0) == -1);
+        REQUIRE(word_hash.find(keys, "xyzzy!", 3) == -1);
+    }
+
+    SECTION("Prefix")
+    {
+        int length = 0;
+        REQUIRE(word_hash.find_prefix(keys, "abcdef", length) == 0);
+        REQUIRE(length == 3);
+        REQUIRE(word_hash.find_prefix(keys, "\x1bOP\x1bOQ", length) == 8);
+        REQUIRE(length == 3);
+        REQUIRE(word_hash.find_prefix(keys, "xyzzy", length) == 3);
+        REQUIRE(length == 1);
+
+        REQUIRE(word_hash.find_prefix(keys, "ab", length) == -1);
+        REQUIRE(word_hash.find_prefix(keys, "\x1b[B", length) == -1);
+        REQUIRE(word_hash.find_prefix(keys, "", length) == -1);
+    }
+}
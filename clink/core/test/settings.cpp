@@ -2,8 +2,10 @@
 // License: http://opensource.org/licenses/MIT
 
 #include "pch.h"
+#include "fs_fixture.h"
 
 #include <core/base.h>
+#include <core/path.h>
 #include <core/settings.h>
 
 //------------------------------------------------------------------------------
@@ -204,3 +206,109 @@ TEST_CASE("settings : color")
     test.get_descriptive(tmp);
     REQUIRE(tmp.equals("bright yellow"));
 }
+
+//------------------------------------------------------------------------------
+static void write_file(const char* file, const char* content)
+{
+    FILE* out = fopen(file, "wb");
+    REQUIRE(out != nullptr);
+    fputs(content, out);
+    fclose(out);
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("settings : load")
+{
+    // Sections rerun the test, and may write the same file again.
+    settings::forget_loaded();
+
+    fs_fixture fs;
+
+    str<> file;
+    path::join(fs.get_root(), "clink_settings", file);
+
+    setting_int test_int("test.int", "", "", 1);
+    setting_str test_str("test.str", "", "", "abc");
+    setting_enum test_enum("test.enum", "", "", "zero,one,two", 0);
+
+    write_file(file.c_str(),
+        "# name: Int\n"
+        "test.int = 2\n"
+        "\n"
+        "  test.STR  =  xyz  \r\n"
+        "test.enum = two\n"
+        "test.later = 123\n");
+
+    REQUIRE(settings::load(file.c_str()));
+    REQUIRE(test_int.get() == 2);
+    REQUIRE(strcmp(test_str.get(), "xyz  ") == 0);
+    REQUIRE(test_enum.get() == 2);
+
+    int length = 0;
+    const char* option = test_enum.get_option(length);
+    REQUIRE(length == 3);
+    REQUIRE(strncmp(option, "two", 3) == 0);
+
+    SECTION("Declared later")
+    {
+        setting_int later("test.later", "", "", 0);
+        later.deferred_load();
+        REQUIRE(later.get() == 123);
+    }
+
+    SECTION("Unchanged")
+    {
+        // The file isn't re-read, so values set since aren't reset.
+        test_int.set("5");
+        REQUIRE(settings::load(file.c_str()));
+        REQUIRE(test_int.get() == 5);
+    }
+
+    SECTION("Same size")
+    {
+        // A rewrite that keeps the size is seen, even if the time's the same.
+        test_int.set("5");
+        write_file(file.c_str(),
+            "# name: Int\n"
+            "test.int = 3\n"
+            "\n"
+            "  test.STR  =  xyz  \r\n"
+            "test.enum = two\n"
+            "test.later = 123\n");
+
+        REQUIRE(settings::load(file.c_str()));
+        REQUIRE(test_int.get() == 3);
+    }
+
+    SECTION("Changed")
+    {
+        test_int.set("5");
+        test_enum.set("one");
+
+        // Values removed from the file, or that are invalid, go back to their
+        // defaults.
+        write_file(file.c_str(),
+            "test.int = 2\n"
+            "test.enum = bogus\n");
+
+        REQUIRE(settings::load(file.c_str()));
+        REQUIRE(test_int.get() == 2);
+        REQUIRE(strcmp(test_str.get(), "abc") == 0);
+        REQUIRE(test_enum.get() == 0);
+    }
+
+    SECTION("Saved")
+    {
+        test_int.set("7");
+        REQUIRE(settings::save(file.c_str()));
+
+        // Settings that aren't declared yet are kept.
+        FILE* in = fopen(file.c_str(), "rb");
+        REQUIRE(in != nullptr);
+        char buffer[1024];
+        buffer[fread(buffer, 1, sizeof(buffer) - 1, in)] = '\0';
+        fclose(in);
+        REQUIRE(strstr(buffer, "test.int = 7") != nullptr);
+        REQUIRE(strstr(buffer, "test.later = 123") != nullptr);
+    }
+}
@@ -124,6 +124,22 @@ TEST_CASE("Strings" NAME_SUFFIX)
         REQUIRE(s.equals(STR("0123")) == true);
     }
 
+    SECTION("Long")
+    {
+        str<16> s;
+        for (int i = 0; i < 10000; ++i)
+            s << STR("0123456789");
+
+        REQUIRE(s.length() == 100000);
+        REQUIRE(s.size() > 100000);
+        REQUIRE(s[0] == '0');
+        REQUIRE(s[99999] == '9');
+        REQUIRE(s[100000] == 0);
+
+        s.truncate(40000);
+        REQUIRE(s.length() == 40000);
+    }
+
     SECTION("Index of")
     {
         str<16> s;
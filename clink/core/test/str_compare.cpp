@@ -6,6 +6,9 @@
 #include <core/str.h>
 #include <core/str_compare.h>
 
+#include <string>
+#include <vector>
+
 //------------------------------------------------------------------------------
 TEST_CASE("String compare")
 {
@@ -119,3 +122,136 @@ TEST_CASE("String compare")
         REQUIRE(str_compare(L"\xd800\xdc00" L"abc", L"\xd800\xdc00") == 2);
     }
 }
+
+//------------------------------------------------------------------------------
+TEST_CASE("String compare : case folding")
+{
+    SECTION("ASCII")
+    {
+        for (int c = 0; c < 0x80; ++c)
+        {
+            int expected = (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+            REQUIRE(fold_case(c) == expected);
+        }
+    }
+
+    SECTION("BMP")
+    {
+        REQUIRE(fold_case(0xc0) == 0xe0);           // Latin A with grave.
+        REQUIRE(fold_case(0xe0) == 0xe0);
+        REQUIRE(fold_case(0x391) == 0x3b1);         // Greek alpha.
+        REQUIRE(fold_case(0x410) == 0x430);         // Cyrillic A.
+        REQUIRE(fold_case(0x4e00) == 0x4e00);       // CJK.
+        REQUIRE(fold_case(0x10400) == 0x10400);     // Outside the BMP.
+        REQUIRE(fold_case(0x130) == 'i');           // Latin I with dot above.
+        REQUIRE(fold_case(0x178) == 0xff);          // Latin Y with diaeresis.
+        REQUIRE(fold_case(0x1c5) == 0x1c6);         // Latin DZ with caron, titlecase.
+        REQUIRE(fold_case(0x10a0) == 0x2d00);       // Georgian An.
+        REQUIRE(fold_case(0xff21) == 0xff41);       // Fullwidth A.
+        REQUIRE(fold_case(0xffff) == 0xffff);
+    }
+
+    SECTION("Runs")
+    {
+        for (int c = 0x100; c < 0x130; c += 2)      // Latin Extended-A pairs.
+        {
+            REQUIRE(fold_case(c) == c + 1);
+            REQUIRE(fold_case(c + 1) == c + 1);
+        }
+
+        for (int c = 0x410; c < 0x430; ++c)         // Cyrillic.
+            REQUIRE(fold_case(c) == c + 0x20);
+
+        // Lowercase characters fold to themselves.
+        for (int c = 0x80; c < 0x10000; ++c)
+            REQUIRE(fold_case(fold_case(c)) == fold_case(c));
+    }
+
+    SECTION("Compare")
+    {
+        str_compare_scope _(str_compare_scope::caseless);
+        REQUIRE(str_compare("\xc3\x80""bc", "\xc3\xa0""BC") == -1);
+        REQUIRE(str_compare(L"\x410xyz", L"\x430XYZ") == -1);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("String compare : ascii prefix")
+{
+    SECTION("Lengths")
+    {
+        str_compare_scope _(str_compare_scope::caseless);
+
+        const char* lhs = "The Quick Brown Fox Jumps Over The Lazy Dog";
+        const char* rhs = "the quick brown fox jumps over the lazy dog";
+        REQUIRE(str_compare(lhs, rhs) == -1);
+
+        // Every length, and every position for the first difference.
+        str<64> a, b;
+        for (int len = 0; len < 40; ++len)
+        {
+            for (int diff = 0; diff <= len; ++diff)
+            {
+                a.clear();
+                b.clear();
+                a.concat(lhs, len);
+                b.concat(rhs, len);
+                if (diff < len)
+                    b.data()[diff] = '#';
+
+                REQUIRE(str_compare(a.c_str(), b.c_str()) == (diff < len ? diff : -1));
+            }
+        }
+    }
+
+    SECTION("Bounded")
+    {
+        str_compare_scope _(str_compare_scope::exact);
+
+        // The prefix compare mustn't look past an iterator's end.
+        str_iter lhs("abcdefghijklmnop", 9);
+        str_iter rhs("abcdefghijklmnoq", 9);
+        REQUIRE(str_compare(lhs, rhs) == -1);
+
+        str_iter lhs2("abcdefghijklmnop", 10);
+        str_iter rhs2("abcdefghijklmnop", 12);
+        REQUIRE(str_compare(lhs2, rhs2) == 10);
+    }
+
+    SECTION("Modes")
+    {
+        REQUIRE(str_compare_ascii_prefix("abcdefgh", "ABCDEFGH", 8, true) == 8);
+        REQUIRE(str_compare_ascii_prefix("abcdefgh", "ABCDEFGH", 8, false) == 0);
+        REQUIRE(str_compare_ascii_prefix("@[`{abcd", "@[`{ABCD", 8, true) == 8);
+        REQUIRE(str_compare_ascii_prefix("@[`{abcd", "`{@[ABCD", 8, true) == 0);
+        REQUIRE(str_compare_ascii_prefix("abcdefg\xc3\x80", "abcdefg\xc3\x80", 9, false) == 0);
+
+        str_compare_scope _(str_compare_scope::relaxed);
+        REQUIRE(str_compare("a-b\\c-d-e-f-g-h", "a_b/c_d_e_f_g_h") == -1);
+    }
+}
+
+//------------------------------------------------------------------------------
+BENCHMARK("String compare")
+{
+    str_compare_scope _(str_compare_scope::caseless);
+
+    std::vector<std::string> matches;
+    str<> match;
+    for (int i = 0; i < 100000; ++i)
+    {
+        match.format("C:\\Program Files\\Some Vendor\\Product_%d.dll", i);
+        matches.push_back(match.c_str());
+    }
+
+    const char* needle = "c:\\program files\\some vendor\\product_1";
+
+    clatch::timer timer;
+    int selected = 0;
+    for (int pass = 0; pass < 10; ++pass)
+        for (const auto& m : matches)
+            selected += (str_compare(needle, m.c_str()) == int(strlen(needle)));
+    timer.report("caseless select, 10 x 100k matches");
+
+    REQUIRE(selected == 10 * 11111);
+}
@@ -168,3 +168,183 @@ TEST_CASE("Wide character/UTF-8 conversion")
         }
     }
 }
+
+//------------------------------------------------------------------------------
+// The per-code-point conversions the fast paths replaced.
+static void reference_to_utf16(wstr_base& out, const char* utf8)
+{
+    out.clear();
+    str_iter iter(utf8);
+    while (int c = iter.next())
+    {
+        if (c > 0xffff)
+        {
+            wchar_t pair[] = { wchar_t((c >> 10) + 0xd7c0), wchar_t((c & 0x3ff) + 0xdc00), 0 };
+            out.concat(pair, 2);
+        }
+        else
+        {
+            wchar_t one[] = { wchar_t(c), 0 };
+            out.concat(one, 1);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static void reference_to_utf8(str_base& out, const wchar_t* utf16)
+{
+    out.clear();
+    wstr_iter iter(utf16);
+    while (int c = iter.next())
+    {
+        char bytes[5];
+        int n = 0;
+        if (c < 0x80)
+            bytes[n++] = char(c);
+        else
+        {
+            if (c < 0x800)
+                bytes[n++] = char(0xc0 | (c >> 6));
+            else
+            {
+                if (c < 0x10000)
+                    bytes[n++] = char(0xe0 | (c >> 12));
+                else
+                {
+                    bytes[n++] = char(0xf0 | (c >> 18));
+                    bytes[n++] = char(0x80 | ((c >> 12) & 0x3f));
+                }
+                bytes[n++] = char(0x80 | ((c >> 6) & 0x3f));
+            }
+            bytes[n++] = char(0x80 | (c & 0x3f));
+        }
+
+        bytes[n] = '\0';
+        out.concat(bytes, n);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("UTF-8/UTF-16 conversion : fast paths")
+{
+    // Mix ASCII runs of every length around the 8 byte stride with multi-byte
+    // sequences, so every boundary between the fast and slow paths is crossed.
+    static const char* const pieces[] = {
+        "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "abcdefgh", "x",
+    };
+
+    str<> utf8;
+    for (int i = 0; i < 200; ++i)
+    {
+        for (int j = 0; j < i % 19; ++j)
+            utf8.concat("0123456789abcdef" + (j % 16), 1);
+        utf8 << pieces[i % sizeof_array(pieces)];
+    }
+
+    wstr<> expected;
+    reference_to_utf16(expected, utf8.c_str());
+
+    SECTION("To UTF-16")
+    {
+        wstr<> s;
+        s.from_utf8(utf8.c_str());
+        REQUIRE(s.equals(expected.c_str()));
+        REQUIRE(s.length() == expected.length());
+    }
+
+    SECTION("To UTF-8")
+    {
+        str<> s;
+        s.from_utf16(expected.c_str());
+        REQUIRE(s.equals(utf8.c_str()));
+        REQUIRE(s.length() == utf8.length());
+    }
+
+    SECTION("Exact size")
+    {
+        // Measuring and converting agree, so growable strings never truncate.
+        wstr_iter iter(expected.c_str());
+        REQUIRE(to_utf8(nullptr, 0, iter) == int(utf8.length()));
+
+        str<16> s;
+        REQUIRE(to_utf8(s, expected.c_str()) == int(utf8.length()));
+    }
+
+    SECTION("Bounded")
+    {
+        str_iter iter(utf8.c_str(), 100);
+        wstr<> s;
+        to_utf16(s, iter);
+        REQUIRE(!iter.more());
+
+        str<> back;
+        back.from_utf16(s.c_str());
+        REQUIRE(back.length() <= 100);
+        REQUIRE(strncmp(back.c_str(), utf8.c_str(), back.length()) == 0);
+    }
+
+    SECTION("Embedded nul")
+    {
+        str_iter iter("abcdefghij\0klm", 14);
+        wstr<> s;
+        to_utf16(s, iter);
+        REQUIRE(s.equals(L"abcdefghij"));
+    }
+}
+
+//------------------------------------------------------------------------------
+BENCHMARK("UTF-8/UTF-16 conversion")
+{
+    // Source text of roughly 80 KB; all ASCII, and prose with a multi-byte
+    // character every few words.
+    str<> ascii;
+    str<> mixed;
+    for (int i = 0; i < 2000; ++i)
+    {
+        ascii << "The quick brown fox jumps over the lazy dog.\n";
+        mixed << "Caf\xc3\xa9 \xe2\x82\xac""5, na\xc3\xafve \xf0\x9f\x98\x80 fa\xc3\xa7""ade.\n";
+    }
+
+    static const int repeats = 200;
+    wstr<> ascii16(ascii.c_str());
+    wstr<> mixed16(mixed.c_str());
+    wstr<> utf16;
+    str<> utf8;
+    clatch::timer timer;
+
+    for (int i = 0; i < repeats; ++i)
+        reference_to_utf16(utf16, ascii.c_str());
+    timer.report("ASCII to UTF-16 (per code point)");
+
+    for (int i = 0; i < repeats; ++i)
+        utf16.from_utf8(ascii.c_str());
+    timer.report("ASCII to UTF-16 (to_utf16)");
+    REQUIRE(utf16.equals(ascii16.c_str()));
+
+    for (int i = 0; i < repeats; ++i)
+        reference_to_utf8(utf8, ascii16.c_str());
+    timer.report("ASCII to UTF-8 (per code point)");
+
+    for (int i = 0; i < repeats; ++i)
+        utf8.from_utf16(ascii16.c_str());
+    timer.report("ASCII to UTF-8 (to_utf8)");
+    REQUIRE(utf8.equals(ascii.c_str()));
+
+    for (int i = 0; i < repeats; ++i)
+        reference_to_utf16(utf16, mixed.c_str());
+    timer.report("Mixed to UTF-16 (per code point)");
+
+    for (int i = 0; i < repeats; ++i)
+        utf16.from_utf8(mixed.c_str());
+    timer.report("Mixed to UTF-16 (to_utf16)");
+    REQUIRE(utf16.equals(mixed16.c_str()));
+
+    for (int i = 0; i < repeats; ++i)
+        reference_to_utf8(utf8, mixed16.c_str());
+    timer.report("Mixed to UTF-8 (per code point)");
+
+    for (int i = 0; i < repeats; ++i)
+        utf8.from_utf16(mixed16.c_str());
+    timer.report("Mixed to UTF-8 (to_utf8)");
+    REQUIRE(utf8.equals(mixed.c_str()));
+}
@@ -56,5 +56,6 @@ public:
     virtual void            on_matches_changed(const context& context) = 0;
     virtual void            on_classifications_changed(const context& context) = 0;
     virtual void            on_input(const input& input, result& result, const context& context) = 0;
+    virtual void            on_paste(const char* text, unsigned int len, result& result, const context& context) = 0;
     virtual void            on_terminal_resize(int columns, int rows, const context& context) = 0;
 };
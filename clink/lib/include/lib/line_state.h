@@ -10,8 +10,8 @@
 //------------------------------------------------------------------------------
 struct word
 {
-    unsigned int        offset : 16;
-    unsigned int        length : 16;
+    unsigned int        offset;
+    unsigned int        length;
     bool                command_word;
     bool                quoted;
     unsigned char       delim;
@@ -136,6 +136,14 @@ match_type to_match_type(int mode, int attr);
 match_type to_match_type(const char* type_name);
 void match_type_to_string(match_type type, str_base& out);
 
+//------------------------------------------------------------------------------
+// A display filter list and its entries are allocated from an arena owned by
+// the list, so the whole list is freed at once.  Entry [0] and the terminating
+// nullptr are included in the slots allocated.
+class arena;
+match_display_filter_entry** new_filtered_match_list(unsigned int count, arena*& store);
+void free_filtered_match_list(match_display_filter_entry** list);
+
 //------------------------------------------------------------------------------
 struct match_desc
 {
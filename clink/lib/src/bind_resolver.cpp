@@ -77,10 +77,10 @@ bind_resolver::bind_resolver(const binder& binder)
 //------------------------------------------------------------------------------
 void bind_resolver::set_group(int group)
 {
-    if (unsigned(group) - 1 >= sizeof_array(m_binder.m_nodes) - 1)
+    if (unsigned(group) - 1 >= m_binder.m_next_node - 1)
         return;
 
-    if (m_group == group || !m_binder.get_node(group - 1).is_group)
+    if (m_group == unsigned(group) || !m_binder.get_node(group - 1).is_group)
         return;
 
     m_group = group;
@@ -178,6 +178,22 @@ bool bind_resolver::is_bound(const char* seq, int len) const
     return m_binder.is_bound(m_group, seq, len);
 }
 
+//------------------------------------------------------------------------------
+bool bind_resolver::is_catch_all(unsigned char key) const
+{
+    // No chord's in progress and no bind in the group starts with 'key', so
+    // only the group's "" bind (if any) would see it.
+    return (!m_key_count && !m_binder.find_child(m_group, key));
+}
+
+//------------------------------------------------------------------------------
+editor_module* bind_resolver::get_catch_all() const
+{
+    // A group's "" bind lives on the group's root node.
+    const binder::node& node = m_binder.get_node(m_group);
+    return node.bound ? m_binder.get_module(node.module) : nullptr;
+}
+
 //------------------------------------------------------------------------------
 void bind_resolver::claim(binding& binding)
 {
@@ -98,12 +98,17 @@ template <int SIZE> static bool translate_chord(const char* chord, char (&out)[S
 
 
 
+// Nodes with this many children get a table indexed by key, so finding a child
+// doesn't walk a long sibling list.  Group roots are the usual case.
+static const int c_dense_children = 8;
+
 //------------------------------------------------------------------------------
 binder::binder()
 {
     // Initialise the default group.
-    m_nodes[0] = { 1 };
-    m_nodes[1] = { 0 };
+    m_nodes.reserve(512);
+    m_nodes.resize(2);
+    m_nodes[0].is_group = 1;
     m_next_node = 2;
 
     static_assert(sizeof(node) == sizeof(group_node), "Size assumption");
@@ -121,7 +126,7 @@ int binder::get_group(const char* name)
     while (index)
     {
         const group_node* node = get_group_node(index);
-        if (*(int*)(node->hash) == hash)
+        if (node->hash == hash)
             return index + 1;
 
         index = node->next;
@@ -142,7 +147,7 @@ int binder::create_group(const char* name)
 
     // Create a new group node;
     group_node* group = get_group_node(index);
-    *(int*)(group->hash) = str_hash(name);
+    group->hash = str_hash(name);
     group->is_group = 1;
 
     // Link the new node into the front of the list.
@@ -164,7 +169,7 @@ bool binder::bind(
     unsigned char id)
 {
     // Validate input
-    if (group >= sizeof_array(m_nodes))
+    if (group >= m_next_node)
         return false;
 
     // Translate from ASCII representation to actual keys.
@@ -187,34 +192,31 @@ bool binder::bind(
         if (!(head = insert_child(head, *chord)))
             return false;
 
-    --chord;
-
     // If the insert point is already bound we'll duplicate the node at the end
     // of the list. Also check if this is a duplicate of the existing bind.
-    node* bindee = m_nodes + head;
-    if (bindee->bound)
+    if (m_nodes[head].bound)
     {
-        int check = head;
-        while (check > head)
+        // Later siblings have higher indices; the last one links back to the
+        // parent.
+        for (int check = head; check >= head; check = m_nodes[check].next)
         {
-            if (bindee->key == *chord && bindee->module == module_index && bindee->id == id)
+            const node& bindee = m_nodes[check];
+            if (bindee.bound && bindee.key == m_nodes[head].key &&
+                bindee.module == module_index && bindee.id == id)
                 return true;
-
-            check = bindee->next;
-            bindee = m_nodes + check;
         }
 
-        head = append(head, *chord);
+        head = append(head, m_nodes[head].key);
     }
 
     if (!head)
         return false;
 
-    bindee = m_nodes + head;
-    bindee->module = module_index;
-    bindee->bound = 1;
-    bindee->depth = depth;
-    bindee->id = id;
+    node& bindee = m_nodes[head];
+    bindee.module = module_index;
+    bindee.bound = 1;
+    bindee.depth = depth;
+    bindee.id = id;
 
     return true;
 }
@@ -249,12 +251,14 @@ int binder::insert_child(int parent, unsigned char key)
 //------------------------------------------------------------------------------
 int binder::find_child(int parent, unsigned char key) const
 {
-    const node* node = m_nodes + parent;
+    const node* node = &m_nodes[parent];
+    if (node->table)
+        return m_tables[((node->table - 1) << 8) + key];
 
     int index = node->child;
     for (; index > parent; index = node->next)
     {
-        node = m_nodes + index;
+        node = &m_nodes[index];
         if (node->key == key)
             return index;
     }
@@ -271,24 +275,51 @@ int binder::add_child(int parent, unsigned char key)
 
     node addee = {};
     addee.key = key;
+    addee.next = parent;
 
+    int count = 0;
     int current_child = m_nodes[parent].child;
     if (current_child < parent)
     {
-        addee.next = parent;
         m_nodes[parent].child = child;
     }
     else
     {
-        int tail = find_tail(current_child);
-        addee.next = parent;
+        int tail = current_child;
+        for (count = 1; m_nodes[tail].next > tail; ++count)
+            tail = m_nodes[tail].next;
         m_nodes[tail].next = child;
     }
 
     m_nodes[child] = addee;
+
+    // Once a node's dense its table maps each key to its first child, as
+    // walking the list would find.
+    if (unsigned int table = m_nodes[parent].table)
+        m_tables[((table - 1) << 8) + key] = child;
+    else if (count + 1 >= c_dense_children)
+        add_table(parent);
+
     return child;
 }
 
+//------------------------------------------------------------------------------
+void binder::add_table(int parent)
+{
+    unsigned int table = (unsigned int)(m_tables.size() >> 8);
+    m_tables.resize(m_tables.size() + 256);
+
+    unsigned int* slots = &m_tables[table << 8];
+    for (int index = m_nodes[parent].child; index > parent; index = m_nodes[index].next)
+    {
+        unsigned char key = m_nodes[index].key;
+        if (!slots[key])
+            slots[key] = index;
+    }
+
+    m_nodes[parent].table = table + 1;
+}
+
 //------------------------------------------------------------------------------
 int binder::find_tail(int head)
 {
@@ -319,7 +350,7 @@ int binder::append(int head, unsigned char key)
 //------------------------------------------------------------------------------
 const binder::node& binder::get_node(unsigned int index) const
 {
-    if (index < sizeof_array(m_nodes))
+    if (index < m_next_node)
         return m_nodes[index];
 
     static const node zero = {};
@@ -329,8 +360,8 @@ const binder::node& binder::get_node(unsigned int index) const
 //------------------------------------------------------------------------------
 binder::group_node* binder::get_group_node(unsigned int index)
 {
-    if (index < sizeof_array(m_nodes))
-        return (group_node*)(m_nodes + index);
+    if (index < m_next_node)
+        return (group_node*)(&m_nodes[index]);
 
     return nullptr;
 }
@@ -338,33 +369,28 @@ binder::group_node* binder::get_group_node(unsigned int index)
 //------------------------------------------------------------------------------
 int binder::alloc_nodes(unsigned int count)
 {
-    int next = m_next_node + count;
-    if (next > sizeof_array(m_nodes))
+    // Node indices are stored as ints.
+    if (m_next_node + count > 0x7fffffff)
         return -1;
 
-    m_next_node = next;
+    m_next_node += count;
+    m_nodes.resize(m_next_node);
     return m_next_node - count;
 }
 
 //------------------------------------------------------------------------------
 int binder::add_module(editor_module& module)
 {
-    for (int i = 0, n = m_modules.size(); i < n; ++i)
-        if (*(m_modules[i]) == &module)
+    for (int i = 0, n = int(m_modules.size()); i < n; ++i)
+        if (m_modules[i] == &module)
             return i;
 
-    if (editor_module** slot = m_modules.push_back())
-    {
-        *slot = &module;
-        return int(slot - m_modules.front());
-    }
-
-    return -1;
+    m_modules.push_back(&module);
+    return int(m_modules.size() - 1);
 }
 
 //------------------------------------------------------------------------------
 editor_module* binder::get_module(unsigned int index) const
 {
-    auto b = m_modules[index];
-    return b ? *b : nullptr;
+    return (index < m_modules.size()) ? m_modules[index] : nullptr;
 }
@@ -3,7 +3,7 @@
 
 #pragma once
 
-#include <core/array.h>
+#include <vector>
 
 class editor_module;
 
@@ -18,33 +18,33 @@ public:
     bool                is_bound(unsigned int group, const char* seq, int len) const;
 
 private:
-    static const int    link_bits = 9;
-    static const int    module_bits = 6;
-
     struct node
     {
-        unsigned short  is_group    : 1;
-        unsigned short  next        : link_bits;
-        unsigned short  module      : module_bits;
-
-        unsigned short  child       : link_bits;
-        unsigned short  depth       : 4;
-        unsigned short  bound       : 1;
-        unsigned short              : 2;
-
+        unsigned int    next;
+        unsigned int    child;
+        unsigned int    module;
+        unsigned int    table;
         unsigned char   key;
         unsigned char   id;
+        unsigned char   depth;
+        unsigned char   is_group    : 1;
+        unsigned char   bound       : 1;
+        unsigned char               : 6;
     };
 
     struct group_node
     {
-        unsigned short  is_group    : 1;
-        unsigned short  next        : link_bits;
-        unsigned short              : 6;
-        unsigned short  hash[2];
+        unsigned int    next;
+        unsigned int    hash;
+        unsigned int    unused[2];
+        unsigned char   unused_bytes[3];
+        unsigned char   is_group    : 1;
+        unsigned char               : 7;
     };
 
-    typedef fixed_array<editor_module*, (1 << module_bits)> modules;
+    typedef std::vector<editor_module*> modules;
+    typedef std::vector<node> nodes;
+    typedef std::vector<unsigned int> tables;
 
     friend class        bind_resolver;
     int                 insert_child(int parent, unsigned char key);
@@ -52,12 +52,14 @@ private:
     int                 add_child(int parent, unsigned char key);
     int                 find_tail(int head);
     int                 append(int head, unsigned char key);
+    void                add_table(int parent);
     const node&         get_node(unsigned int index) const;
     group_node*         get_group_node(unsigned int index);
     int                 alloc_nodes(unsigned int count=1);
     int                 add_module(editor_module& module);
     editor_module*      get_module(unsigned int index) const;
     modules             m_modules;
-    node                m_nodes[1 << link_bits];
+    nodes               m_nodes;
+    tables              m_tables;
     unsigned int        m_next_node;
 };
@@ -10,6 +10,7 @@
 #include "pager.h"
 
 #include <core/base.h>
+#include <core/log.h>
 #include <core/os.h>
 #include <core/path.h>
 #include <core/str_iter.h>
@@ -168,7 +169,7 @@ void line_editor_impl::begin_line()
     m_bind_resolver.reset();
     m_command_offset = 0;
     m_keys_size = 0;
-    m_prev_key = ~0u;
+    m_prev_key = { ~0u, ~0u, ~0u };
 
     assert(!s_editor);
     s_editor = this;
@@ -178,6 +179,7 @@ void line_editor_impl::begin_line()
 
     m_desc.input->begin();
     m_desc.output->begin();
+    m_printer.reset();
     m_buffer.begin_line();
     m_has_prev_buffer = false;
     m_prev_buffer.clear();
@@ -259,7 +261,12 @@ bool line_editor_impl::update()
         return true;
     }
 
-    update_input();
+    int key = m_desc.input->read();
+
+    // Time from the key arriving to the editor being ready for the next one.
+    TRACE_SCOPE("key");
+
+    update_input(key);
 
     if (!check_flag(flag_editing))
         return false;
@@ -380,9 +387,25 @@ void line_editor_impl::set_keyseq_len(int len)
 //------------------------------------------------------------------------------
 // Returns false when a chord is in progress, otherwise returns true.  This is
 // to help dispatch() be able to dispatch an entire chord.
-bool line_editor_impl::update_input()
+bool line_editor_impl::update_input(int key)
 {
-    int key = m_desc.input->read();
+    struct result_impl : public editor_module::result
+    {
+        enum
+        {
+            flag_pass       = 1 << 0,
+            flag_done       = 1 << 1,
+            flag_eof        = 1 << 2,
+            flag_redraw     = 1 << 3,
+        };
+
+        virtual void    pass() override                           { flags |= flag_pass; }
+        virtual void    done(bool eof) override                   { flags |= flag_done|(eof ? flag_eof : 0); }
+        virtual void    redraw() override                         { flags |= flag_redraw; }
+        virtual int     set_bind_group(int id) override           { int t = group; group = id; return t; }
+        unsigned int    group;  //        <! MSVC bugs; see connect
+        unsigned char   flags;  // = 0;   <! issues about C2905
+    };
 
     if (key == terminal_in::input_terminal_resize)
     {
@@ -396,34 +419,63 @@ bool line_editor_impl::update_input()
 
     if (key == terminal_in::input_abort)
     {
+        m_desc.input->flush();
         m_buffer.reset();
         end_line();
         return true;
     }
 
+    // Pastes go to whichever module's catching input in the current group
+    // as one block, rather than being interpreted key by key.
+    if (key == terminal_in::input_paste)
+    {
+        str<> text;
+        editor_module* module = m_bind_resolver.get_catch_all();
+        if (!m_desc.input->get_paste(text) || module == nullptr)
+            return true;
+
+        result_impl result;
+        result.flags = 0;
+        result.group = m_bind_resolver.get_group();
+
+        line_state line = get_linestate();
+        editor_module::context context = get_context(line);
+        {
+            TRACE_SCOPE("on_paste");
+            module->on_paste(text.c_str(), text.length(), result, context);
+        }
+
+        m_bind_resolver.set_group(result.group);
+
+        if (result.flags & result_impl::flag_done)
+        {
+            end_line();
+
+            if (result.flags & result_impl::flag_eof)
+                set_flag(flag_eof);
+        }
+
+        if (!check_flag(flag_editing))
+            return true;
+
+        if (result.flags & result_impl::flag_redraw)
+            m_buffer.redraw();
+
+        m_buffer.draw();
+        return true;
+    }
+
     if (key < 0)
         return true;
 
-    if (!m_bind_resolver.step(key))
-        return false;
+    if (update_text(key))
+        return true;
 
-    struct result_impl : public editor_module::result
     {
-        enum
-        {
-            flag_pass       = 1 << 0,
-            flag_done       = 1 << 1,
-            flag_eof        = 1 << 2,
-            flag_redraw     = 1 << 3,
-        };
-
-        virtual void    pass() override                           { flags |= flag_pass; }
-        virtual void    done(bool eof) override                   { flags |= flag_done|(eof ? flag_eof : 0); }
-        virtual void    redraw() override                         { flags |= flag_redraw; }
-        virtual int     set_bind_group(int id) override           { int t = group; group = id; return t; }
-        unsigned short  group;  //        <! MSVC bugs; see connect
-        unsigned char   flags;  // = 0;   <! issues about C2905
-    };
+        TRACE_SCOPE("bind");
+        if (!m_bind_resolver.step(key))
+            return false;
+    }
 
 // input_dispatcher::dispatch()?
     while (auto binding = m_bind_resolver.next())
@@ -441,7 +493,10 @@ bool line_editor_impl::update_input()
         line_state line = get_linestate();
         editor_module::context context = get_context(line);
         editor_module::input input = { chord.c_str(), chord.length(), id };
-        module->on_input(input, result, context);
+        {
+            TRACE_SCOPE("on_input");
+            module->on_input(input, result, context);
+        }
 
         m_bind_resolver.set_group(result.group);
 
@@ -562,6 +617,14 @@ bool line_editor_impl::check_flag(unsigned char flag) const
     return ((m_flags & flag) != 0);
 }
 
+//------------------------------------------------------------------------------
+bool line_editor_impl::key_t::operator != (const key_t& rhs) const
+{
+    return (word_offset != rhs.word_offset ||
+            word_length != rhs.word_length ||
+            cursor_pos != rhs.cursor_pos);
+}
+
 //------------------------------------------------------------------------------
 void line_editor_impl::update_internal()
 {
@@ -590,6 +653,7 @@ void line_editor_impl::update_internal()
                     words[0].offset,
                     words
                 );
+                TRACE_SCOPE("classify");
                 m_classifier->classify(linestate, m_classifications);
                 words.clear();
             }
@@ -624,35 +688,26 @@ void line_editor_impl::update_internal()
 
     const word& end_word = m_words.back();
 
-    union key_t {
-        struct {
-            unsigned int word_offset : 11;
-            unsigned int word_length : 10;
-            unsigned int cursor_pos  : 11;
-        };
-        unsigned int value;
-    };
-
-    key_t next_key = { end_word.offset, end_word.length };
+    key_t next_key = { end_word.offset, end_word.length, 0 };
 
-    key_t prev_key;
-    prev_key.value = m_prev_key;
+    key_t prev_key = m_prev_key;
     prev_key.cursor_pos = 0;
 
     // Should we generate new matches?
-    if (next_key.value != prev_key.value)
+    if (next_key != prev_key)
     {
         line_state line = get_linestate();
+        TRACE_SCOPE("generate");
         match_pipeline pipeline(m_matches);
         pipeline.reset();
         pipeline.generate(line, m_generators);
     }
 
     next_key.cursor_pos = m_buffer.get_cursor();
-    prev_key.value = m_prev_key;
+    prev_key = m_prev_key;
 
     // Should we sort and select matches?
-    if (next_key.value != prev_key.value)
+    if (next_key != prev_key)
     {
         str<64> needle;
         int needle_start = end_word.offset;
@@ -666,11 +721,12 @@ void line_editor_impl::update_internal()
                 needle.truncate(i - 1);
         }
 
+        TRACE_SCOPE("select");
         match_pipeline pipeline(m_matches);
         pipeline.select(needle.c_str());
         pipeline.sort();
 
-        m_prev_key = next_key.value;
+        m_prev_key = next_key;
 
         // Tell all the modules that the matches changed.
         line_state line = get_linestate();
@@ -733,3 +789,57 @@ matches* maybe_regenerate_matches(const char* needle, bool popup)
 
     return &regen;
 }
+
+//------------------------------------------------------------------------------
+bool line_editor_impl::update_text(int key)
+{
+    // A run of plain text that's already waiting (e.g. a paste) is inserted as
+    // one edit rather than being fed through Readline a key at a time.
+    if (!is_text(key) || !is_text(m_desc.input->peek()))
+        return false;
+
+    if (m_bind_resolver.get_group() != m_binder.get_group())
+        return false;
+
+    if (rl_is_insert_next_callback_pending() || rl_insert_mode != RL_IM_INSERT)
+        return false;
+
+    static const int idle_states = (RL_STATE_CALLBACK |
+                                    RL_STATE_INITIALIZED |
+                                    RL_STATE_TERMPREPPED |
+                                    RL_STATE_VICMDONCE);
+    if (rl_readline_state & ~idle_states)
+        return false;
+
+    str<256> text;
+    do
+    {
+        char c = char(key);
+        text.concat(&c, 1);
+    }
+    while (is_text(m_desc.input->peek()) && (key = m_desc.input->read()) >= 0);
+
+    m_buffer.insert(text.c_str());
+    rl_last_func = rl_insert;
+
+    m_buffer.draw();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool line_editor_impl::is_text(int key) const
+{
+    if (key < 0x20 || key == 0x7f)
+        return false;
+
+    if (!m_bind_resolver.is_catch_all(key))
+        return false;
+
+    // UTF-8 bytes aren't in Readline's keymap; they're always self-inserted.
+    if (key >= 0x80)
+        return true;
+
+    char c = char(key);
+    int type = ISFUNC;
+    return (rl_function_of_keyseq_len(&c, 1, nullptr, &type) == rl_insert && type == ISFUNC);
+}
@@ -51,6 +51,14 @@ private:
     typedef std::vector<word>                   words;
     friend matches* maybe_regenerate_matches(const char* needle, bool popup);
 
+    struct key_t
+    {
+        bool            operator != (const key_t& rhs) const;
+        unsigned int    word_offset;
+        unsigned int    word_length;
+        unsigned int    cursor_pos;
+    };
+
     enum flags : unsigned char
     {
         flag_init       = 1 << 0,
@@ -65,7 +73,9 @@ private:
     void                collect_words(bool stop_at_cursor=true);
     unsigned int        collect_words(words& words, matches_impl& matches, collect_words_mode mode);
     void                update_internal();
-    bool                update_input();
+    bool                update_input(int key);
+    bool                update_text(int key);
+    bool                is_text(int key) const;
     module::context     get_context(const line_state& line) const;
     line_state          get_linestate() const;
     void                set_flag(unsigned char flag);
@@ -87,8 +97,8 @@ private:
     matches_impl        m_matches;
     printer&            m_printer;
     pager_impl          m_pager;
-    unsigned int        m_prev_key;
-    unsigned short      m_command_offset;
+    key_t               m_prev_key;
+    unsigned int        m_command_offset;
     unsigned char       m_keys_size;
     unsigned char       m_flags = 0;
 };
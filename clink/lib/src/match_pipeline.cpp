@@ -16,6 +16,8 @@
 #include <readline/readline.h>
 
 #include <algorithm>
+#include <unordered_map>
+#include <vector>
 #include <assert.h>
 
 //------------------------------------------------------------------------------
@@ -26,6 +28,14 @@ static setting_enum g_sort_dirs(
     "before,with,after",
     1);
 
+static setting_bool g_sort_frecent(
+    "match.sort_frecent",
+    "Sort frecent directories first",
+    "When enabled, directories that have been visited go before other matches,\n"
+    "ranked by how often and how recently (see 'history.frecency').  The\n"
+    "'match.sort_dirs' setting still keeps them before or after files.",
+    false);
+
 
 
 //------------------------------------------------------------------------------
@@ -36,6 +46,8 @@ extern int _rl_locale_sort;
 int compare_string(const char* s1, const char* s2, int casefold);
 };
 
+extern void host_get_dir_frecency(const char* const* dirs, int count, unsigned int* scores);
+
 
 
 //------------------------------------------------------------------------------
@@ -50,7 +62,7 @@ static unsigned int normal_selector(
         const char* name = infos[i].match;
         int j = str_compare(needle, name);
         infos[i].select = (j < 0 || !needle[j]);
-        ++select_count;
+        select_count += infos[i].select;
     }
 
     return select_count;
@@ -155,10 +167,39 @@ void sort_match_list(char** matches, int len)
         return;
     }
 
+    // Directory matches are scored up front, so the store's read once.
+    std::unordered_map<const char*, unsigned int> scores;
+    if (g_sort_frecent.get())
+    {
+        std::vector<const char*> dirs;
+        for (int i = 0; i < len; ++i)
+        {
+            const char* match = matches[i] + 1;
+            match_type type = match_type(*matches[i]);
+            int length = int(strlen(match));
+            if (is_match_type(type, match_type::dir) ||
+                (is_match_type(type, match_type::none) && length && path::is_separator(match[length - 1])))
+                dirs.push_back(match);
+        }
+
+        std::vector<unsigned int> dir_scores(dirs.size());
+        if (!dirs.empty())
+            host_get_dir_frecency(dirs.data(), int(dirs.size()), dir_scores.data());
+
+        for (unsigned int i = 0; i < dirs.size(); ++i)
+            if (dir_scores[i])
+                scores.emplace(dirs[i], dir_scores[i]);
+    }
+
     int order = g_sort_dirs.get();
     wstr<> ltmp;
     wstr<> rtmp;
 
+    auto get_score = [&] (const char* match) {
+        auto iter = scores.find(match);
+        return (iter == scores.end()) ? 0 : iter->second;
+    };
+
     auto predicate = [&] (const char* l, const char* r) {
         match_type l_type = match_type(*(l++));
         match_type r_type = match_type(*(r++));
@@ -168,6 +209,21 @@ void sort_match_list(char** matches, int len)
         to_utf16(ltmp, l);
         to_utf16(rtmp, r);
 
+        // Frecent directories go first, but still within their group when
+        // directories are sorted apart from files.
+        if (!scores.empty())
+        {
+            bool l_dir = is_dir_match(ltmp, l_type);
+            bool r_dir = is_dir_match(rtmp, r_type);
+            if (order != 1 && l_dir != r_dir)
+                return (order == 0) ? l_dir : r_dir;
+
+            unsigned int l_score = get_score(l);
+            unsigned int r_score = get_score(r);
+            if (l_score != r_score)
+                return l_score > r_score;
+        }
+
         return sort_worker(ltmp, l_type, rtmp, r_type, order);
     };
 
@@ -235,9 +291,13 @@ void match_pipeline::select(const char* needle) const
     }
 
     if (count)
+    {
+        count = m_matches.get_select_range(needle);
         selected_count = normal_selector(needle, m_matches.get_infos(), count);
+    }
 
     m_matches.coalesce(selected_count);
+    m_matches.set_selected(needle);
 
     free(expanded);
 
@@ -15,6 +15,7 @@
 #include <readline/readline.h> // for rl_last_path_separator
 
 #include <assert.h>
+#include <unordered_map>
 
 extern "C" {
 extern int rl_complete_with_tilde_expansion;
@@ -130,6 +131,23 @@ void match_type_to_string(match_type type, str_base& out)
         out.concat(",readonly");
 }
 
+//------------------------------------------------------------------------------
+match_display_filter_entry** new_filtered_match_list(unsigned int count, arena*& store)
+{
+    // The slot before the list holds the arena, for free_filtered_match_list().
+    store = new arena;
+    void** slots = store->calloc<void*>(1 + 1 + count + 1);
+    slots[0] = store;
+    return reinterpret_cast<match_display_filter_entry**>(slots + 1);
+}
+
+//------------------------------------------------------------------------------
+void free_filtered_match_list(match_display_filter_entry** list)
+{
+    if (list)
+        delete static_cast<arena*>(reinterpret_cast<void**>(list)[-1]);
+}
+
 //------------------------------------------------------------------------------
 match_builder::match_builder(matches& matches)
 : m_matches(matches)
@@ -269,104 +287,106 @@ shadow_bool matches_iter::is_filename_display_desired() const
 
 
 
+// Each match in the store is preceded by its match_type byte, which is the form
+// Readline expects when rl_completion_matches_include_type is set.  That lets
+// Readline's match lists point straight into the store instead of at copies.
+// A store with matches on loan to Readline is pinned; resetting the store
+// orphans a pinned arena and starts a new one, and the last release frees it.
+//
+// Ahead of the type byte is the pool the match was stored in, so pinning needs
+// no search.  Readline also frees strings of its own through release_match(),
+// so only pinned matches are looked up (in s_pinned) to find their pool.
+static std::unordered_multimap<const char*, void*> s_pinned;
+
 //------------------------------------------------------------------------------
 matches_impl::store_impl::store_impl(unsigned int size)
 {
     m_size = max((unsigned int)4096, size);
-    m_ptr = nullptr;
-    new_page();
+    m_pool = nullptr;
+    new_pool();
 }
 
 //------------------------------------------------------------------------------
 matches_impl::store_impl::~store_impl()
 {
-    free_chain(false/*keep_one*/);
+    if (m_pool->pins)
+        m_pool->orphaned = true;
+    else
+        free_pool(m_pool);
 }
 
 //------------------------------------------------------------------------------
 void matches_impl::store_impl::reset()
 {
-    free_chain(true/*keep_one*/);
-    m_back = m_size;
-    m_front = sizeof(m_ptr);
+    if (!m_pool->pins)
+    {
+        m_pool->mem.clear();
+        return;
+    }
+
+    m_pool->orphaned = true;
+    new_pool();
 }
 
 //------------------------------------------------------------------------------
-const char* matches_impl::store_impl::store_front(const char* str)
+const char* matches_impl::store_impl::store_front(const char* str, match_type type)
 {
-    unsigned int size = get_size(str);
-    unsigned int next = m_front + size;
-    if (next > m_back && !new_page())
+    unsigned int length = str ? (unsigned int)strlen(str) : 0;
+    char* ptr = (char*)m_pool->mem.alloc(sizeof(pool*) + 1 + length + 1, 1);
+    if (!ptr)
         return nullptr;
 
-    str_base(m_ptr + m_front, size).copy(str);
+    memcpy(ptr, &m_pool, sizeof(pool*));
+    ptr += sizeof(pool*);
 
-    const char* ret = m_ptr + m_front;
-    m_front = next;
-    return ret;
+    ptr[0] = (char)type;
+    memcpy(ptr + 1, str, length);
+    ptr[1 + length] = '\0';
+    return ptr + 1;
 }
 
 //------------------------------------------------------------------------------
-const char* matches_impl::store_impl::store_back(const char* str)
+char* matches_impl::store_impl::pin(const char* str)
 {
-    unsigned int size = get_size(str);
-    unsigned int next = m_back - size;
-    if (next < m_front && !new_page())
+    if (!str)
         return nullptr;
 
-    m_back = next;
-    str_base(m_ptr + m_back, size).copy(str);
+    char* match = const_cast<char*>(str) - 1;
 
-    return m_ptr + m_back;
-}
-
-//------------------------------------------------------------------------------
-unsigned int matches_impl::store_impl::get_size(const char* str) const
-{
-    if (str == nullptr)
-        return 1;
+    pool* owner;
+    memcpy(&owner, match - sizeof(owner), sizeof(owner));
+    ++owner->pins;
 
-    return int(strlen(str) + 1);
+    s_pinned.emplace(match, owner);
+    return match;
 }
 
 //------------------------------------------------------------------------------
-bool matches_impl::store_impl::new_page()
+bool matches_impl::store_impl::release(char* str)
 {
-    char* temp = (char*)malloc(m_size);
-    if (temp == nullptr)
+    auto iter = s_pinned.find(str);
+    if (iter == s_pinned.end())
         return false;
 
-    *reinterpret_cast<char**>(temp) = m_ptr;
-    m_front = sizeof(m_ptr);
-    m_back = m_size;
-    m_ptr = temp;
+    pool* pool = static_cast<store_impl::pool*>(iter->second);
+    s_pinned.erase(iter);
+
+    assert(pool->pins);
+    if (!--pool->pins && pool->orphaned)
+        free_pool(pool);
     return true;
 }
 
 //------------------------------------------------------------------------------
-void matches_impl::store_impl::free_chain(bool keep_one)
+void matches_impl::store_impl::free_pool(pool* pool)
 {
-    char* ptr = m_ptr;
-
-    if (!keep_one)
-    {
-        m_ptr = nullptr;
-        m_front = sizeof(m_ptr);
-        m_back = m_size;
-    }
+    delete pool;
+}
 
-    while (ptr)
-    {
-        char* tmp = ptr;
-        ptr = *reinterpret_cast<char**>(ptr);
-        if (keep_one)
-        {
-            keep_one = false;
-            *reinterpret_cast<char**>(tmp) = nullptr;
-        }
-        else
-            free(tmp);
-    }
+//------------------------------------------------------------------------------
+void matches_impl::store_impl::new_pool()
+{
+    m_pool = new pool(m_size);
 }
 
 
@@ -522,6 +542,8 @@ void matches_impl::reset()
     m_infos.clear();
     m_coalesced = false;
     m_count = 0;
+    m_selections.clear();
+    m_selected_needle.clear();
     m_append_character = '\0';
     m_suppress_append = false;
     m_suppress_quoting = 0;
@@ -561,6 +583,18 @@ void matches_impl::set_matches_are_files(bool files)
     m_filename_display_desired.set_explicit(files);
 }
 
+//------------------------------------------------------------------------------
+char* matches_impl::pin_match(const char* match)
+{
+    return store_impl::pin(match);
+}
+
+//------------------------------------------------------------------------------
+bool matches_impl::release_match(char* match)
+{
+    return store_impl::release(match);
+}
+
 //------------------------------------------------------------------------------
 bool matches_impl::add_match(const match_desc& desc)
 {
@@ -577,7 +611,7 @@ bool matches_impl::add_match(const match_desc& desc)
             type = match_type::dir;
     }
 
-    const char* store_match = m_store.store_front(match);
+    const char* store_match = m_store.store_front(match, type);
     if (!store_match)
         return false;
 
@@ -620,3 +654,40 @@ void matches_impl::coalesce(unsigned int count_hint)
     m_count = j;
     m_coalesced = true;
 }
+
+//------------------------------------------------------------------------------
+unsigned int matches_impl::get_select_range(const char* needle)
+{
+    // The matches for a needle are a subset of the matches for any prefix of
+    // it, and coalesce() leaves each subset at the front of the infos.  So
+    // only the matches selected for the longest remembered prefix of needle
+    // need testing again.
+
+    int mode = str_compare_scope::current();
+    if (mode != m_selected_mode)
+    {
+        m_selections.clear();
+        m_selected_mode = mode;
+    }
+
+    unsigned int common = 0;
+    const char* prev = m_selected_needle.c_str();
+    while (prev[common] && prev[common] == needle[common])
+        ++common;
+
+    while (!m_selections.empty() && m_selections.back().needle_length > common)
+        m_selections.pop_back();
+
+    return m_selections.empty() ? get_info_count() : m_selections.back().count;
+}
+
+//------------------------------------------------------------------------------
+void matches_impl::set_selected(const char* needle)
+{
+    unsigned int length = (unsigned int)strlen(needle);
+    if (!m_selections.empty() && m_selections.back().needle_length == length)
+        m_selections.pop_back();
+
+    m_selections.push_back({ length, m_count });
+    m_selected_needle = needle;
+}
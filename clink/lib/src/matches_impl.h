@@ -5,7 +5,9 @@
 
 #include "matches.h"
 
+#include "core/arena.h"
 #include "core/array.h"
+#include "core/str.h"
 #include <vector>
 
 //------------------------------------------------------------------------------
@@ -18,16 +20,6 @@ struct match_info
 
 
 
-//------------------------------------------------------------------------------
-class match_store
-{
-protected:
-    char*                   m_ptr;
-    unsigned int            m_size;
-};
-
-
-
 //------------------------------------------------------------------------------
 class match_generator;
 
@@ -53,6 +45,9 @@ public:
 
     void                    set_word_break_adjustment(int adjustment);
 
+    static char*            pin_match(const char* match);
+    static bool             release_match(char* match);
+
 private:
     virtual const char*     get_match(unsigned int index) const override;
     virtual match_type      get_match_type(unsigned int index) const override;
@@ -72,33 +67,52 @@ private:
     match_info*             get_infos();
     void                    reset();
     void                    coalesce(unsigned int count_hint);
+    unsigned int            get_select_range(const char* needle);
+    void                    set_selected(const char* needle);
 
 private:
     class store_impl
-        : public match_store
     {
     public:
                             store_impl(unsigned int size);
                             ~store_impl();
         void                reset();
-        const char*         store_front(const char* str);
-        const char*         store_back(const char* str);
+        const char*         store_front(const char* str, match_type type);
+        static char*        pin(const char* str);
+        static bool         release(char* str);
 
     private:
-        unsigned int        get_size(const char* str) const;
-        bool                new_page();
-        void                free_chain(bool keep_one);
-        unsigned int        m_front;
-        unsigned int        m_back;
+        struct pool
+        {
+                            pool(unsigned int size) : mem(size) {}
+            arena           mem;
+            unsigned int    pins = 0;
+            bool            orphaned = false;
+        };
+
+        static void         free_pool(pool* pool);
+        void                new_pool();
+        pool*               m_pool;
+        unsigned int        m_size;
+    };
+
+    struct selection
+    {
+        unsigned int        needle_length;
+        unsigned int        count;
     };
 
     typedef std::vector<match_info> infos;
+    typedef std::vector<selection> selections;
 
     store_impl              m_store;
     generators*             m_generators;
     infos                   m_infos;
     unsigned short          m_count = 0;
     bool                    m_coalesced = false;
+    selections              m_selections;
+    str<64>                 m_selected_needle;
+    int                     m_selected_mode = -1;
     char                    m_append_character = '\0';
     bool                    m_suppress_append = false;
     int                     m_suppress_quoting = 0;
@@ -91,6 +91,11 @@ void pager_impl::on_input(const input& input, result& result, const context& con
     }
 }
 
+//------------------------------------------------------------------------------
+void pager_impl::on_paste(const char* text, unsigned int len, result& result, const context& context)
+{
+}
+
 //------------------------------------------------------------------------------
 void pager_impl::on_terminal_resize(int columns, int rows, const context& context)
 {
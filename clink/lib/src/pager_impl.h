@@ -25,6 +25,7 @@ private:
     virtual void    on_matches_changed(const context& context) override;
     virtual void    on_classifications_changed(const context& context) override;
     virtual void    on_input(const input& input, result& result, const context& context) override;
+    virtual void    on_paste(const char* text, unsigned int len, result& result, const context& context) override;
     virtual void    on_terminal_resize(int columns, int rows, const context& context) override;
     void            set_limit(printer& printer, pager_amount amount);
     int             m_max = 0;
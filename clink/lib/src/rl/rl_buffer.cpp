@@ -6,6 +6,7 @@
 #include "line_state.h"
 
 #include <core/base.h>
+#include <core/log.h>
 #include <core/str_iter.h>
 #include <core/str_tokeniser.h>
 
@@ -86,6 +87,7 @@ void rl_buffer::draw()
 {
     if (m_need_draw)
     {
+        TRACE_SCOPE("draw");
         rl_redisplay();
         m_need_draw = false;
     }
@@ -94,6 +96,7 @@ void rl_buffer::draw()
 //------------------------------------------------------------------------------
 void rl_buffer::redraw()
 {
+    TRACE_SCOPE("redraw");
     rl_forced_update_display();
 }
 
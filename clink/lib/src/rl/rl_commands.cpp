@@ -49,7 +49,7 @@ static void write_line_feed()
 }
 
 //------------------------------------------------------------------------------
-static void strip_crlf(char* line)
+void strip_crlf(char* line)
 {
     int setting = g_paste_crlf.get();
 
@@ -13,6 +13,7 @@ int     clink_reset_line(int, int);
 int     clink_exit(int count, int invoking_key);
 int     clink_ctrl_c(int count, int invoking_key);
 int     clink_paste(int count, int invoking_key);
+void    strip_crlf(char* line);
 int     clink_copy_line(int count, int invoking_key);
 int     clink_copy_word(int count, int invoking_key);
 int     clink_copy_cwd(int count, int invoking_key);
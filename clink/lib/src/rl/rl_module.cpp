@@ -8,6 +8,7 @@
 #include "line_state.h"
 #include "matches.h"
 #include "match_pipeline.h"
+#include "matches_impl.h"
 #include "popup.h"
 
 #include <core/base.h>
@@ -84,6 +85,7 @@ inline int clink_wcwidth(char32_t c)
 
 extern void host_add_history(int rl_history_index, const char* line);
 extern void host_remove_history(int rl_history_index, const char* line);
+extern bool host_get_suggestion(const char* line, str_base& out);
 extern void sort_match_list(char** matches, int len);
 extern matches* maybe_regenerate_matches(const char* needle, bool popup);
 extern setting_color g_color_interact;
@@ -154,6 +156,20 @@ setting_color g_color_filtered(
     "The default color for filtered completions.",
     "bold");
 
+setting_color g_color_suggestion(
+    "color.suggestion",
+    "Suggestion color",
+    "Used when Clink displays a suggestion from the history after the input.",
+    "bright black");
+
+setting_bool g_autosuggest(
+    "autosuggest.enable",
+    "Suggest input from the history",
+    "When enabled, the most recent history line that starts with the input\n"
+    "is shown after it while the cursor is at the end of the line.  The\n"
+    "clink-accept-suggestion command (Right by default) inserts it.",
+    false);
+
 setting_bool g_match_wild(
     "match.wild",
     "menu-complete matches ? and * wildcards",
@@ -356,6 +372,13 @@ static char* filename_menu_completion_function(const char *text, int state)
     return nullptr;
 }
 
+//------------------------------------------------------------------------------
+static void free_match(char* match)
+{
+    if (!matches_impl::release_match(match))
+        free(match);
+}
+
 //------------------------------------------------------------------------------
 static bool ensure_matches_size(char**& matches, int count, int& reserved)
 {
@@ -418,8 +441,9 @@ static char** alternative_matches(const char* text, int start, int end)
         end_prefix = (char*)text + 2;
     int len_prefix = end_prefix ? end_prefix - text : 0;
 
-    // Deep copy of the generated matches.  Inefficient, but this is how
-    // readline wants them.
+    // The store lays matches out with a leading type byte, which is how
+    // Readline wants them, so the array points straight into the store.  The
+    // matches are pinned until Readline frees them via free_match().
     str<32> lcd;
     int past_flag = rl_completion_matches_include_type;
     int count = 0;
@@ -445,16 +469,20 @@ static char** alternative_matches(const char* text, int start, int end)
         }
 
         const char* match = iter.get_match();
-        int match_len = strlen(match);
-        int match_size = past_flag + match_len + 1;
-        matches[count] = (char*)malloc(match_size);
+        matches[count] = matches_impl::pin_match(match);
+        if (!matches[count])
+        {
+            int match_len = strlen(match);
+            int match_size = past_flag + match_len + 1;
+            matches[count] = (char*)malloc(match_size);
 
-        if (past_flag)
-            matches[count][0] = (char)type;
+            if (past_flag)
+                matches[count][0] = (char)type;
 
-        str_base str(matches[count] + past_flag, match_size - past_flag);
-        str.clear();
-        str.concat(match, match_len);
+            str_base str(matches[count] + past_flag, match_size - past_flag);
+            str.clear();
+            str.concat(match, match_len);
+        }
 
 #ifdef DEBUG
         if (debug_matches > 0 || (debug_matches < 0 && count - 1 < 0 - debug_matches))
@@ -541,7 +569,6 @@ static match_display_filter_entry** match_display_filter(char** matches, bool po
                 if (debug_filter)
                     printf("%u dupe: %s\n", hare, display);
 #endif
-                free(filtered_matches[hare]);
             }
             else
             {
@@ -683,6 +710,54 @@ int clink_popup_complete(int count, int invoking_key)
     return 0;
 }
 
+//------------------------------------------------------------------------------
+static str<> s_suggestion;
+static unsigned int s_suggestion_input_len = 0;
+
+//------------------------------------------------------------------------------
+static void update_suggestion()
+{
+    _rl_display_suggestion = nullptr;
+
+    if (!g_autosuggest.get() || !rl_end)
+    {
+        s_suggestion.clear();
+        return;
+    }
+
+    // The newest line starting with the input is also the newest starting with
+    // anything longer it starts with, so typing along a suggestion keeps it.
+    unsigned int length = rl_end;
+    bool extends = (s_suggestion.length() > length &&
+                    length >= s_suggestion_input_len &&
+                    strncmp(s_suggestion.c_str(), rl_line_buffer, length) == 0);
+    if (!extends)
+    {
+        str<> input;
+        input.concat(rl_line_buffer, length);
+        if (!host_get_suggestion(input.c_str(), s_suggestion))
+            s_suggestion.clear();
+    }
+
+    s_suggestion_input_len = length;
+    if (s_suggestion.length() > length)
+        _rl_display_suggestion = s_suggestion.c_str() + length;
+}
+
+//------------------------------------------------------------------------------
+int clink_accept_suggestion(int count, int invoking_key)
+{
+    // The line may have changed since it was last drawn.
+    update_suggestion();
+    if (!_rl_display_suggestion || !*_rl_display_suggestion || rl_point != rl_end)
+        return rl_forward_char(count, invoking_key);
+
+    // Copied because inserting changes what the suggestion points at.
+    str<> suffix(_rl_display_suggestion);
+    rl_insert_text(suffix.c_str());
+    return 0;
+}
+
 //------------------------------------------------------------------------------
 int clink_popup_history(int count, int invoking_key)
 {
@@ -700,12 +775,18 @@ int clink_popup_history(int count, int invoking_key)
     int orig_pos = where_history();
     int search_len = rl_point;
 
-    // Copy the history list (just a shallow copy of the line pointers).
+    // Copy the history list (just a shallow copy of the line pointers).  The
+    // search index skips lines that can't start with the search text.
+    str<> needle;
+    needle.concat(rl_buffer->get_buffer(), search_len);
     char** history = (char**)malloc(sizeof(*history) * history_length);
     int* indices = (int*)malloc(sizeof(*indices) * history_length);
     int total = 0;
     for (int i = 0; i < history_length; i++)
     {
+        i = history_search_candidate(needle.c_str(), i, 1);
+        if (i >= history_length)
+            break;
         if (!STREQN(rl_buffer->get_buffer(), list[i]->line, search_len))
             continue;
         history[total] = list[i]->line;
@@ -867,6 +948,7 @@ rl_module::rl_module(const char* shell_name, terminal_in* input)
     rl_instream = in_stream;
     rl_outstream = out_stream;
     _rl_visual_bell_func = visible_bell;
+    _rl_update_suggestion_function = update_suggestion;
 
     rl_readline_name = shell_name;
     rl_catch_signals = 0;
@@ -901,7 +983,9 @@ rl_module::rl_module(const char* shell_name, terminal_in* input)
     rl_adjust_completion_word = adjust_completion_word;
     rl_completion_display_matches_func = display_matches;
     rl_qsort_match_list_func = sort_match_list;
+    rl_free_match_func = free_match;
     rl_match_display_filter_func = match_display_filter_callback;
+    rl_free_match_display_filter_func = free_filtered_match_list;
     rl_is_exec_func = is_exec_ext;
     rl_postprocess_lcd_func = postprocess_lcd;
     rl_read_key_hook = read_key_hook;
@@ -934,6 +1018,7 @@ rl_module::rl_module(const char* shell_name, terminal_in* input)
         rl_add_funmap_entry("clink-scroll-bottom", clink_scroll_bottom);
         rl_add_funmap_entry("clink-popup-complete", clink_popup_complete);
         rl_add_funmap_entry("clink-popup-history", clink_popup_history);
+        rl_add_funmap_entry("clink-accept-suggestion", clink_accept_suggestion);
         rl_add_funmap_entry("clink-popup-directories", clink_popup_directories);
 
         // Override some defaults.
@@ -946,6 +1031,7 @@ rl_module::rl_module(const char* shell_name, terminal_in* input)
     static const char* emacs_key_binds[][2] = {
         { "\\e[1;5D",       "backward-word" },           // ctrl-left
         { "\\e[1;5C",       "forward-word" },            // ctrl-right
+        { "\\e[C",          "clink-accept-suggestion" }, // right
         { "\\e[F",          "end-of-line" },             // end
         { "\\e[H",          "beginning-of-line" },       // home
         { "\\e[3~",         "delete-char" },             // del
@@ -1038,6 +1124,7 @@ rl_module::~rl_module()
     free(_rl_comment_begin);
     _rl_comment_begin = nullptr;
 
+    _rl_update_suggestion_function = nullptr;
     s_direct_input = nullptr;
 }
 
@@ -1103,6 +1190,7 @@ void rl_module::on_begin_line(const context& context)
     _rl_command_color = build_color_sequence(g_color_cmd, m_command_color);
     _rl_alias_color = build_color_sequence(g_color_doskey, m_alias_color);
     _rl_filtered_color = build_color_sequence(g_color_filtered, m_filtered_color, true);
+    _rl_display_suggestion_color = build_color_sequence(g_color_suggestion, m_suggestion_color, true);
 
     if (!_rl_display_message_color)
         _rl_display_message_color = "\x1b[m";
@@ -1113,6 +1201,10 @@ void rl_module::on_begin_line(const context& context)
     if (_rl_colored_stats || _rl_colored_completion_prefix)
         _rl_parse_colors();
 
+    // Ask the terminal to bracket pastes with ESC[200~ and ESC[201~ while the
+    // line's edited (terminals that don't know the mode ignore it).
+    g_printer->print("\x1b[?2004h");
+
     m_done = false;
     m_eof = false;
     m_prev_group = -1;
@@ -1121,6 +1213,10 @@ void rl_module::on_begin_line(const context& context)
 //------------------------------------------------------------------------------
 void rl_module::on_end_line()
 {
+    // Programs run from the line would otherwise get the brackets too.
+    if (g_printer != nullptr)
+        g_printer->print("\x1b[?2004l");
+
     if (m_rl_buffer != nullptr)
     {
         rl_line_buffer = m_rl_buffer;
@@ -1136,6 +1232,9 @@ void rl_module::on_end_line()
     _rl_command_color = nullptr;
     _rl_alias_color = nullptr;
     _rl_filtered_color = nullptr;
+    _rl_display_suggestion = nullptr;
+    _rl_display_suggestion_color = nullptr;
+    s_suggestion.clear();
 
     // This prevents any partial Readline state leaking from one line to the next
     rl_readline_state &= ~RL_MORE_INPUT_STATES;
@@ -1230,6 +1329,29 @@ void rl_module::on_input(const input& input, result& result, const context& cont
     }
 }
 
+//------------------------------------------------------------------------------
+void rl_module::on_paste(const char* text, unsigned int len, result& result, const context& context)
+{
+    // If Readline's part way through something (searching, quoted-insert,
+    // etc.) then it gets the paste as though it were typed.
+    if ((rl_readline_state & RL_MORE_INPUT_STATES) || rl_is_insert_next_callback_pending())
+    {
+        input input = { text, len, bind_id_input };
+        on_input(input, result, context);
+        return;
+    }
+
+    str<> paste;
+    paste.concat(text, len);
+    strip_crlf(paste.data());
+
+    // Insert verbatim as a single edit.
+    context.buffer.begin_undo_group();
+    context.buffer.insert(paste.c_str());
+    context.buffer.end_undo_group();
+    rl_last_func = rl_insert;
+}
+
 //------------------------------------------------------------------------------
 void rl_module::done(const char* line)
 {
@@ -32,6 +32,7 @@ private:
     virtual void    on_matches_changed(const context& context) override;
     virtual void    on_classifications_changed(const context& context) override;
     virtual void    on_input(const input& input, result& result, const context& context) override;
+    virtual void    on_paste(const char* text, unsigned int len, result& result, const context& context) override;
     virtual void    on_terminal_resize(int columns, int rows, const context& context) override;
     void            done(const char* line);
     char*           m_rl_buffer;
@@ -48,5 +49,6 @@ private:
     str<16>         m_command_color;
     str<16>         m_alias_color;
     str<16>         m_filtered_color;
+    str<16>         m_suggestion_color;
     int             m_insert_next_len = 0;
 };
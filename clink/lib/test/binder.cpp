@@ -6,6 +6,11 @@
 #include "binder.h"
 #include "editor_module.h"
 
+#include <core/str.h>
+
+#include <string>
+#include <vector>
+
 //------------------------------------------------------------------------------
 TEST_CASE("Binder")
 {
@@ -30,36 +35,107 @@ TEST_CASE("Binder")
         REQUIRE(binder.get_group("group2") == groups[1]);
     }
 
-    SECTION("Overflow : group")
+    SECTION("Growth : group")
     {
-        for (int i = 1; i < 256; ++i)
-            REQUIRE(binder.create_group("group") == (i * 2) + 1);
+        int last = -1;
+        for (int i = 0; i < 1000; ++i)
+        {
+            str<16> name;
+            name.format("group%d", i);
+            REQUIRE((last = binder.create_group(name.c_str())) != -1);
+        }
 
-        REQUIRE(binder.create_group("group") == -1);
+        REQUIRE(binder.get_group("group999") == last);
+        REQUIRE(binder.bind(last, "abc", *(editor_module*)0, 1));
     }
 
-    SECTION("Overflow : module")
+    SECTION("Growth : module")
     {
         int group = binder.get_group();
-        for (int i = 0; i < 64; ++i)
+        for (int i = 0; i < 300; ++i)
             REQUIRE(binder.bind(group, "", ((editor_module*)0)[i], char(i)));
 
-        auto& module = ((editor_module*)0)[0xff];
-        REQUIRE(!binder.bind(group, "", module, 0xff));
+        // Binding the same module and id again doesn't grow anything.
+        REQUIRE(binder.bind(group, "", ((editor_module*)0)[5], 5));
     }
 
-    SECTION("Overflow : bind")
+    SECTION("Growth : bind")
     {
-        auto& null_module = *(editor_module*)0;
         int default_group = binder.get_group();
 
-        for (int i = 0; i < 508; ++i)
+        // Enough distinct chords that the nodes sharing a prefix have dense
+        // child tables.
+        for (int i = 0; i < 5000; ++i)
         {
-            char chord[] = { char((i > 0xff) + 1), char((i % 0xfe) + 1), 0 };
-            REQUIRE(binder.bind(default_group, chord, null_module, 0x12));
+            char chord[] = { char((i >> 8) + 1), char((i & 0xff) | 0x01), 'x', 0 };
+            auto& module = ((editor_module*)0)[i & 0x7f];
+            REQUIRE(binder.bind(default_group, chord, module, (unsigned char)i));
         }
 
-        REQUIRE(!binder.bind(default_group, "\x01\x02\x03", null_module, 0x12));
+        for (int i = 0; i < 5000; ++i)
+        {
+            char chord[] = { char((i >> 8) + 1), char((i & 0xff) | 0x01), 'x', 0 };
+            REQUIRE(binder.is_bound(default_group, chord, 3));
+
+            bind_resolver resolver(binder);
+            REQUIRE(!resolver.step(chord[0]));
+            REQUIRE(!resolver.step(chord[1]));
+            REQUIRE(resolver.step(chord[2]));
+
+            // Chords that differ only in the low bit map onto the same nodes;
+            // the first bind of each wins.
+            int first = i & ~1;
+            auto binding = resolver.next();
+            REQUIRE(binding);
+            REQUIRE(binding.get_id() == (unsigned char)first);
+            REQUIRE(binding.get_module() == &((editor_module*)0)[first & 0x7f]);
+        }
+    }
+
+    SECTION("Dense")
+    {
+        // A typical keymap; ESC and "ESC [" have more than enough children to
+        // be indexed directly.
+        const char* chords[] = {
+            "\\e[A",    "\\e[B",    "\\e[C",    "\\e[D",
+            "\\e[H",    "\\e[F",    "\\e[2~",   "\\e[3~",
+            "\\e[5~",   "\\e[6~",   "\\e[1;5A", "\\e[1;5B",
+            "\\e[1;5C", "\\e[1;5D", "\\e[1;2H", "\\e[1;2F",
+            "\\eOP",    "\\eOQ",    "\\eOR",    "\\eOS",
+            "\\M-a",    "\\M-b",    "\\M-d",    "\\M-f",
+            "\\M-C-d",  "\\M-C-e",  "^a",       "^b",
+            "^e",       "^k",       "^r",       "^u",
+        };
+
+        int group = binder.get_group();
+        for (int i = 0; i < sizeof_array(chords); ++i)
+            REQUIRE(binder.bind(group, chords[i], ((editor_module*)0)[i], i));
+
+        const char* inputs[] = {
+            "\x1b[A",    "\x1b[B",    "\x1b[C",    "\x1b[D",
+            "\x1b[H",    "\x1b[F",    "\x1b[2~",   "\x1b[3~",
+            "\x1b[5~",   "\x1b[6~",   "\x1b[1;5A", "\x1b[1;5B",
+            "\x1b[1;5C", "\x1b[1;5D", "\x1b[1;2H", "\x1b[1;2F",
+            "\x1bOP",    "\x1bOQ",    "\x1bOR",    "\x1bOS",
+            "\x1b" "a",  "\x1b" "b",  "\x1b" "d",  "\x1b" "f",
+            "\x1b\x04",  "\x1b\x05",  "\x01",      "\x02",
+            "\x05",      "\x0b",      "\x12",      "\x15",
+        };
+
+        bind_resolver resolver(binder);
+        for (int i = 0; i < sizeof_array(inputs); ++i)
+        {
+            for (const char* c = inputs[i]; *c; ++c)
+                if (resolver.step(*c))
+                    break;
+
+            auto binding = resolver.next();
+            REQUIRE(binding);
+            REQUIRE(binding.get_id() == i);
+            REQUIRE(binding.get_module() == &((editor_module*)0)[i]);
+            binding.claim();
+            REQUIRE(!resolver.next());
+        }
     }
 
     SECTION("Valid chords")
@@ -117,3 +193,108 @@ TEST_CASE("Binder")
         }
     }
 }
+
+//------------------------------------------------------------------------------
+// Finds keys by walking each node's list of children, as the binder did
+// before dense nodes had tables.
+struct reference_trie
+{
+    struct node
+    {
+        int                 next;
+        int                 child;
+        unsigned char       key;
+    };
+
+    void add(const char* chord)
+    {
+        int parent = 0;
+        for (; *chord; ++chord)
+        {
+            int child = find(parent, *chord);
+            if (!child)
+            {
+                child = int(nodes.size());
+                nodes.push_back({ 0, 0, (unsigned char)*chord });
+
+                int* link = &nodes[parent].child;
+                while (*link)
+                    link = &nodes[*link].next;
+                *link = child;
+            }
+
+            parent = child;
+        }
+    }
+
+    int find(int parent, unsigned char key) const
+    {
+        for (int index = nodes[parent].child; index; index = nodes[index].next)
+            if (nodes[index].key == key)
+                return index;
+
+        return 0;
+    }
+
+    std::vector<node>       nodes = { {} };
+};
+
+//------------------------------------------------------------------------------
+BENCHMARK("Binder resolve")
+{
+    // Roughly Readline's emacs keymap; text, control keys, Meta keys, and the
+    // ESC sequences terminals send for cursor and function keys.
+    std::vector<std::string> chords;
+    for (char c = 0x20; c < 0x7f; ++c)
+        chords.push_back(std::string(1, c));
+    for (char c = 1; c < 0x1b; ++c)
+        chords.push_back(std::string(1, c));
+    for (char c = 'a'; c <= 'z'; ++c)
+        chords.push_back(std::string("\x1b") + c);
+    for (const char* seq : { "A", "B", "C", "D", "H", "F", "1;5C", "1;5D",
+                             "1;5A", "1;5B", "2~", "3~", "5~", "6~", "15~", "17~" })
+        chords.push_back(std::string("\x1b[") + seq);
+    for (const char* seq : { "P", "Q", "R", "S" })
+        chords.push_back(std::string("\x1bO") + seq);
+
+    binder binder;
+    reference_trie reference;
+    int group = binder.get_group();
+    for (unsigned int i = 0; i < chords.size(); ++i)
+    {
+        REQUIRE(binder.bind(group, chords[i].c_str(), *(editor_module*)0, (unsigned char)i));
+        reference.add(chords[i].c_str());
+    }
+
+    static const int repeats = 2000;
+    clatch::timer timer;
+
+    int found = 0;
+    for (int r = 0; r < repeats; ++r)
+    {
+        for (const auto& chord : chords)
+        {
+            int node = 0;
+            for (const char* c = chord.c_str(); *c && (node = reference.find(node, *c)); ++c);
+            found += !!node;
+        }
+    }
+    timer.report("Resolve chords (child lists)");
+
+    bind_resolver resolver(binder);
+    for (int r = 0; r < repeats; ++r)
+    {
+        for (const auto& chord : chords)
+        {
+            for (const char* c = chord.c_str(); *c; ++c)
+                if (resolver.step(*c))
+                    break;
+
+            found -= !!resolver.next();
+            resolver.reset();
+        }
+    }
+    timer.report("Resolve chords (bind_resolver)");
+
+    REQUIRE(found == 0);
+}
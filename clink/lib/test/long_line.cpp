@@ -0,0 +1,58 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "fs_fixture.h"
+#include "line_editor_tester.h"
+
+#include <core/str.h>
+#include <lib/match_generator.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Long lines")
+{
+    static const char* long_fs[] = {
+        "prefix_one",
+        "prefix_two",
+        "other",
+        nullptr,
+    };
+
+    fs_fixture fs(long_fs);
+
+    // Longer than 64K so 16 bit offsets would wrap.
+    str<> line;
+    while (line.length() < 70000)
+        line << "0123456789";
+    line << " ";
+
+    line_editor_tester tester;
+    tester.get_editor()->add_generator(file_match_generator());
+
+    SECTION("Editing")
+    {
+        str<> input;
+        input << line << "\x01" "x"; // Ctrl-A is beginning-of-line.
+
+        str<> expected;
+        expected << "x" << line;
+
+        tester.set_input(input.c_str());
+        tester.set_expected_output(expected.c_str());
+        tester.run();
+    }
+
+    SECTION("Completion")
+    {
+        str<> input;
+        input << line << "pre" DO_COMPLETE;
+
+        str<> expected;
+        expected << line << "prefix_";
+
+        tester.set_input(input.c_str());
+        tester.set_expected_matches("prefix_one", "prefix_two");
+        tester.set_expected_output(expected.c_str());
+        tester.run();
+    }
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "matches_impl.h"
+#include "match_pipeline.h"
+
+#include <core/str_compare.h>
+
+#include <string.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("matches : pinned store")
+{
+    matches_impl matches(nullptr, 4096);
+    match_builder builder(matches);
+
+    builder.add_match("abc", match_type::file);
+    builder.add_match("abd", match_type::dir);
+
+    matches_iter iter = matches.get_iter();
+    REQUIRE(iter.next());
+
+    // Matches are stored in the form Readline wants them.
+    char* pinned = matches_impl::pin_match(iter.get_match());
+    REQUIRE(pinned != nullptr);
+    REQUIRE(pinned[0] == char(match_type::file));
+    REQUIRE(strcmp(pinned + 1, "abc") == 0);
+
+    REQUIRE(iter.next());
+    REQUIRE(iter.get_match()[-1] == char(match_type::dir));
+
+    SECTION("Reset")
+    {
+        // A pinned page must not be reused when the store is reset.
+        match_pipeline(matches).reset();
+        for (int i = 0; i < 1000; ++i)
+            builder.add_match("xyzzy", match_type::word);
+
+        REQUIRE(strcmp(pinned + 1, "abc") == 0);
+        REQUIRE(matches_impl::release_match(pinned));
+    }
+
+    SECTION("Release")
+    {
+        REQUIRE(matches_impl::release_match(pinned));
+        REQUIRE(!matches_impl::release_match(pinned));
+
+        // Readline frees its own strings through release_match() too.
+        char local[] = "\x01" "abc";
+        REQUIRE(!matches_impl::release_match(local));
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("matches : incremental select")
+{
+    matches_impl matches;
+    match_builder builder(matches);
+
+    static const char* const words[] = { "abc", "abd", "abcd", "xyz", "ABCE" };
+    for (const char* word : words)
+        builder.add_match(word, match_type::word);
+
+    str_compare_scope _(str_compare_scope::caseless);
+
+    match_pipeline pipeline(matches);
+    auto select = [&] (const char* needle) {
+        pipeline.select(needle);
+        return matches.get_match_count();
+    };
+
+    REQUIRE(select("") == 5);
+    REQUIRE(select("a") == 4);
+    REQUIRE(select("ab") == 4);
+    REQUIRE(select("abc") == 3);
+    REQUIRE(select("abcd") == 1);
+    {
+        matches_iter iter = matches.get_iter();
+        REQUIRE(iter.next());
+        REQUIRE(strcmp(iter.get_match(), "abcd") == 0);
+        REQUIRE(!iter.next());
+    }
+
+    // Shrinking the needle restores what the shorter needle selected.
+    REQUIRE(select("ab") == 4);
+    REQUIRE(select("abx") == 0);
+    REQUIRE(select("x") == 1);
+    REQUIRE(select("abce") == 1);
+    REQUIRE(select("") == 5);
+
+    SECTION("Mode")
+    {
+        REQUIRE(select("abc") == 3);
+
+        str_compare_scope _(str_compare_scope::exact);
+        REQUIRE(select("abc") == 2);
+        REQUIRE(select("ab") == 3);
+    }
+}
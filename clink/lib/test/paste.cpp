@@ -0,0 +1,93 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "line_editor_tester.h"
+#include "console_in_tester.h"
+
+#include <core/str.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Paste")
+{
+    line_editor_tester tester;
+
+    SECTION("Bulk")
+    {
+        str<> input;
+        for (int i = 0; i < 500; ++i)
+            input << "echo 12345";
+
+        tester.set_input(input.c_str());
+        tester.set_expected_output(input.c_str());
+        tester.run();
+    }
+
+    SECTION("UTF-8")
+    {
+        tester.set_input("a\xc3\xa9\xe2\x82\xac" "b");
+        tester.set_expected_output("a\xc3\xa9\xe2\x82\xac" "b");
+        tester.run();
+    }
+
+    SECTION("Bound keys")
+    {
+        // Ctrl-A is beginning-of-line; text either side of it is inserted at
+        // the cursor as usual.
+        tester.set_input("abc\x01" "xyz");
+        tester.set_expected_output("xyzabc");
+        tester.run();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Paste : console")
+{
+    // Bracketed pastes are found by the console input decoder.
+    test_console_in console;
+    line_editor_tester tester(console);
+
+    SECTION("Bracketed")
+    {
+        // Tabs don't complete and line breaks don't accept the line.
+        tester.set_input("abc \x1b[200~x\ty\r\nz\x1b[201~!");
+        tester.set_expected_output("abc x\ty z!");
+        tester.run();
+    }
+
+    SECTION("Bracketed undo")
+    {
+        tester.set_input("abc \x1b[200~def ghi\x1b[201~\x1f");
+        tester.set_expected_output("abc ");
+        tester.run();
+    }
+}
+
+//------------------------------------------------------------------------------
+BENCHMARK("Paste")
+{
+    str<> input;
+    for (int i = 0; i < 500; ++i)
+        input << "echo 12345";
+
+    {
+        line_editor_tester tester;
+        tester.set_input(input.c_str());
+        tester.set_expected_output(input.c_str());
+
+        clatch::timer timer;
+        tester.run();
+        timer.report("5000 chars as bytes");
+    }
+
+    {
+        test_console_in console;
+        line_editor_tester tester(console);
+        tester.set_input(input.c_str());
+        tester.set_expected_output(input.c_str());
+
+        clatch::timer timer;
+        tester.run();
+        timer.report("5000 chars as console records");
+    }
+}
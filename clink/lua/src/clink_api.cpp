@@ -26,6 +26,40 @@
 //  / This is similar to <code>print()</code>, but this supports ANSI escape
 //  / codes.
 
+//------------------------------------------------------------------------------
+// Implemented in host.cpp.
+/// -name:  clink.getfrecent
+/// -arg:   kind:string
+/// -arg:   [count:integer]
+/// -ret:   table
+/// -show:  for _, dir in ipairs(clink.getfrecent("dir", 5)) do
+/// -show:  &nbsp; print(dir)
+/// -show:  end
+/// Returns a table of up to <span class="arg">count</span> (default 10)
+/// directories or command lines, most frecent first.  <span
+/// class="arg">kind</span> is <code>"dir"</code> or <code>"command"</code>.
+/// Frecency ranks by how often and how recently each was used, and is shared
+/// between Clink instances; see the <code>history.frecency</code> setting.
+
+//------------------------------------------------------------------------------
+// Implemented in host.cpp.
+/// -name:  clink.getfrecency
+/// -arg:   kind:string
+/// -arg:   name:string
+/// -ret:   integer
+/// Returns the frecency score of a directory or command line, or 0 if it's not
+/// been used.  <span class="arg">kind</span> is <code>"dir"</code> or
+/// <code>"command"</code>; relative directories are relative to the current
+/// directory.
+
+//------------------------------------------------------------------------------
+// Implemented in host.cpp.
+/// -name:  clink.addfrecent
+/// -arg:   kind:string
+/// -arg:   name:string
+/// Records a use of a directory or command line, for when a script changes
+/// directory or runs a command on the user's behalf.
+
 //------------------------------------------------------------------------------
 /// -name:  clink.version_encoded
 /// -var:   integer
@@ -276,6 +310,9 @@ extern int get_env_names(lua_State* state);
 extern int get_screen_info(lua_State* state);
 extern int is_dir(lua_State* state);
 extern int clink_print(lua_State* state);
+extern int get_frecent(lua_State* state);
+extern int get_frecency(lua_State* state);
+extern int add_frecent(lua_State* state);
 
 //------------------------------------------------------------------------------
 void clink_lua_initialise(lua_state& lua)
@@ -285,6 +322,9 @@ void clink_lua_initialise(lua_state& lua)
         int         (*method)(lua_State*);
     } methods[] = {
         // APIs in the "clink." namespace.
+        { "addfrecent",             &add_frecent },
+        { "getfrecency",            &get_frecency },
+        { "getfrecent",             &get_frecent },
         { "lower",                  &to_lowercase },
         { "print",                  &clink_print },
         { "upper",                  &to_uppercase },
@@ -9,6 +9,7 @@
 #include "line_state_lua.h"
 #include "match_builder_lua.h"
 
+#include <core/arena.h>
 #include <lib/line_state.h>
 #include <lib/matches.h>
 #include <terminal/ecma48_iter.h>
@@ -293,9 +294,9 @@ bool lua_match_generator::match_display_filter(char** matches, match_display_fil
     int max_visible_display = 0;
     int max_visible_description = 0;
     int new_len = int(lua_rawlen(state, -1));
-    new_matches = (match_display_filter_entry**)calloc(1 + new_len + 1, sizeof(*new_matches));
-    new_matches[0] = (match_display_filter_entry*)malloc(sizeof(match_display_filter_entry));
-    memset(new_matches[0], 0, sizeof(new_matches[0]));
+    arena* store;
+    new_matches = new_filtered_match_list(new_len, store);
+    new_matches[0] = store->calloc<match_display_filter_entry>();
     new_matches[0]->display = new_matches[0]->buffer;
     for (i = 1; i <= new_len; ++i)
     {
@@ -350,8 +351,9 @@ bool lua_match_generator::match_display_filter(char** matches, match_display_fil
                 if (display) alloc_size += strlen(display);
                 if (description) alloc_size += strlen(description);
 
+                arena::mark mark = store->get_mark();
                 match_display_filter_entry *new_match;
-                new_match = (match_display_filter_entry *)malloc(alloc_size);
+                new_match = (match_display_filter_entry *)store->alloc(unsigned(alloc_size), alignof(match_display_filter_entry));
                 memset(new_match, 0, sizeof(*new_match));
                 new_match->type = (unsigned char)type;
                 new_matches[j] = new_match;
@@ -363,8 +365,9 @@ bool lua_match_generator::match_display_filter(char** matches, match_display_fil
                 if (match && !new_match->match[0])
                 {
 discard:
-                    free(new_match);
+                    store->rewind(mark);
                     j--;
+                    break;
                 }
 
                 if (!display[0])
@@ -5,6 +5,7 @@
 #include "lua_state.h"
 #include "lua_script_loader.h"
 
+#include <core/log.h>
 #include <core/settings.h>
 #include <core/os.h>
 
@@ -183,6 +184,8 @@ bool lua_state::do_file(const char* path)
 //------------------------------------------------------------------------------
 int lua_state::pcall(lua_State* L, int nargs, int nresults)
 {
+    TRACE_SCOPE("lua");
+
     // Calculate stack position for message handler.
     int hpos = lua_gettop(L) - nargs;
 
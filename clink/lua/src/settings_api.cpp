@@ -47,10 +47,31 @@ static int get(lua_State* state)
         }
         break;
 
+    // Strings and enums are pushed straight from the setting's stored value;
+    // generators can call this a lot.
+    case setting::type_string:
+        lua_pushstring(state, ((const setting_str*)setting)->get());
+        break;
+
+    case setting::type_enum:
+        {
+            int length = 0;
+            const char* option = ((const setting_enum*)setting)->get_option(length);
+            lua_pushlstring(state, option ? option : "", length);
+        }
+        break;
+
     default:
         {
+            bool descriptive = (lua_isboolean(state, 2) && lua_toboolean(state, 2));
+            if (type == setting::type_color && !descriptive)
+            {
+                lua_pushstring(state, ((const setting_color*)setting)->get());
+                break;
+            }
+
             str<> value;
-            if (lua_isboolean(state, 2) && lua_toboolean(state, 2))
+            if (descriptive)
                 setting->get_descriptive(value);
             else
                 setting->get(value);
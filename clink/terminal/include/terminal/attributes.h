@@ -68,6 +68,8 @@ public:
                                 attributes(default_e);
     bool                        operator == (const attributes rhs);
     bool                        operator != (const attributes rhs) { return !(*this == rhs); }
+    bool                        is_identical(const attributes rhs) const { return m_state == rhs.m_state; }
+    unsigned int                get_hash() const;
     static attributes           merge(const attributes first, const attributes second);
     static attributes           diff(const attributes from, const attributes to);
     void                        reset_fg();
@@ -14,6 +14,13 @@ void set_scrolled_screen_buffer();
 class printer
 {
 public:
+    struct sgr_stats
+    {
+        unsigned int        bytes_in;       // SGR bytes handed to the printer.
+        unsigned int        bytes_out;      // SGR bytes written to the terminal.
+        unsigned int        cache_hits;
+    };
+
                             printer(terminal_out& terminal);
     void                    reset();
     void                    print(const char* data, int bytes);
@@ -26,6 +33,7 @@ public:
     unsigned int            get_rows() const;
     attributes              set_attributes(const attributes attr);
     attributes              get_attributes() const;
+    const sgr_stats&        get_sgr_stats() const;
 
 private: /* TODO: unimplemented API */
     typedef unsigned int    cursor_state;
@@ -35,11 +43,27 @@ private: /* TODO: unimplemented API */
     cursor_state            get_cursor() const;
 
 private:
+    enum { sgr_cache_size = 16 };
+
+    struct sgr_cache_entry
+    {
+        attributes          diff;
+        bool                full;
+        unsigned char       length;
+        char                seq[22];
+    };
+
+    bool                    apply_sgr(const char* params, int length);
+    void                    write(const char* data, int bytes);
+    void                    flush_pending();
     void                    flush_attributes();
     terminal_out&           m_terminal;
     attributes              m_set_attr;
     attributes              m_next_attr;
-    bool                    m_nodiff;
+    sgr_cache_entry         m_sgr_cache[sgr_cache_size];
+    sgr_stats               m_sgr_stats;
+    bool                    m_nodiff;       // Terminal's SGR state is unknown.
+    bool                    m_sgr_pending;
 };
 
 //------------------------------------------------------------------------------
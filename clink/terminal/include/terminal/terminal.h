@@ -22,3 +22,4 @@ void                terminal_destroy(const terminal& terminal);
 
 //------------------------------------------------------------------------------
 const char*         find_key_name(const char* keyseq, int& len, int& eqclass, int& order);
+const char*         find_key_sequence(const char* name);
@@ -4,6 +4,7 @@
 #pragma once
 
 class key_tester;
+class str_base;
 
 //------------------------------------------------------------------------------
 class terminal_in
@@ -14,12 +15,16 @@ public:
         input_timeout,
         input_abort,
         input_terminal_resize,
+        input_paste,
     };
 
     virtual         ~terminal_in() = default;
     virtual void    begin() = 0;
     virtual void    end() = 0;
+    virtual void    flush() {}
     virtual void    select() = 0;
     virtual int     read() = 0;
+    virtual int     peek() { return input_none; }
+    virtual bool    get_paste(str_base& out) { return false; }
     virtual key_tester* set_key_tester(key_tester* keys) = 0;
 };
@@ -55,6 +55,16 @@ bool attributes::operator == (const attributes rhs)
     return (cmp != 0);
 }
 
+//------------------------------------------------------------------------------
+unsigned int attributes::get_hash() const
+{
+    unsigned long long x = m_state;
+    x ^= x >> 29;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 32;
+    return (unsigned int)x;
+}
+
 //------------------------------------------------------------------------------
 attributes attributes::merge(const attributes first, const attributes second)
 {
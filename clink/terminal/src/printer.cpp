@@ -5,6 +5,7 @@
 #include "printer.h"
 #include "terminal_out.h"
 
+#include <core/base.h>
 #include <core/str.h>
 
 //------------------------------------------------------------------------------
@@ -19,17 +20,25 @@ void set_scrolled_screen_buffer()
 //------------------------------------------------------------------------------
 printer::printer(terminal_out& terminal)
 : m_terminal(terminal)
-, m_nodiff(false)
+, m_nodiff(true)
+, m_sgr_pending(false)
 {
+    for (auto& entry : m_sgr_cache)
+        entry.length = 0;
+
+    memset(&m_sgr_stats, 0, sizeof(m_sgr_stats));
     reset();
 }
 
 //------------------------------------------------------------------------------
 void printer::reset()
 {
+    // Something other than the printer may have written to the terminal since
+    // it was last used, so what attributes it currently has are unknown.
     m_set_attr = attributes::defaults;
     m_next_attr = attributes::defaults;
-    m_nodiff = false;
+    m_nodiff = true;
+    m_sgr_pending = false;
 }
 
 //------------------------------------------------------------------------------
@@ -38,21 +47,73 @@ void printer::print(const char* data, int bytes)
     if (bytes <= 0)
         return;
 
-    if (m_next_attr != m_set_attr)
-        flush_attributes();
-
-    // HACK: Work around a problem where WriteConsoleW(" ") after using
-    // ScrollConsoleRelative() to scroll the cursor line past the bottom of the
-    // screen window clears screen attributes from the prompt (but not if
-    // scrolled the other direction, and not if the scrollbar was used to scroll
-    // the screen buffer!?).
-    if (s_is_scrolled)
+    // SGR sequences in the data are folded into the pending attributes instead
+    // of being written verbatim.  Only the net change gets written, and only
+    // when there's something else to print.  Readline resets and re-sets the
+    // colour around every match it lists, so this saves a lot of output.
+    bool consumed_sgr = false;
+    const char* end = data + bytes;
+    const char* run = data;
+    for (const char* walk = data; walk < end;)
     {
-        m_terminal.flush();
-        s_is_scrolled = false;
+        walk = (const char*)memchr(walk, 0x1b, end - walk);
+        if (walk == nullptr)
+            break;
+
+        // A sequence split across calls can't be inspected.  It passes through
+        // untouched, but afterwards the terminal's state can't be trusted.
+        if (end - walk < 2)
+        {
+            m_nodiff = true;
+            break;
+        }
+
+        if (walk[1] != '[')
+        {
+            ++walk;
+            continue;
+        }
+
+        const char* params = walk + 2;
+        const char* final = params;
+        while (final < end && ((*final >= '0' && *final <= '9') || *final == ';'))
+            ++final;
+
+        if (final >= end)
+        {
+            m_nodiff = true;
+            break;
+        }
+
+        if (*final != 'm')
+        {
+            walk = final;
+            continue;
+        }
+
+        write(run, int(walk - run));
+
+        int sgr_length = int(final + 1 - walk);
+        m_sgr_stats.bytes_in += sgr_length;
+        if (apply_sgr(params, int(final - params)))
+        {
+            consumed_sgr = true;
+        }
+        else
+        {
+            flush_pending();
+            m_terminal.write(walk, sgr_length);
+            m_sgr_stats.bytes_out += sgr_length;
+            m_nodiff = true;
+        }
+
+        walk = run = final + 1;
     }
 
-    m_terminal.write(data, bytes);
+    write(run, int(end - run));
+
+    if (consumed_sgr)
+        flush_pending();
 }
 
 //------------------------------------------------------------------------------
@@ -66,14 +127,30 @@ void printer::print(const attributes attr, const char* data, int bytes)
 //------------------------------------------------------------------------------
 void printer::print(const char* attr, const char* data, int bytes)
 {
+    attributes prev_attr = m_next_attr;
+
+    int attr_length = int(strlen(attr));
+    m_sgr_stats.bytes_in += attr_length + 3;
+    if (apply_sgr(attr, attr_length))
+    {
+        print(data, bytes);
+        set_attributes(prev_attr);
+        return;
+    }
+
+    // The attributes can't be tracked, so emit them verbatim and restore the
+    // previous state in full before anything else is printed.
     str<> tmp;
-    tmp.format("\x1b[%sm", attr);
+    tmp << "\x1b[" << attr << "m";
+
+    flush_pending();
+    m_terminal.write(tmp.c_str(), tmp.length());
+    m_sgr_stats.bytes_out += tmp.length();
 
-    attributes prev_attr = m_next_attr;
-    print(tmp.c_str(), tmp.length());
     print(data, bytes);
     set_attributes(prev_attr);
     m_nodiff = true;
+    m_sgr_pending = true;
 }
 
 //------------------------------------------------------------------------------
@@ -97,26 +174,122 @@ attributes printer::set_attributes(const attributes attr)
 }
 
 //------------------------------------------------------------------------------
-void printer::flush_attributes()
+bool printer::apply_sgr(const char* params, int length)
 {
-    attributes diff = m_nodiff ? m_next_attr : attributes::diff(m_set_attr, m_next_attr);
+    // Only codes that flush_attributes() can reproduce are accepted.  Anything
+    // else leaves the state untouched so the caller can write it verbatim.
+    attributes attr = m_next_attr;
+    const char* end = params + length;
+    unsigned int param = 0;
+    for (const char* walk = params;; ++walk)
+    {
+        if (walk < end && *walk != ';')
+        {
+            if (*walk < '0' || *walk > '9')
+                return false;
 
-    str<64, false> params;
-    auto add_param = [&] (const char* x) {
-        if (!params.empty())
-            params << ";";
-        params << x;
-    };
+            param = (param * 10) + (*walk - '0');
+            if (param > 255)
+                return false;
+
+            continue;
+        }
+
+        // Empty parameters imply 0 (reset).
+        if (param == 0)                     attr = attributes::defaults;
+        else if (param == 1)                attr.set_bold(true);
+        else if (param == 22)               attr.set_bold(false);
+        else if (param == 4)                attr.set_underline(true);
+        else if (param == 24)               attr.set_underline(false);
+        else if (param == 7)                attr.set_reverse(true);
+        else if (param == 27)               attr.set_reverse(false);
+        else if (param == 39)               attr.reset_fg();
+        else if (param == 49)               attr.reset_bg();
+        else if (param - 30 < 8)            attr.set_fg(param - 30);
+        else if (param - 90 < 8)            attr.set_fg(param - 90 + 8);
+        else if (param - 40 < 8)            attr.set_bg(param - 40);
+        else if (param - 100 < 8)           attr.set_bg(param - 100 + 8);
+        else                                return false;
+
+        if (walk >= end)
+            break;
 
-    auto fg = diff.get_fg();
-    auto bg = diff.get_bg();
-    if (fg.is_default & bg.is_default)
+        param = 0;
+    }
+
+    m_next_attr = attr;
+    m_sgr_pending = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void printer::write(const char* data, int bytes)
+{
+    if (bytes <= 0)
+        return;
+
+    // Spaces look the same whatever the foreground colour or boldness, so a
+    // change to only those can wait until there's something visible to print.
+    bool defer = !m_nodiff;
+    for (int i = 0; defer && i < bytes; ++i)
+        defer = (data[i] == ' ');
+
+    if (defer)
+    {
+        attributes diff = attributes::diff(m_set_attr, m_next_attr);
+        defer = !diff.get_bg() && !diff.get_underline() && !diff.get_reverse();
+    }
+
+    if (!defer)
+        flush_pending();
+
+    // HACK: Work around a problem where WriteConsoleW(" ") after using
+    // ScrollConsoleRelative() to scroll the cursor line past the bottom of the
+    // screen window clears screen attributes from the prompt (but not if
+    // scrolled the other direction, and not if the scrollbar was used to scroll
+    // the screen buffer!?).
+    if (s_is_scrolled)
+    {
+        m_terminal.flush();
+        s_is_scrolled = false;
+    }
+
+    m_terminal.write(data, bytes);
+}
+
+//------------------------------------------------------------------------------
+void printer::flush_pending()
+{
+    if ((m_nodiff && m_sgr_pending) || m_next_attr != m_set_attr)
+        flush_attributes();
+}
+
+//------------------------------------------------------------------------------
+void printer::flush_attributes()
+{
+    // When the terminal's state is unknown everything is reset and then only
+    // the attributes that differ from the defaults are set.
+    bool full = m_nodiff;
+    attributes diff = attributes::diff(full ? attributes::defaults : m_set_attr, m_next_attr);
+
+    sgr_cache_entry& entry = m_sgr_cache[(diff.get_hash() ^ full) & (sgr_cache_size - 1)];
+    if (entry.length && entry.full == full && entry.diff.is_identical(diff))
     {
-        add_param("0");
+        ++m_sgr_stats.cache_hits;
     }
     else
     {
-        if (fg)
+        str<32, false> params;
+        auto add_param = [&] (const char* x) {
+            if (!params.empty())
+                params << ";";
+            params << x;
+        };
+
+        if (full)
+            add_param("0");
+
+        if (auto fg = diff.get_fg())
         {
             if (!fg.is_default)
             {
@@ -129,7 +302,7 @@ void printer::flush_attributes()
                 add_param("39");
         }
 
-        if (bg)
+        if (auto bg = diff.get_bg())
         {
             if (!bg.is_default)
             {
@@ -141,22 +314,35 @@ void printer::flush_attributes()
             else
                 add_param("49");
         }
-    }
 
-    if (auto bold = diff.get_bold())
-        add_param(bold.value ? "1" : "22");
+        if (auto bold = diff.get_bold())
+            add_param(bold.value ? "1" : "22");
+
+        if (auto underline = diff.get_underline())
+            add_param(underline.value ? "4" : "24");
+
+        if (auto reverse = diff.get_reverse())
+            add_param(reverse.value ? "7" : "27");
+
+        str_base seq(entry.seq, sizeof_array(entry.seq));
+        seq.clear();
+        if (!params.empty())
+            seq << "\x1b[" << params << "m";
 
-    if (auto underline = diff.get_underline())
-        add_param(underline.value ? "4" : "24");
+        entry.diff = diff;
+        entry.full = full;
+        entry.length = (unsigned char)seq.length();
+    }
 
-    if (!params.empty())
+    if (entry.length)
     {
-        m_terminal.write("\x1b[");
-        m_terminal.write(params.c_str(), params.length());
-        m_terminal.write("m");
+        m_terminal.write(entry.seq, entry.length);
+        m_sgr_stats.bytes_out += entry.length;
     }
 
     m_set_attr = m_next_attr;
+    m_nodiff = false;
+    m_sgr_pending = false;
 }
 
 //------------------------------------------------------------------------------
@@ -165,6 +351,12 @@ attributes printer::get_attributes() const
     return m_next_attr;
 }
 
+//------------------------------------------------------------------------------
+const printer::sgr_stats& printer::get_sgr_stats() const
+{
+    return m_sgr_stats;
+}
+
 //------------------------------------------------------------------------------
 void printer::insert(int count)
 {
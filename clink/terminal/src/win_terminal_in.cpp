@@ -6,12 +6,12 @@
 #include "key_tester.h"
 
 #include <core/base.h>
+#include <core/perfect_hash.h>
 #include <core/str.h>
 #include <core/settings.h>
 
 #include <Windows.h>
 #include <assert.h>
-#include <map>
 
 //------------------------------------------------------------------------------
 extern bool is_scroll_mode();
@@ -35,20 +35,21 @@ static const int ALT_PRESSED = LEFT_ALT_PRESSED|RIGHT_ALT_PRESSED;
 #define SS3(x) "\x1bO" #x
 #define ACSI(x) "\x1b\x1b[" #x
 #define ASS3(x) "\x1b\x1bO" #x
-namespace terminfo { //                       Shf        Ctl        CtlShf     Alt        AtlShf     AltCtl     AltCtlShf
-static const char* const kcuu1[] = { CSI(A),  CSI(1;2A), CSI(1;5A), CSI(1;6A), CSI(1;3A), CSI(1;4A), CSI(1;7A), CSI(1;8A) }; // up
-static const char* const kcud1[] = { CSI(B),  CSI(1;2B), CSI(1;5B), CSI(1;6B), CSI(1;3B), CSI(1;4B), CSI(1;7B), CSI(1;8B) }; // down
-static const char* const kcub1[] = { CSI(D),  CSI(1;2D), CSI(1;5D), CSI(1;6D), CSI(1;3D), CSI(1;4D), CSI(1;7D), CSI(1;8D) }; // left
-static const char* const kcuf1[] = { CSI(C),  CSI(1;2C), CSI(1;5C), CSI(1;6C), CSI(1;3C), CSI(1;4C), CSI(1;7C), CSI(1;8C) }; // right
-static const char* const kich1[] = { CSI(2~), CSI(2;2~), CSI(2;5~), CSI(2;6~), CSI(2;3~), CSI(2;4~), CSI(2;7~), CSI(2;8~) }; // insert
-static const char* const kdch1[] = { CSI(3~), CSI(3;2~), CSI(3;5~), CSI(3;6~), CSI(3;3~), CSI(3;4~), CSI(3;7~), CSI(3;8~) }; // delete
-static const char* const khome[] = { CSI(H),  CSI(1;2H), CSI(1;5H), CSI(1;6H), CSI(1;3H), CSI(1;4H), CSI(1;7H), CSI(1;8H) }; // home
-static const char* const kend[]  = { CSI(F),  CSI(1;2F), CSI(1;5F), CSI(1;6F), CSI(1;3F), CSI(1;4F), CSI(1;7F), CSI(1;8F) }; // end
-static const char* const kpp[]   = { CSI(5~), CSI(5;2~), CSI(5;5~), CSI(5;6~), CSI(5;3~), CSI(5;4~), CSI(5;7~), CSI(5;8~) }; // pgup
-static const char* const knp[]   = { CSI(6~), CSI(6;2~), CSI(6;5~), CSI(6;6~), CSI(6;3~), CSI(6;4~), CSI(6;7~), CSI(6;8~) }; // pgdn
-static const char* const kbks[]  = { "\b",    "",        "\x7f",    "",        "\x1b\b",  "",        "\x1b\x7f", ""       }; // bkspc
-static const char* const kcbt    = CSI(Z);
-static const char* const kfx[]   = {
+namespace terminfo { //                                 Shf        Ctl        CtlShf     Alt        AtlShf     AltCtl     AltCtlShf
+static constexpr const char* const kcuu1[] = { CSI(A),  CSI(1;2A), CSI(1;5A), CSI(1;6A), CSI(1;3A), CSI(1;4A), CSI(1;7A), CSI(1;8A) }; // up
+static constexpr const char* const kcud1[] = { CSI(B),  CSI(1;2B), CSI(1;5B), CSI(1;6B), CSI(1;3B), CSI(1;4B), CSI(1;7B), CSI(1;8B) }; // down
+static constexpr const char* const kcub1[] = { CSI(D),  CSI(1;2D), CSI(1;5D), CSI(1;6D), CSI(1;3D), CSI(1;4D), CSI(1;7D), CSI(1;8D) }; // left
+static constexpr const char* const kcuf1[] = { CSI(C),  CSI(1;2C), CSI(1;5C), CSI(1;6C), CSI(1;3C), CSI(1;4C), CSI(1;7C), CSI(1;8C) }; // right
+static constexpr const char* const kich1[] = { CSI(2~), CSI(2;2~), CSI(2;5~), CSI(2;6~), CSI(2;3~), CSI(2;4~), CSI(2;7~), CSI(2;8~) }; // insert
+static constexpr const char* const kdch1[] = { CSI(3~), CSI(3;2~), CSI(3;5~), CSI(3;6~), CSI(3;3~), CSI(3;4~), CSI(3;7~), CSI(3;8~) }; // delete
+static constexpr const char* const khome[] = { CSI(H),  CSI(1;2H), CSI(1;5H), CSI(1;6H), CSI(1;3H), CSI(1;4H), CSI(1;7H), CSI(1;8H) }; // home
+static constexpr const char* const kend[]  = { CSI(F),  CSI(1;2F), CSI(1;5F), CSI(1;6F), CSI(1;3F), CSI(1;4F), CSI(1;7F), CSI(1;8F) }; // end
+static constexpr const char* const kpp[]   = { CSI(5~), CSI(5;2~), CSI(5;5~), CSI(5;6~), CSI(5;3~), CSI(5;4~), CSI(5;7~), CSI(5;8~) }; // pgup
+static constexpr const char* const knp[]   = { CSI(6~), CSI(6;2~), CSI(6;5~), CSI(6;6~), CSI(6;3~), CSI(6;4~), CSI(6;7~), CSI(6;8~) }; // pgdn
+static constexpr const char* const kbks[]  = { "\b",    "",        "\x7f",    "",        "\x1b\b",  "",        "\x1b\x7f", ""       }; // bkspc
+static constexpr const char* const kcbt    = CSI(Z);
+static constexpr const char* const kesc    = CSI(27;27~); // bindableEsc
+static constexpr const char* const kfx[]   = {
     // kf1-12 : Fx unmodified
     SS3(P),     SS3(Q),     SS3(R),     SS3(S),
     CSI(15~),   CSI(17~),   CSI(18~),   CSI(19~),
@@ -91,9 +92,9 @@ static const char* const kfx[]   = {
 };
 
 #define MOK(x) "\x1b[27;" #x
-//                                            Shf     Ctl         CtlShf      Alt   AtlShf   AltCtl      AltCtlShf
-static const char* const ktab[]  = { "\t",    CSI(Z), MOK(5;9~),  MOK(6;9~),  "",   "",      "",         ""         }; // TAB
-static const char* const kspc[]  = { " ",     " ",    MOK(5;32~), MOK(6;32~), "",   "",      MOK(7;32~), MOK(8;32~) }; // SPC
+//                                                      Shf     Ctl         CtlShf      Alt   AtlShf   AltCtl      AltCtlShf
+static constexpr const char* const ktab[]  = { "\t",    CSI(Z), MOK(5;9~),  MOK(6;9~),  "",   "",      "",         ""         }; // TAB
+static constexpr const char* const kspc[]  = { " ",     " ",    MOK(5;32~), MOK(6;32~), "",   "",      MOK(7;32~), MOK(8;32~) }; // SPC
 
 #if 0
 static int xterm_modifier(int key_flags)
@@ -128,152 +129,110 @@ inline bool is_lead_surrogate(unsigned int ch) { return IN_RANGE(0xD800, ch, 0xD
 
 
 //------------------------------------------------------------------------------
-struct keyseq_name : public no_copy
+struct keyseq_name
 {
-    keyseq_name(char* p, short int eqclass, short int order) { s = p; eq = eqclass; o = order; }
-    keyseq_name(keyseq_name&& a) { s = a.s; eq = a.eq; o = a.o; a.s = nullptr; }
-    ~keyseq_name() { free(s); }
-    keyseq_name& operator=(keyseq_name&& a) { s = a.s; eq = a.eq; o = a.o; a.s = nullptr; }
+    const char* seq;
+    const char* name;
+    int         eqclass;
+};
 
-    char* s;
-    short int eq;
-    short int o;
+#define MODIFIED_KEYS(m, mod) \
+    { terminfo::kcuu1[m], mod "Up",    m }, \
+    { terminfo::kcud1[m], mod "Down",  m }, \
+    { terminfo::kcub1[m], mod "Left",  m }, \
+    { terminfo::kcuf1[m], mod "Right", m }, \
+    { terminfo::khome[m], mod "Home",  m }, \
+    { terminfo::kend[m],  mod "End",   m }, \
+    { terminfo::kpp[m],   mod "PgUp",  m }, \
+    { terminfo::knp[m],   mod "PgDn",  m }, \
+    { terminfo::kich1[m], mod "Ins",   m }, \
+    { terminfo::kdch1[m], mod "Del",   m }, \
+    { terminfo::ktab[m],  mod "Tab",   m }, \
+    { terminfo::kspc[m],  mod "Space", m }, \
+    { terminfo::kbks[m],  mod "Bkspc", m }
+
+#define FUNCTION_KEYS(m, mod) \
+    { terminfo::kfx[(m * 12) + 0],  mod "F1",  m }, \
+    { terminfo::kfx[(m * 12) + 1],  mod "F2",  m }, \
+    { terminfo::kfx[(m * 12) + 2],  mod "F3",  m }, \
+    { terminfo::kfx[(m * 12) + 3],  mod "F4",  m }, \
+    { terminfo::kfx[(m * 12) + 4],  mod "F5",  m }, \
+    { terminfo::kfx[(m * 12) + 5],  mod "F6",  m }, \
+    { terminfo::kfx[(m * 12) + 6],  mod "F7",  m }, \
+    { terminfo::kfx[(m * 12) + 7],  mod "F8",  m }, \
+    { terminfo::kfx[(m * 12) + 8],  mod "F9",  m }, \
+    { terminfo::kfx[(m * 12) + 9],  mod "F10", m }, \
+    { terminfo::kfx[(m * 12) + 10], mod "F11", m }, \
+    { terminfo::kfx[(m * 12) + 11], mod "F12", m }
+
+// The key sequences the input decoder produces and their names, in the order
+// rl_help.cpp lists them.  Where a sequence repeats the first name wins.
+static constexpr keyseq_name s_keyseq_names[] = {
+    { terminfo::kesc, "Esc", 0 },
+    MODIFIED_KEYS(0, ""),
+    MODIFIED_KEYS(1, "S-"),
+    MODIFIED_KEYS(2, "C-"),
+    MODIFIED_KEYS(3, "C-S-"),
+    MODIFIED_KEYS(4, "A-"),
+    MODIFIED_KEYS(5, "A-S-"),
+    MODIFIED_KEYS(6, "A-C-"),
+    MODIFIED_KEYS(7, "A-C-S-"),
+    FUNCTION_KEYS(0, ""),
+    FUNCTION_KEYS(1, "S-"),
+    FUNCTION_KEYS(2, "C-"),
+    FUNCTION_KEYS(3, "C-S-"),
+    FUNCTION_KEYS(4, "A-"),
+    FUNCTION_KEYS(5, "A-S-"),
+    FUNCTION_KEYS(6, "A-C-"),
+    FUNCTION_KEYS(7, "A-C-S-"),
 };
 
-//------------------------------------------------------------------------------
-struct keyseq_key : public no_copy
-{
-    keyseq_key(const char* p, bool find = false) { this->s = p; this->find = find; }
-    keyseq_key(keyseq_key&& a) { s = a.s; find = a.find; a.s = nullptr; }
-    keyseq_key& operator=(keyseq_key&& a) { s = a.s; find = a.find; a.s = nullptr; }
+static_assert(sizeof_array(s_keyseq_names) == 1 + (13 * 8) + sizeof_array(terminfo::kfx), "missing key names");
 
-    const char* s;
-    bool find;
-};
+#undef FUNCTION_KEYS
+#undef MODIFIED_KEYS
 
 //------------------------------------------------------------------------------
-struct map_cmp_str
+// Perfect hashes, built by the compiler, mapping sequences to names and back.
+// There's no heap and no lazy initialisation.
+struct keyseq_keys
 {
-    bool operator()(keyseq_key const& a, keyseq_key const& b) const
+    constexpr const char* get(int index) const
     {
-        if (a.find)
-        {
-            assert(!b.find);
-            const char* bs = b.s;
-            for (const char* as = a.s; *as; as++, bs++)
-            {
-                int cmp = int((unsigned char)*as) - int((unsigned char)*bs);
-                if (cmp)
-                    return cmp < 0;
-            }
-        }
-        else if (b.find)
-        {
-            assert(!a.find);
-            const char* as = a.s;
-            for (const char* bs = b.s; *bs; as++, bs++)
-            {
-                int cmp = int((unsigned char)*as) - int((unsigned char)*bs);
-                if (cmp)
-                    return cmp < 0;
-            }
-        }
-        else
-        {
-            const char* as = a.s;
-            const char* bs = b.s;
-            while (true)
-            {
-                int cmp = int((unsigned char)*as) - int((unsigned char)*bs);
-                if (cmp || !*as)
-                    return cmp < 0;
-                as++;
-                bs++;
-            }
-        }
-        return false;
+        return s_keyseq_names[index].seq;
     }
 };
-static std::map<keyseq_key, keyseq_name, map_cmp_str> map_keyseq_to_name;
 
-//------------------------------------------------------------------------------
-static void add_keyseq_to_name(const char* keyseq, const char* name, str<32>& builder, short int modifier)
+struct keyname_keys
 {
-    if (!keyseq || !*keyseq)
-        return;
-
-    int old_len = builder.length();
-    builder.concat(name);
-
-    int alloc = builder.length() + 1;
-    keyseq_name second((char*)malloc(alloc), modifier, (short int)map_keyseq_to_name.size());
-    if (second.s)
+    constexpr const char* get(int index) const
     {
-        memcpy(second.s, builder.c_str(), alloc);
-        keyseq_key first(keyseq);
-        map_keyseq_to_name.emplace(std::move(first), std::move(second));
+        return *s_keyseq_names[index].seq ? s_keyseq_names[index].name : "";
     }
+};
 
-    builder.truncate(old_len);
-}
+static const int c_keyseq_count = sizeof_array(s_keyseq_names);
+static constexpr perfect_hash<c_keyseq_count> s_keyseq_to_name(keyseq_keys{});
+static constexpr perfect_hash<c_keyseq_count> s_name_to_keyseq(keyname_keys{});
+static_assert(s_keyseq_to_name.is_valid() && s_name_to_keyseq.is_valid(), "couldn't build key sequence tables");
 
 //------------------------------------------------------------------------------
-static void ensure_keyseqs_to_names()
+const char* find_key_name(const char* keyseq, int& len, int& eqclass, int& order)
 {
-    if (!map_keyseq_to_name.empty())
-        return;
-
-    static const char* const mods[] = { "", "S-", "C-", "C-S-", "A-", "A-S-", "A-C-", "A-C-S-" };
-    static_assert(sizeof_array(mods) == sizeof_array(terminfo::kcuu1), "modifier name count must match modified key array sizes");
-
-    str<32> builder;
-
-    add_keyseq_to_name(bindableEsc, "Esc", builder, 0);
-
-    for (int m = 0; m < sizeof_array(terminfo::kcuu1); m++)
-    {
-        builder = mods[m];
-        add_keyseq_to_name(terminfo::kcuu1[m], "Up", builder, m);
-        add_keyseq_to_name(terminfo::kcud1[m], "Down", builder, m);
-        add_keyseq_to_name(terminfo::kcub1[m], "Left", builder, m);
-        add_keyseq_to_name(terminfo::kcuf1[m], "Right", builder, m);
-        add_keyseq_to_name(terminfo::khome[m], "Home", builder, m);
-        add_keyseq_to_name(terminfo::kend[m], "End", builder, m);
-        add_keyseq_to_name(terminfo::kpp[m], "PgUp", builder, m);
-        add_keyseq_to_name(terminfo::knp[m], "PgDn", builder, m);
-        add_keyseq_to_name(terminfo::kich1[m], "Ins", builder, m);
-        add_keyseq_to_name(terminfo::kdch1[m], "Del", builder, m);
-        add_keyseq_to_name(terminfo::ktab[m], "Tab", builder, m);
-        add_keyseq_to_name(terminfo::kspc[m], "Space", builder, m);
-        add_keyseq_to_name(terminfo::kbks[m], "Bkspc", builder, m);
-    }
+    int index = s_keyseq_to_name.find_prefix(keyseq_keys(), keyseq, len);
+    if (index < 0)
+        return nullptr;
 
-    str<32> fn;
-    for (int i = 0; i < sizeof_array(terminfo::kfx); )
-    {
-        int m = i / 12;
-        builder = mods[m];
-        for (int j = 0; j < 12; j++, i++)
-        {
-            fn.format("F%u", j + 1);
-            add_keyseq_to_name(terminfo::kfx[i], fn.c_str(), builder, m);
-        }
-    }
+    eqclass = s_keyseq_names[index].eqclass;
+    order = index - c_keyseq_count;
+    return s_keyseq_names[index].name;
 }
 
 //------------------------------------------------------------------------------
-const char* find_key_name(const char* keyseq, int& len, int& eqclass, int& order)
+const char* find_key_sequence(const char* name)
 {
-    ensure_keyseqs_to_names();
-    keyseq_key lookup(keyseq, true/*find*/);
-    auto const& iter = map_keyseq_to_name.find(lookup);
-    if (iter == map_keyseq_to_name.end())
-        return nullptr;
-
-    len = (int)strlen(iter->first.s);
-    eqclass = iter->second.eq;
-    order = iter->second.o - (int)map_keyseq_to_name.size();
-    return iter->second.s;
+    int index = s_name_to_keyseq.find(keyname_keys(), name, int(strlen(name)));
+    return (index >= 0) ? s_keyseq_names[index].seq : nullptr;
 }
 
 
@@ -284,6 +243,7 @@ enum : unsigned char
     input_abort_byte    = 0xff,
     input_none_byte     = 0xfe,
     input_timeout_byte  = 0xfd,
+    input_paste_byte    = 0xfc,
 };
 
 
@@ -291,7 +251,7 @@ enum : unsigned char
 //------------------------------------------------------------------------------
 static unsigned int get_dimensions()
 {
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    CONSOLE_SCREEN_BUFFER_INFO csbi = {};
     GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
     auto cols = short(csbi.dwSize.X);
     auto rows = short(csbi.srWindow.Bottom - csbi.srWindow.Top) + 1;
@@ -333,8 +293,8 @@ static void adjust_cursor_on_resize(COORD prev_position)
 //------------------------------------------------------------------------------
 void win_terminal_in::begin()
 {
-    m_buffer_count = 0;
-    m_lead_surrogate = 0;
+    // Input that's already been read from the console is kept; it's the start
+    // of the next line when keys are typed ahead or a paste spans lines.
     m_stdin = GetStdHandle(STD_INPUT_HANDLE);
     GetConsoleMode(m_stdin, &m_prev_mode);
     set_cursor_visibility(false);
@@ -348,6 +308,22 @@ void win_terminal_in::end()
     m_stdin = nullptr;
 }
 
+//------------------------------------------------------------------------------
+void win_terminal_in::flush()
+{
+    m_buffer_count = 0;
+    m_record_head = 0;
+    m_record_count = 0;
+    m_lead_surrogate = 0;
+    m_paste.clear();
+}
+
+//------------------------------------------------------------------------------
+bool win_terminal_in::has_buffered_input() const
+{
+    return m_buffer_count || m_record_head < m_record_count;
+}
+
 //------------------------------------------------------------------------------
 void win_terminal_in::select()
 {
@@ -374,10 +350,39 @@ int win_terminal_in::read()
     case input_none_byte:       return terminal_in::input_none;
     case input_timeout_byte:    return terminal_in::input_timeout;
     case input_abort_byte:      return terminal_in::input_abort;
+    case input_paste_byte:      return terminal_in::input_paste;
+    default:                    return c;
+    }
+}
+
+//------------------------------------------------------------------------------
+int win_terminal_in::peek()
+{
+    if (!m_buffer_count)
+        return terminal_in::input_none;
+
+    unsigned char c = m_buffer[m_buffer_head];
+    switch (c)
+    {
+    case input_none_byte:
+    case input_timeout_byte:
+    case input_abort_byte:
+    case input_paste_byte:      return terminal_in::input_none;
     default:                    return c;
     }
 }
 
+//------------------------------------------------------------------------------
+bool win_terminal_in::get_paste(str_base& out)
+{
+    if (!m_paste.length())
+        return false;
+
+    out.concat(m_paste.c_str(), m_paste.length());
+    m_paste.clear();
+    return true;
+}
+
 //------------------------------------------------------------------------------
 key_tester* win_terminal_in::set_key_tester(key_tester* keys)
 {
@@ -387,58 +392,88 @@ key_tester* win_terminal_in::set_key_tester(key_tester* keys)
 }
 
 //------------------------------------------------------------------------------
-void win_terminal_in::read_console()
+static bool is_text_record(const INPUT_RECORD& record)
 {
-    // Clear 'processed input' flag so key presses such as Ctrl-C and Ctrl-S
-    // aren't swallowed. We also want events about window size changes.
-    struct mode_scope {
-        HANDLE  handle;
-        DWORD   prev_mode;
+    if (record.EventType != KEY_EVENT)
+        return false;
 
-        mode_scope(HANDLE handle) : handle(handle)
-        {
-            GetConsoleMode(handle, &prev_mode);
-            SetConsoleMode(handle, ENABLE_WINDOW_INPUT);
-        }
+    const KEY_EVENT_RECORD& key_event = record.Event.KeyEvent;
+    int key_char = key_event.uChar.UnicodeChar;
+    if (key_char < 0x20 || key_char == 0x7f)
+        return false;
 
-        ~mode_scope()
-        {
-            SetConsoleMode(handle, prev_mode);
-        }
-    } _ms(m_stdin);
+    if (key_event.wVirtualKeyCode == VK_MENU)
+        return false;
 
-    // Hide the cursor unless we're accepting input so we don't have to see it
-    // jump around as the screen's drawn.
-    struct cursor_scope {
-        cursor_scope()  { set_cursor_visibility(true); }
-// TODO: I think this is what broke cursor visibility in the lua debugger.
-        ~cursor_scope() { set_cursor_visibility(false); }
-    } _cs;
+    return !(key_event.dwControlKeyState & (CTRL_PRESSED|ALT_PRESSED));
+}
+
+//------------------------------------------------------------------------------
+static int get_paste_char(const INPUT_RECORD& record)
+{
+    // Returns the character a record contributes to pasted text, 0 if it
+    // contributes nothing (key-ups, Shift, Alt-numpad digits), or -1 if it's
+    // not plain text.
+    if (record.EventType != KEY_EVENT)
+        return -1;
+
+    const KEY_EVENT_RECORD& key_event = record.Event.KeyEvent;
+    int key_char = key_event.uChar.UnicodeChar;
+
+    // Characters that aren't on the keyboard are pasted as Alt-numpad codes,
+    // with the character arriving in the Alt key-up.
+    if (key_event.wVirtualKeyCode == VK_MENU)
+        return (!key_event.bKeyDown && key_char) ? key_char : 0;
+
+    if (!key_event.bKeyDown || !key_char)
+        return 0;
+
+    if (key_event.dwControlKeyState & (CTRL_PRESSED|ALT_PRESSED))
+        return -1;
+
+    if (key_char >= 0x20 && key_char != 0x7f)
+        return key_char;
 
+    switch (key_char)
+    {
+    case '\t':
+    case '\r':
+    case '\n':      return key_char;
+    default:        return -1;
+    }
+}
+
+//------------------------------------------------------------------------------
+void win_terminal_in::read_console()
+{
     // Conhost restarts the cursor blink when writing to the console. It restarts
     // hidden which means that if you type faster than the blink the cursor turns
     // invisible. Fortunately, moving the cursor restarts the blink on visible.
     HANDLE stdout_handle = GetStdHandle(STD_OUTPUT_HANDLE);
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    CONSOLE_SCREEN_BUFFER_INFO csbi = {};
     GetConsoleScreenBufferInfo(stdout_handle, &csbi);
-    if (!is_scroll_mode())
+    if (m_record_head >= m_record_count && !is_scroll_mode())
         SetConsoleCursorPosition(stdout_handle, csbi.dwCursorPosition);
 
     // Read input records sent from the terminal (aka conhost) until some
     // input has been buffered.
+    bool text = false;
     unsigned int buffer_count = m_buffer_count;
     while (buffer_count == m_buffer_count)
     {
-        DWORD count;
-        INPUT_RECORD record;
-        if (!ReadConsoleInputW(m_stdin, &record, 1, &count))
+        if (m_record_head >= m_record_count)
         {
-            // Handle's probably invalid if ReadConsoleInput() failed.
-            m_buffer_count = 1;
-            m_buffer[0] = input_abort_byte;
-            return;
+            if (!read_records(true))
+            {
+                // Handle's probably invalid if ReadConsoleInput() failed.
+                m_buffer_count = 1;
+                m_buffer[m_buffer_head] = input_abort_byte;
+                return;
+            }
         }
 
+        // Copied as looking ahead in the queue may move records around.
+        INPUT_RECORD record = m_records[m_record_head++];
         switch (record.EventType)
         {
         case KEY_EVENT:
@@ -455,8 +490,21 @@ void win_terminal_in::read_console()
                     key_event.dwControlKeyState = 0;
                 }
 
+                // Terminals in bracketed paste mode surround pasted text with
+                // ESC[200~ and ESC[201~.  That's the only sign of a paste;
+                // conhost's look just like keys typed ahead.
+                if (key_event.bKeyDown
+                    && key_event.uChar.UnicodeChar == 0x1b
+                    && !(key_event.dwControlKeyState & (CTRL_PRESSED|ALT_PRESSED))
+                    && skip_keys(L"[200~"))
+                {
+                    read_paste();
+                    return;
+                }
+
                 if (key_event.bKeyDown)
                 {
+                    text = is_text_record(record);
                     process_input(key_event);
 
                     // If the processed input chord isn't bound, discard it.
@@ -513,6 +561,184 @@ void win_terminal_in::read_console()
             return;
         }
     }
+
+    if (text && m_buffer_count)
+        read_text();
+}
+
+//------------------------------------------------------------------------------
+bool win_terminal_in::read_records(bool block)
+{
+    // Records not consumed yet are kept; new ones are appended after them.
+    unsigned int queued = m_record_count - m_record_head;
+    memmove(m_records, m_records + m_record_head, queued * sizeof(m_records[0]));
+    m_record_head = 0;
+    m_record_count = queued;
+
+    if (queued >= sizeof_array(m_records))
+        return false;
+
+    // Records are read in batches; a paste arrives as many records at once.
+    unsigned int space = sizeof_array(m_records) - queued;
+    unsigned int count = read_console_input(m_records + queued, space, block && !queued);
+    m_record_count += (unsigned short)count;
+    return (count > 0);
+}
+
+//------------------------------------------------------------------------------
+unsigned int win_terminal_in::read_console_input(INPUT_RECORD* records, unsigned int space, bool block)
+{
+    if (!block)
+    {
+        DWORD available = 0;
+        if (!GetNumberOfConsoleInputEvents(m_stdin, &available) || !available)
+            return 0;
+    }
+
+    // Clear 'processed input' flag so key presses such as Ctrl-C and Ctrl-S
+    // aren't swallowed. We also want events about window size changes.
+    struct mode_scope {
+        HANDLE  handle;
+        DWORD   prev_mode;
+
+        mode_scope(HANDLE handle) : handle(handle)
+        {
+            GetConsoleMode(handle, &prev_mode);
+            SetConsoleMode(handle, ENABLE_WINDOW_INPUT);
+        }
+
+        ~mode_scope()
+        {
+            SetConsoleMode(handle, prev_mode);
+        }
+    } _ms(m_stdin);
+
+    // Hide the cursor unless we're accepting input so we don't have to see it
+    // jump around as the screen's drawn.
+    struct cursor_scope {
+        bool    show;
+        cursor_scope(bool show) : show(show) { if (show) set_cursor_visibility(true); }
+// TODO: I think this is what broke cursor visibility in the lua debugger.
+        ~cursor_scope() { if (show) set_cursor_visibility(false); }
+    } _cs(block);
+
+    DWORD count;
+    if (!ReadConsoleInputW(m_stdin, records, space, &count))
+        return 0;
+
+    return count;
+}
+
+//------------------------------------------------------------------------------
+bool win_terminal_in::wait_console_input(unsigned int timeout)
+{
+    return WaitForSingleObject(m_stdin, timeout) == WAIT_OBJECT_0;
+}
+
+//------------------------------------------------------------------------------
+void win_terminal_in::read_text()
+{
+    // Buffer plain text that's already waiting (e.g. a paste) in one go, so
+    // the line editor can insert the whole run as a single edit.  Stop at
+    // anything that isn't plain text, or when the buffer's nearly full (but
+    // never between the halves of a surrogate pair).
+    while (m_lead_surrogate || m_buffer_count + 8 <= sizeof_array(m_buffer))
+    {
+        if (m_record_head >= m_record_count && !read_records(false))
+            break;
+
+        const INPUT_RECORD& record = m_records[m_record_head];
+        if (record.EventType == KEY_EVENT && !record.Event.KeyEvent.bKeyDown)
+        {
+            if (record.Event.KeyEvent.wVirtualKeyCode == VK_MENU && record.Event.KeyEvent.uChar.UnicodeChar)
+                break;
+
+            ++m_record_head;
+            continue;
+        }
+
+        if (!is_text_record(record))
+            break;
+
+        ++m_record_head;
+        process_input(record.Event.KeyEvent);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool win_terminal_in::skip_keys(const wchar_t* keys)
+{
+    // Consumes the queued records if their key-downs spell out 'keys'.
+    unsigned int index = m_record_head;
+    while (*keys)
+    {
+        if (index >= m_record_count)
+        {
+            unsigned int offset = index - m_record_head;
+            if (!read_records(false))
+                return false;
+
+            index = m_record_head + offset;
+            continue;
+        }
+
+        const INPUT_RECORD& record = m_records[index++];
+        if (record.EventType != KEY_EVENT)
+            return false;
+
+        const KEY_EVENT_RECORD& key_event = record.Event.KeyEvent;
+        if (!key_event.bKeyDown)
+            continue;
+
+        if (key_event.uChar.UnicodeChar != *keys)
+            return false;
+
+        ++keys;
+    }
+
+    m_record_head = index;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void win_terminal_in::read_paste()
+{
+    // Everything up to ESC[201~ is pasted, control keys included.  In case
+    // that's lost or garbled the wait for it is bounded, and what's arrived by
+    // then is pasted.
+    static const unsigned int paste_timeout = 1000;         // Milliseconds.
+    static const unsigned int paste_max_length = 1 << 20;   // Characters.
+
+    wstr<> text;
+    while (text.length() < paste_max_length)
+    {
+        if (m_record_head >= m_record_count)
+        {
+            if (!read_records(false) && (!wait_console_input(paste_timeout) || !read_records(false)))
+                break;
+            continue;
+        }
+
+        const INPUT_RECORD& record = m_records[m_record_head++];
+        int c = get_paste_char(record);
+        if (c < 0 && record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown)
+            c = record.Event.KeyEvent.uChar.UnicodeChar;
+
+        if (c == 0x1b && skip_keys(L"[201~"))
+            break;
+
+        if (c > 0)
+        {
+            wchar_t wc = wchar_t(c);
+            text.concat(&wc, 1);
+        }
+    }
+
+    m_paste.from_utf16(text.c_str());
+
+    static const unsigned int mask = sizeof_array(m_buffer) - 1;
+    m_buffer[(m_buffer_head + m_buffer_count) & mask] = input_paste_byte;
+    ++m_buffer_count;
 }
 
 //------------------------------------------------------------------------------
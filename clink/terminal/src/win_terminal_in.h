@@ -5,6 +5,8 @@
 
 #include "terminal_in.h"
 
+#include <core/str.h>
+
 class key_tester;
 
 //------------------------------------------------------------------------------
@@ -14,22 +16,38 @@ class win_terminal_in
 public:
     virtual void    begin() override;
     virtual void    end() override;
+    virtual void    flush() override;
     virtual void    select() override;
     virtual int     read() override;
+    virtual int     peek() override;
+    virtual bool    get_paste(str_base& out) override;
     virtual key_tester* set_key_tester(key_tester* keys) override;
 
+protected:
+    virtual unsigned int read_console_input(INPUT_RECORD* records, unsigned int space, bool block);
+    virtual bool    wait_console_input(unsigned int timeout);
+    bool            has_buffered_input() const;
+
 private:
     void            read_console();
+    bool            read_records(bool block);
+    void            read_text();
+    bool            skip_keys(const wchar_t* keys);
+    void            read_paste();
     void            process_input(const KEY_EVENT_RECORD& key_event);
     void            push(unsigned int value);
     void            push(const char* seq);
     unsigned char   pop();
-    key_tester*     m_keys;
+    key_tester*     m_keys = nullptr;
     void*           m_stdin = nullptr;
     unsigned int    m_dimensions = 0;
     unsigned long   m_prev_mode = 0;
-    unsigned char   m_buffer_head = 0;
-    unsigned char   m_buffer_count = 0;
+    unsigned short  m_buffer_head = 0;
+    unsigned short  m_buffer_count = 0;
+    unsigned short  m_record_head = 0;
+    unsigned short  m_record_count = 0;
     wchar_t         m_lead_surrogate = 0;
-    unsigned char   m_buffer[16]; // must be power of two.
+    unsigned char   m_buffer[512]; // must be power of two.
+    INPUT_RECORD    m_records[256];
+    str<>           m_paste;
 };
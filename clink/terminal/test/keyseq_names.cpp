@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/base.h>
+#include <terminal/terminal.h>
+
+#include <string.h>
+
+//------------------------------------------------------------------------------
+TEST_CASE("Key sequence names")
+{
+    int len = 0;
+    int eqclass = 0;
+    int order = 0;
+
+    SECTION("Names")
+    {
+        struct {
+            const char* keyseq;
+            const char* name;
+            int         len;
+            int         eqclass;
+        } keys[] = {
+            bindableEsc,            "Esc",          8,  0,
+            "\x1b[A",               "Up",           3,  0,
+            "\x1b[1;5C",            "C-Right",      6,  2,
+            "\x1b[6;8~",            "A-C-S-PgDn",   6,  7,
+            "\x1b[Z",               "S-Tab",        3,  1,
+            " ",                    "Space",        1,  0,
+            "\x7f",                 "C-Bkspc",      1,  2,
+            "\x1bOP",               "F1",           3,  0,
+            "\x1b[24;6~",           "C-S-F12",      7,  3,
+            "\x1b\x1b[1;2Q",        "A-S-F2",       7,  5,
+        };
+
+        for (const auto& key : keys)
+        {
+            const char* name = find_key_name(key.keyseq, len, eqclass, order);
+            REQUIRE(name != nullptr);
+            REQUIRE(strcmp(name, key.name) == 0);
+            REQUIRE(len == key.len);
+            REQUIRE(eqclass == key.eqclass);
+            REQUIRE(order < 0);
+        }
+    }
+
+    SECTION("Chords")
+    {
+        const char* keyseq = "\x1b[A\x1b[B";
+        REQUIRE(strcmp(find_key_name(keyseq, len, eqclass, order), "Up") == 0);
+        REQUIRE(strcmp(find_key_name(keyseq + len, len, eqclass, order), "Down") == 0);
+
+        int up_order = 0;
+        find_key_name("\x1b[A", len, eqclass, up_order);
+        find_key_name("\x1b[B", len, eqclass, order);
+        REQUIRE(up_order < order);
+    }
+
+    SECTION("Unknown")
+    {
+        REQUIRE(find_key_name("a", len, eqclass, order) == nullptr);
+        REQUIRE(find_key_name("\x1b[", len, eqclass, order) == nullptr);
+        REQUIRE(find_key_name("\x1b[9~", len, eqclass, order) == nullptr);
+        REQUIRE(find_key_name("", len, eqclass, order) == nullptr);
+    }
+
+    SECTION("Sequences")
+    {
+        REQUIRE(strcmp(find_key_sequence("Esc"), bindableEsc) == 0);
+        REQUIRE(strcmp(find_key_sequence("A-C-Up"), "\x1b[1;7A") == 0);
+        REQUIRE(strcmp(find_key_sequence("S-Space"), " ") == 0);
+        REQUIRE(strcmp(find_key_sequence("F12"), "\x1b[24~") == 0);
+
+        REQUIRE(find_key_sequence("S-Bkspc") == nullptr);
+        REQUIRE(find_key_sequence("Up!") == nullptr);
+        REQUIRE(find_key_sequence("") == nullptr);
+    }
+}
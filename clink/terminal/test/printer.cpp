@@ -0,0 +1,117 @@
+// Copyright (c) 2016 Martin Ridgers
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+
+#include <core/str.h>
+#include <terminal/printer.h>
+#include <terminal/terminal_out.h>
+
+//------------------------------------------------------------------------------
+class capture_terminal_out
+    : public terminal_out
+{
+public:
+    virtual void    open() override {}
+    virtual void    begin() override {}
+    virtual void    end() override {}
+    virtual void    close() override {}
+    virtual void    write(const char* chars, int length) override { m_output.concat(chars, length); }
+    virtual void    flush() override {}
+    virtual int     get_columns() const override { return 80; }
+    virtual int     get_rows() const override { return 25; }
+    str<>           m_output;
+};
+
+
+
+//------------------------------------------------------------------------------
+TEST_CASE("printer : sgr deltas")
+{
+    capture_terminal_out terminal;
+    printer printer(terminal);
+
+    SECTION("Redundant")
+    {
+        printer.print("\x1b[m\x1b[1mabc\x1b[m\x1b[1mdef\x1b[1m");
+        REQUIRE(terminal.m_output.equals("\x1b[0;1mabcdef"));
+    }
+
+    SECTION("Delta")
+    {
+        printer.print("\x1b[31mabc");
+        terminal.m_output.clear();
+
+        printer.print("\x1b[0;1;31mdef\x1b[0;4;31mghi");
+        REQUIRE(terminal.m_output.equals("\x1b[1mdef\x1b[22;4mghi"));
+    }
+
+    SECTION("Unsupported")
+    {
+        printer.print("\x1b[m");
+        terminal.m_output.clear();
+
+        printer.print("\x1b[38;5;100mabc\x1b[mdef");
+        REQUIRE(terminal.m_output.equals("\x1b[38;5;100mabc\x1b[0mdef"));
+    }
+
+    SECTION("Non-SGR")
+    {
+        printer.print("\x1b[m");
+        terminal.m_output.clear();
+
+        printer.print("\x1b[44m\x1b[K\x1b[m");
+        REQUIRE(terminal.m_output.equals("\x1b[44m\x1b[K\x1b[49m"));
+    }
+
+    SECTION("Reset")
+    {
+        printer.print("\x1b[m");
+        printer.reset();
+        terminal.m_output.clear();
+
+        printer.print("\x1b[mabc");
+        REQUIRE(terminal.m_output.equals("\x1b[0mabc"));
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("printer : attr string")
+{
+    capture_terminal_out terminal;
+    printer printer(terminal);
+
+    printer.print("\x1b[m");
+    terminal.m_output.clear();
+
+    printer.print("1;33", "abc");
+    printer.print("def");
+    REQUIRE(terminal.m_output.equals("\x1b[33;1mabc\x1b[39;22mdef"));
+
+    terminal.m_output.clear();
+    printer.print("38;2;1;2;3", "abc");
+    printer.print("def");
+    REQUIRE(terminal.m_output.equals("\x1b[38;2;1;2;3mabc\x1b[0mdef"));
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("printer : sgr bytes saved")
+{
+    capture_terminal_out terminal;
+    printer printer(terminal);
+
+    // Mimics how Readline lists coloured matches; reset, colour, name, reset,
+    // then pad to the next column.
+    str<> row;
+    for (int i = 0; i < 8; ++i)
+        row << "\x1b[m\x1b[01;34mdirectory\x1b[m\x1b[m      ";
+    row << "\x1b[m\x1b[K";
+
+    for (int i = 0; i < 1000; ++i)
+        printer.print(row.c_str(), row.length());
+
+    const printer::sgr_stats& stats = printer.get_sgr_stats();
+    REQUIRE(stats.bytes_in == 1000 * (8 * 17 + 3));
+    REQUIRE(stats.bytes_out < stats.bytes_in / 2);
+    REQUIRE(stats.cache_hits > 1000);
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "console_in_tester.h"
+
+#include <core/str.h>
+
+//------------------------------------------------------------------------------
+static int read_key(test_console_in& input)
+{
+    while (input.has_input())
+    {
+        input.select();
+        int key = input.read();
+        if (key != terminal_in::input_none && key != terminal_in::input_terminal_resize)
+            return key;
+    }
+
+    return terminal_in::input_none;
+}
+
+//------------------------------------------------------------------------------
+static void read_keys(test_console_in& input, const char* expected)
+{
+    for (; *expected; ++expected)
+    {
+        int key = read_key(input);
+        REQUIRE(key == *expected, [&] () {
+            printf("expected; %d\n     got; %d\n", *expected, key);
+        });
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Console input")
+{
+    test_console_in input;
+    input.begin();
+
+    SECTION("Typed ahead")
+    {
+        // Keys typed while the first line's being accepted arrive with it,
+        // and start the next line.
+        input.add_text("a\rb");
+
+        read_keys(input, "a\r");
+        input.end();
+
+        input.begin();
+        read_keys(input, "b");
+        REQUIRE(!input.has_input());
+    }
+
+    SECTION("Flush")
+    {
+        input.add_text("abc");
+        read_keys(input, "a");
+        input.flush();
+        REQUIRE(!input.has_input());
+    }
+
+    input.end();
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE("Console input : paste")
+{
+    static const char* const text = "echo one two three\r\necho four five six\r\n";
+
+    test_console_in input;
+    input.begin();
+
+    SECTION("Clipboard")
+    {
+        // Without brackets a paste can't be told from keys typed ahead, so
+        // each line's accepted in turn.
+        input.add_text(text);
+        read_keys(input, text);
+        REQUIRE(read_key(input) == terminal_in::input_none);
+    }
+
+    SECTION("Bracketed")
+    {
+        input.add_text("\x1b[200~x\ty\r\nz\x1b[201~!");
+        REQUIRE(read_key(input) == terminal_in::input_paste);
+
+        str<> paste;
+        REQUIRE(input.get_paste(paste));
+        REQUIRE(paste.equals("x\ty\r\nz"));
+        read_keys(input, "!");
+    }
+
+    SECTION("Bracketed across batches")
+    {
+        input.add_text("\x1b[200~x\r");
+        input.add_gap();
+        input.add_text("y\x1b[201~");
+        REQUIRE(read_key(input) == terminal_in::input_paste);
+
+        str<> paste;
+        REQUIRE(input.get_paste(paste));
+        REQUIRE(paste.equals("x\ry"));
+    }
+
+    SECTION("Typed ahead")
+    {
+        // Commands typed while another's running arrive in one batch, and
+        // Enter still accepts each of them.
+        static const char* const typed = "cd c:\\src\\clink\\terminal\rdir /b *.cpp *.h\r";
+        input.add_text(typed);
+        read_keys(input, typed);
+        REQUIRE(read_key(input) == terminal_in::input_none);
+    }
+
+    SECTION("Unterminated")
+    {
+        // A lost ESC[201~ doesn't hold up the prompt; what's arrived is pasted.
+        input.add_text("\x1b[200~x\ry");
+        REQUIRE(read_key(input) == terminal_in::input_paste);
+
+        str<> paste;
+        REQUIRE(input.get_paste(paste));
+        REQUIRE(paste.equals("x\ry"));
+        REQUIRE(!input.has_input());
+    }
+
+    SECTION("Tab")
+    {
+        input.add_text("cd \tfoo");
+        read_keys(input, "cd \tfoo");
+    }
+
+    SECTION("Rollover")
+    {
+        // Typists press the next key before releasing the last.
+        input.add_text(text, true);
+        read_keys(input, text);
+    }
+
+    input.end();
+}
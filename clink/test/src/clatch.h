@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <chrono>
 #include <exception>
 
 namespace clatch {
@@ -63,10 +64,12 @@ struct test
     test*               m_next = nullptr;
     test_func*          m_func;
     const char*         m_name;
+    bool                m_benchmark;
 
-    test(const char* name, test_func* func)
+    test(const char* name, test_func* func, bool benchmark=false)
     : m_name(name)
     , m_func(func)
+    , m_benchmark(benchmark)
     {
         if (get_head() == nullptr)
             get_head() = this;
@@ -78,7 +81,26 @@ struct test
 };
 
 //------------------------------------------------------------------------------
-inline bool run(const char* prefix="")
+// Times a benchmark, printing how long it took since it was made or last
+// reported.
+struct timer
+{
+    typedef std::chrono::steady_clock clock;
+
+    void report(const char* what)
+    {
+        clock::time_point now = clock::now();
+        long long us = std::chrono::duration_cast<std::chrono::microseconds>(now - m_start).count();
+        printf("\n          %-48s %10lld us", what, us);
+        m_start = clock::now();
+    }
+
+    clock::time_point   m_start = clock::now();
+};
+
+//------------------------------------------------------------------------------
+// Benchmarks only run when asked for, and tests don't run with them.
+inline bool run(const char* prefix="", bool benchmarks=false)
 {
     int fail_count = 0;
     int test_count = 0;
@@ -86,6 +108,9 @@ inline bool run(const char* prefix="")
 
     for (test* test = test::get_head(); test != nullptr; test = test->m_next)
     {
+        if (test->m_benchmark != benchmarks)
+            continue;
+
         // Cheap lower-case prefix test.
         const char* a = prefix, *b = test->m_name;
         for (; *a && (*a & ~0x20) == (*b & ~0x20); ++a, ++b);
@@ -123,7 +148,7 @@ inline bool run(const char* prefix="")
         }
 
         assert_count += root.m_assert_count;
-        puts("\rok ");
+        puts(benchmarks ? "\nok " : "\rok ");
     }
 
     printf("\n tests:%d  failed:%d  asserts:%d\n", test_count, fail_count, assert_count);
@@ -168,6 +193,11 @@ void fail(const char* expr, const char* file, int line, CALLBACK&& cb)
     static clatch::test CLATCH_IDENT(test)(name, CLATCH_IDENT(test_func));\
     static void CLATCH_IDENT(test_func)(clatch::section*& _clatch_tree_iter)
 
+#define BENCHMARK(name)\
+    static void CLATCH_IDENT(test_func)(clatch::section*&);\
+    static clatch::test CLATCH_IDENT(test)(name, CLATCH_IDENT(test_func), true);\
+    static void CLATCH_IDENT(test_func)(clatch::section*& _clatch_tree_iter)
+
 #define SECTION(name)\
     static clatch::section CLATCH_IDENT(section);\
     if (clatch::section::scope CLATCH_IDENT(scope) = clatch::section::scope(_clatch_tree_iter, CLATCH_IDENT(section), name))
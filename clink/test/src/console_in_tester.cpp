@@ -0,0 +1,120 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#include "pch.h"
+#include "console_in_tester.h"
+
+#include <core/base.h>
+#include <core/str.h>
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+static INPUT_RECORD make_key(wchar_t c, bool down)
+{
+    INPUT_RECORD record = {};
+    record.EventType = KEY_EVENT;
+
+    KEY_EVENT_RECORD& key_event = record.Event.KeyEvent;
+    key_event.bKeyDown = down;
+    key_event.wRepeatCount = 1;
+    key_event.uChar.UnicodeChar = c;
+
+    switch (c)
+    {
+    case '\t':  key_event.wVirtualKeyCode = VK_TAB; break;
+    case '\r':  key_event.wVirtualKeyCode = VK_RETURN; break;
+    case 0x1b:  key_event.wVirtualKeyCode = VK_ESCAPE; break;
+    case ' ':   key_event.wVirtualKeyCode = VK_SPACE; break;
+    default:
+        if (c >= 'a' && c <= 'z')
+            key_event.wVirtualKeyCode = WORD(c - 'a' + 'A');
+        else if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+            key_event.wVirtualKeyCode = WORD(c);
+        break;
+    }
+
+    return record;
+}
+
+//------------------------------------------------------------------------------
+void test_console_in::add_text(const char* text, bool rollover)
+{
+    // Each character's a key-down followed by its key-up, as conhost sends a
+    // paste.  Typing quickly tends to roll over instead, pressing each key
+    // before the previous one's released.
+    wstr<> wtext(text);
+    for (unsigned int i = 0; i < wtext.length(); ++i)
+    {
+        m_queue.push_back(make_key(wtext[i], true));
+        if (rollover && i + 1 < wtext.length())
+        {
+            m_queue.push_back(make_key(wtext[i + 1], true));
+            m_queue.push_back(make_key(wtext[i], false));
+            m_queue.push_back(make_key(wtext[i + 1], false));
+            ++i;
+            continue;
+        }
+
+        m_queue.push_back(make_key(wtext[i], false));
+    }
+}
+
+//------------------------------------------------------------------------------
+void test_console_in::add_record(const INPUT_RECORD& record)
+{
+    m_queue.push_back(record);
+}
+
+//------------------------------------------------------------------------------
+void test_console_in::add_gap()
+{
+    // Records after a gap arrive later, so they're not there to be seen until
+    // a read waits for them.
+    m_gaps.push_back(unsigned(m_queue.size()));
+}
+
+//------------------------------------------------------------------------------
+bool test_console_in::has_input() const
+{
+    return m_next < m_queue.size() || has_buffered_input();
+}
+
+//------------------------------------------------------------------------------
+unsigned int test_console_in::read_console_input(INPUT_RECORD* records, unsigned int space, bool block)
+{
+    // A console would wait for input here.  A resize event lets the caller
+    // return instead.
+    if (m_next >= m_queue.size())
+    {
+        if (!block)
+            return 0;
+
+        INPUT_RECORD record = {};
+        record.EventType = WINDOW_BUFFER_SIZE_EVENT;
+        *records = record;
+        return 1;
+    }
+
+    auto gap = std::upper_bound(m_gaps.begin(), m_gaps.end(), m_next);
+    unsigned int end = (gap == m_gaps.end()) ? unsigned(m_queue.size()) : *gap;
+    if (!block && std::binary_search(m_gaps.begin(), m_gaps.end(), m_next))
+        return 0;
+
+    unsigned int count = min(space, end - m_next);
+    std::copy(m_queue.begin() + m_next, m_queue.begin() + m_next + count, records);
+    m_next += count;
+    return count;
+}
+
+//------------------------------------------------------------------------------
+bool test_console_in::wait_console_input(unsigned int timeout)
+{
+    // Nothing more's coming once the queue's empty, so there's no need to wait
+    // out the timeout.  Otherwise a gap's over once it's waited for.
+    auto gap = std::lower_bound(m_gaps.begin(), m_gaps.end(), m_next);
+    if (gap != m_gaps.end() && *gap == m_next)
+        m_gaps.erase(gap);
+
+    return m_next < m_queue.size();
+}
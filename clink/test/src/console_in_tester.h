@@ -0,0 +1,30 @@
+// Copyright (c) 2020 Christopher Antos
+// License: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "win_terminal_in.h"
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Feeds win_terminal_in synthetic console input records, so what it does with
+// them (batching, type-ahead, pastes) can be tested without a console.
+class test_console_in
+    : public win_terminal_in
+{
+public:
+    void                    add_text(const char* text, bool rollover=false);
+    void                    add_record(const INPUT_RECORD& record);
+    void                    add_gap();
+    bool                    has_input() const;
+
+protected:
+    virtual unsigned int    read_console_input(INPUT_RECORD* records, unsigned int space, bool block) override;
+    virtual bool            wait_console_input(unsigned int timeout) override;
+
+private:
+    std::vector<INPUT_RECORD> m_queue;
+    std::vector<unsigned int> m_gaps;
+    unsigned int            m_next = 0;
+};
@@ -3,6 +3,7 @@
 
 #include "pch.h"
 #include "line_editor_tester.h"
+#include "console_in_tester.h"
 #include "terminal/printer.h"
 
 #include <core/base.h>
@@ -25,6 +26,7 @@ public:
     virtual void    on_matches_changed(const context& context) override {}
     virtual void    on_classifications_changed(const context& context) override {}
     virtual void    on_input(const input& input, result& result, const context& context) override {}
+    virtual void    on_paste(const char* text, unsigned int len, result& result, const context& context) override {}
     virtual void    on_terminal_resize(int columns, int rows, const context& context) override {}
 };
 
@@ -96,6 +98,14 @@ line_editor_tester::line_editor_tester(const line_editor::desc& desc)
     create_line_editor(&desc);
 }
 
+//------------------------------------------------------------------------------
+line_editor_tester::line_editor_tester(test_console_in& console)
+: m_console(&console)
+{
+    // Input goes through the console input decoder as key records.
+    create_line_editor();
+}
+
 //------------------------------------------------------------------------------
 void line_editor_tester::create_line_editor(const line_editor::desc* desc)
 {
@@ -106,7 +116,10 @@ void line_editor_tester::create_line_editor(const line_editor::desc* desc)
 
     m_printer = new printer(m_terminal_out);
 
-    inner_desc.input = &m_terminal_in;
+    if (m_console != nullptr)
+        inner_desc.input = m_console;
+    else
+        inner_desc.input = &m_terminal_in;
     inner_desc.output = &m_terminal_out;
     inner_desc.printer = m_printer;
 
@@ -146,7 +159,14 @@ void line_editor_tester::run()
     REQUIRE(has_expectations);
 
     REQUIRE(m_input != nullptr);
-    m_terminal_in.set_input(m_input);
+    terminal_in* input = &m_terminal_in;
+    if (m_console != nullptr)
+    {
+        m_console->add_text(m_input);
+        input = m_console;
+    }
+    else
+        m_terminal_in.set_input(m_input);
 
     // If we're expecting some matches then add a module to catch the
     // matches object.
@@ -158,9 +178,10 @@ void line_editor_tester::run()
     REQUIRE(m_editor->update());
     do
     {
+        input->select();
         REQUIRE(m_editor->update());
     }
-    while (m_terminal_in.has_input());
+    while (m_console ? m_console->has_input() : m_terminal_in.has_input());
 
     if (m_has_matches)
     {
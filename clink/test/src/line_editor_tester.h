@@ -11,6 +11,8 @@
 
 #include <vector>
 
+class test_console_in;
+
 //------------------------------------------------------------------------------
 #define DO_COMPLETE "\x09"
 
@@ -25,6 +27,7 @@ public:
     virtual void            end() override {}
     virtual void            select() override {}
     virtual int             read() override { return *(unsigned char*)m_read++; }
+    virtual int             peek() override { return has_input() ? *(unsigned char*)m_read : input_none; }
     virtual key_tester*     set_key_tester(key_tester*) override { return nullptr; }
 
 private:
@@ -56,6 +59,7 @@ class line_editor_tester
 public:
                                 line_editor_tester();
                                 line_editor_tester(const line_editor::desc& desc);
+                                line_editor_tester(test_console_in& console);
                                 ~line_editor_tester();
     line_editor*                get_editor() const;
     void                        set_input(const char* input);
@@ -68,6 +72,7 @@ private:
     void                        create_line_editor(const line_editor::desc* desc=nullptr);
     void                        expected_matches_impl(int dummy, ...);
     test_terminal_in            m_terminal_in;
+    test_console_in*            m_console = nullptr;
     test_terminal_out           m_terminal_out;
     printer*                    m_printer;
     std::vector<const char*>    m_expected_matches;
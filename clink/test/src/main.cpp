@@ -12,6 +12,7 @@ int main(int argc, char** argv)
     argc--, argv++;
 
     bool timer = false;
+    bool benchmarks = false;
 
     while (argc > 0)
     {
@@ -19,10 +20,15 @@ int main(int argc, char** argv)
         {
             puts("Options:\n"
                  "  -?        Show this help.\n"
+                 "  -b        Run benchmarks instead of tests.\n"
                  "  -d        Load Lua debugger.\n"
                  "  -t        Show execution time.");
             return 1;
         }
+        else if (!strcmp(argv[0], "-b"))
+        {
+            benchmarks = true;
+        }
         else if (!strcmp(argv[0], "-d"))
         {
             g_force_load_debugger = true;
@@ -45,7 +51,7 @@ int main(int argc, char** argv)
     DWORD start = GetTickCount();
 
     const char* prefix = (argc > 0) ? argv[0] : "";
-    int result = (clatch::run(prefix) != true);
+    int result = (clatch::run(prefix, benchmarks) != true);
 
     if (timer)
     {
@@ -331,6 +331,8 @@ clink_exe("clink_test")
     includedirs("clink/lib/src")
     includedirs("clink/lua/include")
     includedirs("clink/terminal/include")
+    includedirs("clink/terminal/include/terminal")
+    includedirs("clink/terminal/src")
     includedirs("lua/src")
     includedirs("readline")
     files("clink/app/test/*.cpp")
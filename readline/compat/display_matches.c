@@ -78,6 +78,7 @@ extern void qsort_match_list (char** matches, int len);
 
 //------------------------------------------------------------------------------
 rl_match_display_filter_func_t *rl_match_display_filter_func = NULL;
+rl_free_match_display_filter_func_t *rl_free_match_display_filter_func = NULL;
 const char *_rl_filtered_color = NULL;
 
 
@@ -91,6 +92,10 @@ static const char* const _normal_color = "\x1b[m";
 static const int _normal_color_len = 3;
 static const int desc_sep_padding = 4;
 
+// Lists longer than this are measured lazily when paging is enabled; the column
+// width starts from this many matches and grows as wider ones are displayed.
+static const int measure_sample_size = 256;
+
 //------------------------------------------------------------------------------
 static void reset_tmpbuf (void)
 {
@@ -771,45 +776,49 @@ static void pad_filename(int len, int pad_to_width)
 }
 
 //------------------------------------------------------------------------------
-static int display_match_list_internal(char **matches, int len, int max, bool only_measure)
+// Find the length of the prefix common to all items: length as displayed
+// characters (common_length) and as a byte index into the matches (sind).
+// Returns MAX reduced by how much the prefix's ellipsis saves.
+static int get_common_prefix(char **matches, int max, int *common_length, int *sind)
 {
-    int count, limit, printed_len, lines, cols;
-    int i, j, k, l;
-    int major_stride, minor_stride;
-    char *temp, *t;
+    char *t;
 
-    // Find the length of the prefix common to all items: length as displayed
-    // characters (common_length) and as a byte index into the matches (sind)
-    int common_length = 0;
-    int sind = 0;
+    *common_length = 0;
+    *sind = 0;
     if (_rl_completion_prefix_display_length > 0)
     {
         t = visible_part(matches[0]);
-        common_length = fnwidth(t);
-        sind = strlen(t);
-        if (common_length > max || sind > max)
-            common_length = sind = 0;
+        *common_length = fnwidth(t);
+        *sind = strlen(t);
+        if (*common_length > max || *sind > max)
+            *common_length = *sind = 0;
 
-        if (common_length > _rl_completion_prefix_display_length && common_length > ELLIPSIS_LEN)
-            max -= common_length - ELLIPSIS_LEN;
+        if (*common_length > _rl_completion_prefix_display_length && *common_length > ELLIPSIS_LEN)
+            max -= *common_length - ELLIPSIS_LEN;
         else
-            common_length = sind = 0;
+            *common_length = *sind = 0;
     }
 #if defined(COLOR_SUPPORT)
     else if (_rl_colored_completion_prefix > 0)
     {
         t = visible_part(matches[0]);
-        common_length = fnwidth(t);
-        sind = RL_STRLEN(t);
-        if (common_length > max || sind > max)
-            common_length = sind = 0;
+        *common_length = fnwidth(t);
+        *sind = RL_STRLEN(t);
+        if (*common_length > max || *sind > max)
+            *common_length = *sind = 0;
     }
 #endif
 
-    // How many items of MAX length can we fit in the screen window?
-    cols = complete_get_screenwidth();
-    max += 2;
-    limit = cols / max;
+    return max;
+}
+
+//------------------------------------------------------------------------------
+// How many items of MAX length (including padding) can we fit in the screen
+// window?
+static int get_column_limit(int max)
+{
+    int cols = complete_get_screenwidth();
+    int limit = cols / max;
     if (limit != 1 && (limit * max == cols))
         limit--;
 
@@ -818,6 +827,70 @@ static int display_match_list_internal(char **matches, int len, int max, bool on
     if (limit <= 0)
         limit = 1;
 
+    return limit;
+}
+
+//------------------------------------------------------------------------------
+static int measure_match(char *match)
+{
+    char *temp = printable_part(match);
+    int len = fnwidth(temp);
+    int vis_stat;
+
+    // If present, use the match type to determine whether there will be a
+    // visible stat character, and include it in the max length calculation.
+    if (rl_completion_matches_include_type)
+    {
+        vis_stat = -1;
+        if (IS_MATCH_TYPE_DIR(match[0]) && (
+#if defined (VISIBLE_STATS)
+            rl_visible_stats ||
+#endif
+#if defined (COLOR_SUPPORT)
+            _rl_colored_stats ||
+#endif
+            _rl_complete_mark_directories))
+        {
+            char *sep = rl_last_path_separator(match);
+            vis_stat = (!sep || sep[1]);
+        }
+#if defined (VISIBLE_STATS)
+        else if (rl_visible_stats && rl_filename_display_desired)
+            vis_stat = stat_char (match + 1, match[0]);
+#endif
+        if (vis_stat > 0)
+            len++;
+    }
+
+    return len;
+}
+
+//------------------------------------------------------------------------------
+static void append_row_end(void)
+{
+#if defined(COLOR_SUPPORT)
+    if (_rl_colored_stats)
+    {
+        append_default_color();
+        append_color_indicator(C_CLR_TO_EOL);
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+static int display_match_list_internal(char **matches, int len, int max, bool only_measure)
+{
+    int count, limit, printed_len, lines;
+    int i, j, l;
+    int major_stride, minor_stride;
+    int common_length, sind;
+    char *temp;
+
+    max = get_common_prefix(matches, max, &common_length, &sind);
+
+    max += 2;
+    limit = get_column_limit(max);
+
     // How many iterations of the printing loop?
     count = (len + (limit - 1)) / limit;
 
@@ -865,13 +938,7 @@ static int display_match_list_internal(char **matches, int len, int max, bool on
             }
             l += minor_stride;
         }
-#if defined(COLOR_SUPPORT)
-        if (_rl_colored_stats)
-        {
-            append_default_color();
-            append_color_indicator(C_CLR_TO_EOL);
-        }
-#endif
+        append_row_end();
         flush_tmpbuf();
         rl_crlf();
 #if defined(SIGWINCH)
@@ -892,6 +959,108 @@ static int display_match_list_internal(char **matches, int len, int max, bool on
     return 0;
 }
 
+//------------------------------------------------------------------------------
+// Displays a long list a page at a time.  Each page is laid out on its own, so
+// only the matches up to the current page need to have been measured.  MAX is
+// the widest of the first MEASURED matches, which must already be sorted so the
+// measured ones are the ones that come first.
+static void display_match_list_paged(char **matches, int len, int max, int measured)
+{
+    int count, limit, printed_len, lines, page_rows, col_max;
+    int i, j, l, first, n;
+    int major_stride, minor_stride;
+    int common_length, sind;
+    int grew;
+    char *temp;
+
+    rl_crlf();
+
+    lines = 0;
+    for (first = 1; first <= len; first += n)
+    {
+        page_rows = (_rl_screenheight - 1) - lines;
+        if (page_rows < 1)
+            page_rows = 1;
+
+        // Measure the matches that land on this page.  If any are wider than
+        // the columns, lay the page out again; it can only get shorter, so
+        // everything on it has already been measured.
+        do
+        {
+            col_max = get_common_prefix(matches, max, &common_length, &sind) + 2;
+            limit = get_column_limit(col_max);
+
+            count = (len - first + limit) / limit;
+            if (count > page_rows)
+                count = page_rows;
+
+            n = count * limit;
+            if (n > len - first + 1)
+                n = len - first + 1;
+
+            grew = 0;
+            for (; measured < first + n - 1; measured++)
+            {
+                int w = measure_match(matches[measured + 1]);
+                if (w > max)
+                {
+                    max = w;
+                    grew = 1;
+                }
+            }
+        }
+        while (grew);
+
+        if (_rl_print_completions_horizontally == 0)
+        {
+            // Print the sorted items, up-and-down alphabetically, like ls.
+            major_stride = 1;
+            minor_stride = count;
+        }
+        else
+        {
+            // Print the sorted items, across alphabetically, like ls -x.
+            major_stride = limit;
+            minor_stride = 1;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            reset_tmpbuf();
+            for (j = 0, l = first + i * major_stride; j < limit; j++)
+            {
+                if (l >= first + n || matches[l] == 0)
+                    break;
+
+                temp = printable_part(matches[l]);
+                printed_len = append_filename(temp, matches[l], sind);
+
+                if (j + 1 < limit)
+                    pad_filename(printed_len, col_max);
+
+                l += minor_stride;
+            }
+            append_row_end();
+            flush_tmpbuf();
+            rl_crlf();
+#if defined(SIGWINCH)
+            if (RL_SIG_RECEIVED() && RL_SIGWINCH_RECEIVED() == 0)
+#else
+            if (RL_SIG_RECEIVED())
+#endif
+                return;
+            lines++;
+        }
+
+        if (first + n <= len)
+        {
+            lines = _rl_internal_pager(lines);
+            if (lines < 0)
+                return;
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 static int display_filtered_match_list_internal(match_display_filter_entry **matches, int len, int max, bool only_measure)
 {
@@ -1002,7 +1171,11 @@ static int display_filtered_match_list_internal(match_display_filter_entry **mat
 //------------------------------------------------------------------------------
 void free_filtered_matches(match_display_filter_entry** filtered_matches)
 {
-    if (filtered_matches)
+    if (filtered_matches && rl_free_match_display_filter_func)
+    {
+        rl_free_match_display_filter_func(filtered_matches);
+    }
+    else if (filtered_matches)
     {
         for (match_display_filter_entry** walk = filtered_matches; *walk; walk++)
             free(*walk);
@@ -1032,9 +1205,8 @@ static int prompt_display_matches(int len)
 //------------------------------------------------------------------------------
 void display_matches(char** matches)
 {
-    int len, max, max_display, max_description, i;
+    int len, max, max_display, max_description, i, sample;
     char *temp;
-    int vis_stat;
 
     // If there is a display filter, give it a chance to modify MATCHES.
     if (rl_match_display_filter_func)
@@ -1099,43 +1271,28 @@ done_filtered:
         goto done;
     }
 
-    // There is more than one answer.  Find out how many there are,
-    // and find the maximum printed length of a single entry.
-    for (max = 0, i = 1; matches[i]; i++)
-    {
-        temp = printable_part(matches[i]);
-        len = fnwidth(temp);
+    // There is more than one answer.  Find out how many there are, and find
+    // the maximum printed length of a single entry.  When paging, long lists
+    // only measure a sample here and the rest as they're displayed.
+    for (len = 0; matches[len + 1]; len++)
+        ;
 
-        // If present, use the match type to determine whether there will be a
-        // visible stat character, and include it in the max length calculation.
-        if (rl_completion_matches_include_type)
-        {
-            vis_stat = -1;
-            if (IS_MATCH_TYPE_DIR(matches[i][0]) && (
-#if defined (VISIBLE_STATS)
-                rl_visible_stats ||
-#endif
-#if defined (COLOR_SUPPORT)
-                _rl_colored_stats ||
-#endif
-                _rl_complete_mark_directories))
-            {
-                char *sep = rl_last_path_separator(matches[i]);
-                vis_stat = (!sep || sep[1]);
-            }
-#if defined (VISIBLE_STATS)
-            else if (rl_visible_stats && rl_filename_display_desired)
-                vis_stat = stat_char (matches[i] + 1, matches[i][0]);
-#endif
-            if (vis_stat > 0)
-                len++;
-        }
+    sample = len;
+    if (_rl_page_completions && sample > measure_sample_size)
+    {
+        sample = measure_sample_size;
 
-        if (len > max)
-            max = len;
+        // Sort the items now, so the sample is the first of them as displayed.
+        if (rl_ignore_completion_duplicates == 0 && rl_sort_completion_matches)
+            qsort_match_list(matches + 1, len);
     }
 
-    len = i - 1;
+    for (max = 0, i = 1; i <= sample; i++)
+    {
+        int w = measure_match(matches[i]);
+        if (w > max)
+            max = w;
+    }
 
     // If there are many items, then ask the user if she really wants to
     // see them all.
@@ -1147,6 +1304,12 @@ done_filtered:
             goto done;
     }
 
+    if (sample < len)
+    {
+        display_match_list_paged(matches, len, max, sample);
+        goto done;
+    }
+
     display_match_list_internal(matches, len, max, false);
 
 done:
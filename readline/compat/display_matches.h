@@ -20,6 +20,9 @@ typedef struct match_display_filter_entry match_display_filter_entry;
 typedef match_display_filter_entry** rl_match_display_filter_func_t(char**);
 extern rl_match_display_filter_func_t *rl_match_display_filter_func;
 
+typedef void rl_free_match_display_filter_func_t(match_display_filter_entry**);
+extern rl_free_match_display_filter_func_t *rl_free_match_display_filter_func;
+
 extern const char *_rl_filtered_color;
 
 extern void free_filtered_matches(match_display_filter_entry** filtered_matches);
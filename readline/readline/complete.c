@@ -171,6 +171,9 @@ static void display_matches PARAMS((char **));
 static int compute_lcd_of_matches PARAMS((char **, int, const char *));
 static int postprocess_matches PARAMS((char ***, int));
 /* begin_clink_change */
+static void free_match PARAMS((char *));
+/* end_clink_change */
+/* begin_clink_change */
 /*static*/ int complete_get_screenwidth PARAMS((void));
 /* end_clink_change */
 
@@ -346,6 +349,10 @@ rl_cpvfunc_t *rl_completion_word_break_hook = (rl_cpvfunc_t *)NULL;
    list of matches.  It can accommodate any special sorting behavior the host
    may require, such as ignoring trailing path separators. */
 rl_qsort_match_list_func_t *rl_qsort_match_list_func = (rl_qsort_match_list_func_t *)NULL;
+/* If non-zero, then this is the address of a function to call instead of
+   xfree() to free a match string.  It allows the application to hand over
+   match strings it still owns, and to take them back when they're freed. */
+rl_vcpfunc_t *rl_free_match_func = (rl_vcpfunc_t *)NULL;
 /* Hook function to allow an application to adjust the found completion
    word before readline tries to complete it. */
 rl_adjcmpwrd_func_t *rl_adjust_completion_word = (rl_adjcmpwrd_func_t *)NULL;
@@ -1688,7 +1695,10 @@ remove_duplicate_matches (char **matches)
       if (match_type_strcmp (matches[i], matches[i + 1], past_flag, 0/*casefold*/, 1/*dedupe*/) == 0)
 /* end_clink_change */
 	{
-	  xfree (matches[i]);
+/* begin_clink_change */
+	  //xfree (matches[i]);
+	  free_match (matches[i]);
+/* end_clink_change */
 	  matches[i] = (char *)&dead_slot;
 	}
       else
@@ -1706,7 +1716,10 @@ remove_duplicate_matches (char **matches)
   temp_array[j] = (char *)NULL;
 
   if (matches[0] != (char *)&dead_slot)
-    xfree (matches[0]);
+/* begin_clink_change */
+    //xfree (matches[0]);
+    free_match (matches[0]);
+/* end_clink_change */
 
   /* Place the lowest common denominator back in [0]. */
   temp_array[0] = lowest_common;
@@ -1719,7 +1732,10 @@ remove_duplicate_matches (char **matches)
   if (j == 2 && match_type_strcmp (temp_array[0], temp_array[1], past_flag, 0/*casefold*/, 1/*dedupe*/) == 0)
 /* end_clink_change */
     {
-      xfree (temp_array[1]);
+/* begin_clink_change */
+      //xfree (temp_array[1]);
+      free_match (temp_array[1]);
+/* end_clink_change */
       temp_array[1] = (char *)NULL;
     }
   return (temp_array);
@@ -2634,10 +2650,24 @@ _rl_free_match_list (char **matches)
     return;
 
   for (i = 0; matches[i]; i++)
-    xfree (matches[i]);
+/* begin_clink_change */
+    //xfree (matches[i]);
+    free_match (matches[i]);
+/* end_clink_change */
   xfree (matches);
 }
 
+/* begin_clink_change */
+static void
+free_match (char *match)
+{
+  if (rl_free_match_func)
+    (*rl_free_match_func) (match);
+  else
+    xfree (match);
+}
+/* end_clink_change */
+
 /* Complete the word at or before point.
    WHAT_TO_DO says what to do with the completion.
    `?' means list the possible completions.
@@ -3469,7 +3499,7 @@ rl_old_menu_complete (int count, int invoking_key)
  */
       if (matches && matches[0] && matches[1] && !matches[2])
 	{
-	  xfree (matches[0]);
+	  free_match (matches[0]);
 	  matches[0] = matches[1];
 	  matches[1] = NULL;
 	}
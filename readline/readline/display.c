@@ -171,6 +171,16 @@ const char *_rl_display_modmark_color = NULL;
 const char *_rl_display_message_color = NULL;
 static const char *_normal_color = "\x1b[m";
 static const int _normal_color_len = 3;
+
+/* Text shown after the end of the line while the cursor's there (e.g. the
+   rest of a history line that starts with the input), and its color. */
+const char *_rl_display_suggestion = NULL;
+const char *_rl_display_suggestion_color = NULL;
+/* Called at the start of each redisplay to update _rl_display_suggestion for
+   the current line, however the redisplay was reached. */
+rl_voidfunc_t *_rl_update_suggestion_function = NULL;
+static int suggestion_width = 0;
+static void draw_suggestion PARAMS((void));
 /* end_clink_change */
 
 /* Global variables declared here. */
@@ -689,11 +699,20 @@ rl_redisplay (void)
   if (_rl_echoing_p == 0)
     return;
 
+/* begin_clink_change */
+  if (_rl_update_suggestion_function)
+    (*_rl_update_suggestion_function) ();
+/* end_clink_change */
+
   /* Block keyboard interrupts because this function manipulates global
      data structures. */
   _rl_block_sigint ();  
   RL_SETSTATE (RL_STATE_REDISPLAYING);
 
+/* begin_clink_change */
+  _rl_erase_suggestion ();
+/* end_clink_change */
+
   if (!rl_display_prompt)
     rl_display_prompt = "";
 
@@ -1489,11 +1508,70 @@ rl_redisplay (void)
       visible_wrap_offset = wrap_offset;
   }
 
+/* begin_clink_change */
+  draw_suggestion ();
+/* end_clink_change */
+
   RL_UNSETSTATE (RL_STATE_REDISPLAYING);
   _rl_release_sigint ();
 }
 
 /* begin_clink_change */
+/* Draws the suggestion after the end of the line, truncated to what fits in
+   the rest of the cursor's screen line, and puts the cursor back.  It's not
+   part of the visible line, so it's erased before anything else is drawn. */
+static void
+draw_suggestion (void)
+{
+  const char *s = _rl_display_suggestion;
+  int col, avail, end, next, w;
+
+  if (s == 0 || *s == '\0' || rl_point != rl_end || _rl_horizontal_scroll_mode)
+    return;
+  if (rl_display_prompt != rl_prompt || _rl_last_v_pos != _rl_vis_botlin)
+    return;
+
+  col = _rl_last_c_pos;
+  if (MB_CUR_MAX == 1 || rl_byte_oriented)
+    col -= WRAP_OFFSET (_rl_last_v_pos, visible_wrap_offset);
+
+  /* Stop short of the last column so the terminal doesn't wrap. */
+  avail = _rl_screenwidth - col - 1;
+  for (end = 0; s[end]; end = next)
+    {
+      next = _rl_find_next_mbchar ((char *)s, end, 1, MB_FIND_NONZERO);
+      if (next <= end)
+	next = end + 1;
+      w = _rl_col_width (s, end, next, 1);
+      if (w > avail)
+	break;
+      avail -= w;
+      suggestion_width += w;
+    }
+
+  if (suggestion_width == 0)
+    return;
+
+  if (_rl_display_suggestion_color)
+    _rl_output_some_chars (_rl_display_suggestion_color, strlen (_rl_display_suggestion_color));
+  _rl_output_some_chars (s, end);
+  _rl_output_some_chars (_normal_color, _normal_color_len);
+  _rl_backspace (suggestion_width);
+  fflush (rl_outstream);
+}
+
+/* Erases the suggestion, if one's drawn.  The cursor's still where
+   draw_suggestion() left it. */
+void
+_rl_erase_suggestion (void)
+{
+  if (suggestion_width)
+    {
+      _rl_clear_to_eol (suggestion_width);
+      suggestion_width = 0;
+    }
+}
+
 static void output_beginning_line_color (int linenum, int modmark, const char *line, const char *output)
 {
   if (linenum == 0 && modmark && line == output)
@@ -3192,6 +3270,10 @@ _rl_update_final (void)
 {
   int full_lines, woff, botline_length;
 
+/* begin_clink_change */
+  _rl_erase_suggestion ();
+/* end_clink_change */
+
   full_lines = 0;
   /* If the cursor is the only thing on an otherwise-blank last line,
      compensate so we don't print an extra CRLF. */
@@ -95,6 +95,11 @@ int history_length;
 /* The logical `base' of the history array.  It defaults to 1. */
 int history_base = 1;
 
+/* begin_clink_change */
+/* Called when replace_history_entry() changes the text of a line. */
+rl_history_hook_func_t *history_replace_hook = (rl_history_hook_func_t *)NULL;
+/* end_clink_change */
+
 /* Return the current HISTORY_STATE of the history. */
 HISTORY_STATE *
 history_get_history_state (void)
@@ -393,6 +398,11 @@ replace_history_entry (int which, const char *line, histdata_t data)
   temp->timestamp = savestring (old_value->timestamp);
   the_history[which] = temp;
 
+/* begin_clink_change */
+  if (history_replace_hook)
+    (*history_replace_hook) (which, temp->line);
+/* end_clink_change */
+
   return (old_value);
 }
 
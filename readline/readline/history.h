@@ -279,6 +279,18 @@ extern int max_input_history;
    application and not expanded. */
 extern rl_linebuf_func_t *history_inhibit_expansion_function;
 
+/* begin_clink_change */
+/* If set, history searches ask this function for the next offset from FROM
+   in DIRECTION whose line might contain STRING, or -1 if there are none.  It
+   may return lines that don't match but must never skip one that does. */
+extern rl_history_search_func_t *history_search_candidate_function;
+extern int history_search_candidate PARAMS((const char *, int, int));
+
+/* If set, this is called after replace_history_entry() changes the text of
+   the line at an offset. */
+extern rl_history_hook_func_t *history_replace_hook;
+/* end_clink_change */
+
 #ifdef __cplusplus
 }
 #endif
@@ -59,6 +59,30 @@ char *history_search_delimiter_chars = (char *)NULL;
 
 static int history_search_internal PARAMS((const char *, int, int));
 
+/* begin_clink_change */
+/* Narrows searches to lines that might match; see history.h. */
+rl_history_search_func_t *history_search_candidate_function = (rl_history_search_func_t *)NULL;
+
+/* Returns the next offset from FROM in DIRECTION whose line might contain
+   STRING.  Offsets outside the history list are returned unchanged, and when
+   there are no more candidates the result is one step past the end of the
+   list in DIRECTION. */
+int
+history_search_candidate (const char *string, int from, int direction)
+{
+  int ret;
+
+  if (history_search_candidate_function == 0 || from < 0 || from >= history_length)
+    return (from);
+
+  ret = (*history_search_candidate_function) (string, from, direction);
+  if (ret < 0 || ret >= history_length)
+    return ((direction < 0) ? -1 : history_length);
+
+  return (ret);
+}
+/* end_clink_change */
+
 /* Search the history for STRING, starting at history_offset.
    If DIRECTION < 0, then the search is through previous entries, else
    through subsequent.  If ANCHORED is non-zero, the string must
@@ -105,6 +129,11 @@ history_search_internal (const char *string, int direction, int flags)
     {
       /* Search each line in the history list for STRING. */
 
+/* begin_clink_change */
+      if (patsearch == 0)
+	i = history_search_candidate (string, i, reverse ? -1 : 1);
+/* end_clink_change */
+
       /* At limit for direction? */
       if ((reverse && i < 0) || (!reverse && i == history_length))
 	return (-1);
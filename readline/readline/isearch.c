@@ -714,7 +714,11 @@ add_character:
       do
 	{
 	  /* Move to the next line. */
-	  cxt->history_pos += cxt->direction;
+/* begin_clink_change */
+	  cxt->history_pos = history_search_candidate (cxt->search_string,
+						       cxt->history_pos + cxt->direction,
+						       cxt->direction);
+/* end_clink_change */
 
 	  /* At limit for direction? */
 	  if ((cxt->sflags & SF_REVERSE) ? (cxt->history_pos < 0) : (cxt->history_pos == cxt->hlen))
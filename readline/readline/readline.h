@@ -680,6 +680,9 @@ extern rl_voidfunc_t *rl_redisplay_function;
 extern const char *_rl_display_input_color;
 extern const char *_rl_display_modmark_color;
 extern const char *_rl_display_message_color;
+extern const char *_rl_display_suggestion;
+extern const char *_rl_display_suggestion_color;
+extern rl_voidfunc_t *_rl_update_suggestion_function;
 /* end_clink_change */
 
 extern rl_vintfunc_t *rl_prep_term_function;
@@ -852,6 +855,10 @@ extern rl_vcppfunc_t *rl_completion_display_matches_func;
    list of matches.  It can accommodate any special sorting behavior the host
    may require, such as ignoring trailing path separators. */
 extern rl_qsort_match_list_func_t *rl_qsort_match_list_func;
+/* If non-zero, then this is the address of a function to call instead of
+   xfree() to free a match string.  It lets the application hand Readline
+   match strings that it still owns. */
+extern rl_vcpfunc_t *rl_free_match_func;
 /* If non-zero, then this is the address of a function to call that determines
    whether a file extension is executable. */
 extern rl_iccpfunc_t *rl_is_exec_func;
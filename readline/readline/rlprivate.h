@@ -283,6 +283,9 @@ extern void _rl_redisplay_after_sigwinch PARAMS((void));
 extern void _rl_clean_up_for_exit PARAMS((void));
 extern void _rl_erase_entire_line PARAMS((void));
 extern int _rl_current_display_line PARAMS((void));
+/* begin_clink_change */
+extern void _rl_erase_suggestion PARAMS((void));
+/* end_clink_change */
 
 /* input.c */
 extern int _rl_any_typein PARAMS((void));
@@ -78,6 +78,8 @@ typedef void rl_qsort_match_list_func_t PARAMS((char**, int len));
 typedef char rl_adjcmpwrd_func_t PARAMS((char qc, int *fp, int *dp));
 /* Type for postprocessing the lcd hook function */
 typedef void rl_postprocess_lcd_func_t PARAMS((char *, const char *));
+/* Type for narrowing history searches to lines that might match */
+typedef int rl_history_search_func_t PARAMS((const char *string, int from, int direction));
 /* end_clink_change */
 
 /* Input function type */
@@ -681,6 +681,9 @@ _rl_backspace (int count)
 int
 rl_crlf (void)
 {
+/* begin_clink_change */
+  _rl_erase_suggestion ();
+/* end_clink_change */
 #if defined (NEW_TTY_DRIVER) || defined (__MINT__)
   if (_rl_term_cr)
     tputs (_rl_term_cr, 1, _rl_output_character_function);